@@ -0,0 +1,51 @@
+/*
+ * File:   ConfigLCD.h
+ *
+ * Conexion del LCD para LibLCDXC8_1.h y LibLCDBufXC8.h. Lo incluye
+ * ConfigTarjeta.h, antes que LibHALXC8.h y que las librerias del LCD, y elige
+ * en compilacion:
+ *
+ *   LCD_BUS 4  D7..D4 en RD7..RD4 (el montaje de Lab5). RD0..RD3 son del
+ *              decodificador del 7 segmentos (LibSalidasXC8.h) y cada byte
+ *              al LCD son dos pulsos de E.
+ *   LCD_BUS 8  D7..D0 en RB7..RB0, un pulso por byte. El puerto B es el
+ *              unico que queda completo: solo cabe en ESTACION 2 sin el boton
+ *              de parada (ConfigTarjeta.h lo revisa). El 7 segmentos se queda
+ *              en RD0..RD3. make lcd8 lo corre en el simulador.
+ *
+ * RS y E siguen en RA4 y RA5 (se pueden cambiar definiendo RS y E). Con el
+ * R/W del LCD cableado se define RW (y RW_TRIS) para leer la bandera de
+ * ocupado en vez de esperar los retardos fijos (ver LibLCDXC8_1.h).
+ * LCD_PUERTO es la letra del puerto del bus: HAL_LCD() se la pasa al
+ * simulador.
+ */
+
+#ifndef CONFIGLCD_H
+#define	CONFIGLCD_H
+
+#ifndef LCD_BUS
+#define LCD_BUS 4
+#endif
+
+//#define RW LATC0                      // R/W del LCD en un pin libre (RC0 aqui): la bienvenida pasa de ~0.9 s a menos de 0.1 s.
+//#define RW_TRIS TRISC0
+
+#if LCD_BUS == 4
+
+#define Datos LATD                      // Solo RD7..RD4: la libreria no toca RD0..RD3.
+#define DatosLee PORTD
+#define DatosTris TRISD
+#define LCD_PUERTO 'D'
+
+#elif LCD_BUS == 8
+
+#define Datos LATB                      // RB7..RB0: el puerto D sigue siendo del 7 segmentos.
+#define DatosLee PORTB
+#define DatosTris TRISB
+#define LCD_PUERTO 'B'
+
+#else
+#error "LCD_BUS debe ser 4 u 8"
+#endif
+
+#endif	/* CONFIGLCD_H */
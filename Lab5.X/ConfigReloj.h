@@ -0,0 +1,104 @@
+/*
+ * File:   ConfigReloj.h
+ *
+ * Reloj del PIC18F4550 y constantes de tiempo que dependen de el. Lo incluye
+ * ConfigTarjeta.h (antes que LibHALXC8.h y que todas las librerias), asi que
+ * _XTAL_FREQ se define una sola vez aqui. RELOJ_MHZ elige en compilacion (se
+ * puede pasar con -DRELOJ_MHZ=n):
+ *
+ *   RELOJ_MHZ 1   INTOSC a 1 MHz (IRCF=100, el valor de reset): el montaje
+ *                 original de Lab5, 4 us por instruccion.
+ *   RELOJ_MHZ 8   INTOSC a 8 MHz (IRCF=111), sin cristal: 500 ns por
+ *                 instruccion.
+ *   RELOJ_MHZ 48  Cristal de 20 MHz en OSC1/OSC2 con el PLL (PLLDIV=5 da los
+ *                 4 MHz que pide el PLL, CPUDIV=OSC1_PLL2 divide los 96 MHz
+ *                 entre 2): 83 ns por instruccion. Los pragmas de FOSC, PLLDIV
+ *                 y CPUDIV estan en Lab5.c.
+ *
+ * Lo que cada modo no puede sacar de una division lo elige la tabla de abajo
+ * (prescalers y reloj del ADC); el resto se calcula a partir de _XTAL_FREQ:
+ *
+ *   Timer0   tick de RELOJ_TICK_HZ con prescaler 1:4 (RELOJ_TMR0_RECARGA).
+ *   Timer1   un segundo con prescaler 1:8 en RELOJ_TMR1_VUELTAS desbordes
+ *            de RELOJ_TMR1_RECARGA (a 48 MHz el segundo no cabe en 16 bits).
+ *   Timer3   base de tiempo libre de RELOJ_T3_HZ (captura, tareas,
+ *            estadisticas, energia). RELOJ_T3_US_NUM / RELOJ_T3_US_DEN pasa
+ *            ticks a us sin salir de 32 bits.
+ *   Timer2   PWM del motor con PR2 = 249 (LibMotorXC8.h): 1, 2 o 3 kHz.
+ *   ADC      TAD de al menos 0.8 us (minimo de la hoja de datos del PIC18F4550).
+ *
+ * Los baudios del UART se calculan en LibUARTXC8.h y los retardos del LCD en
+ * LibLCDXC8_1.h y LibLCDBufXC8.h, tambien con _XTAL_FREQ. Si una combinacion
+ * no da un valor exacto la compilacion se detiene con #error.
+ */
+
+#ifndef CONFIGRELOJ_H
+#define	CONFIGRELOJ_H
+
+#ifndef RELOJ_MHZ
+#define RELOJ_MHZ 1
+#endif
+
+#if RELOJ_MHZ == 1
+
+#define _XTAL_FREQ 1000000
+#define RELOJ_OSCCON 0b01000000         // IRCF=100: INTOSC a 1 MHz, SCS=00 (oscilador de los pragmas: INTOSC).
+#define RELOJ_T3CKPS 0                  // Timer3 1:1: 250 kHz, 4 us por tick.
+#define RELOJ_T2CKPS 0                  // Timer2 1:1: PWM de 1 kHz.
+#define RELOJ_ADCS 0b000                // Fosc/2: TAD de 2 us.
+#define RELOJ_TMR1_VUELTAS 1            // 31250 cuentas por segundo.
+
+#elif RELOJ_MHZ == 8
+
+#define _XTAL_FREQ 8000000
+#define RELOJ_OSCCON 0b01110000         // IRCF=111: INTOSC a 8 MHz, SCS=00.
+#define RELOJ_T3CKPS 1                  // Timer3 1:2: 1 MHz, 1 us por tick.
+#define RELOJ_T2CKPS 1                  // Timer2 1:4: PWM de 2 kHz.
+#define RELOJ_ADCS 0b001                // Fosc/8: TAD de 1 us.
+#define RELOJ_TMR1_VUELTAS 4            // 250000 cuentas por segundo: 4 x 62500.
+
+#elif RELOJ_MHZ == 48
+
+#define _XTAL_FREQ 48000000
+#define RELOJ_OSCCON 0b00000000         // SCS=00: oscilador primario (HSPLL); IRCF no se usa.
+#define RELOJ_T3CKPS 3                  // Timer3 1:8: 1.5 MHz, 0.67 us por tick.
+#define RELOJ_T2CKPS 2                  // Timer2 1:16: PWM de 3 kHz.
+#define RELOJ_ADCS 0b110                // Fosc/64: TAD de 1.33 us.
+#define RELOJ_TMR1_VUELTAS 25           // 1500000 cuentas por segundo: 25 x 60000.
+
+#else
+#error "RELOJ_MHZ debe ser 1, 8 o 48"
+#endif
+
+#define RELOJ_TICK_HZ 100               // Tick del sistema (Timer0): 10 ms.
+
+#define RELOJ_TMR0_CUENTAS (_XTAL_FREQ / 4 / 4 / RELOJ_TICK_HZ)
+#define RELOJ_TMR0_RECARGA (65536UL - RELOJ_TMR0_CUENTAS)
+#define RELOJ_TMR1_CUENTAS (_XTAL_FREQ / 4 / 8 / RELOJ_TMR1_VUELTAS)
+#define RELOJ_TMR1_RECARGA (65536UL - RELOJ_TMR1_CUENTAS)
+#define RELOJ_T3_HZ (_XTAL_FREQ / 4 / (1 << RELOJ_T3CKPS))
+
+#if RELOJ_T3_HZ == 250000
+#define RELOJ_T3_US_NUM 4
+#define RELOJ_T3_US_DEN 1
+#elif RELOJ_T3_HZ == 1000000
+#define RELOJ_T3_US_NUM 1
+#define RELOJ_T3_US_DEN 1
+#elif RELOJ_T3_HZ == 1500000
+#define RELOJ_T3_US_NUM 2
+#define RELOJ_T3_US_DEN 3
+#else
+#error "Falta RELOJ_T3_US_NUM/DEN para esta frecuencia de Timer3"
+#endif
+
+#if RELOJ_TMR0_CUENTAS > 65536 || RELOJ_TMR0_CUENTAS * 16 * RELOJ_TICK_HZ != _XTAL_FREQ
+#error "El tick de Timer0 (1:4) no cabe o no es exacto con este _XTAL_FREQ"
+#endif
+#if RELOJ_TMR1_CUENTAS > 65536 || RELOJ_TMR1_CUENTAS * 32 * RELOJ_TMR1_VUELTAS != _XTAL_FREQ
+#error "El segundo de Timer1 (1:8 y RELOJ_TMR1_VUELTAS) no cabe o no es exacto con este _XTAL_FREQ"
+#endif
+#if RELOJ_T3_HZ % 1000 != 0
+#error "Timer3 debe dar un numero entero de ticks por ms"
+#endif
+
+#endif	/* CONFIGRELOJ_H */
@@ -0,0 +1,173 @@
+/*
+ * File:   ConfigTarjeta.h
+ *
+ * Tarjeta de la estacion: pines y partes del programa que se compilan. Es lo
+ * primero que incluye Lab5.c y lo incluye LibHALXC8.h, asi que todas las
+ * librerias ven el mismo mapa de pines. ESTACION elige una de las tres
+ * variantes (se puede pasar con -DESTACION=n):
+ *
+ *   ESTACION 1  Lab5 completo: teclado, telemetria, bitacora en EEPROM y
+ *               estadisticas.
+ *   ESTACION 2  Supervisada por serial: sin teclado (el objetivo llega con
+ *               SET TARGET y el OK con el comando OK). PORTB queda libre y
+ *               RB0/INT0 es un boton de parada de emergencia.
+ *   ESTACION 3  Contador basico: teclado y LCD, sin telemetria, sin bitacora
+ *               y sin estadisticas (GET STATS y GET HIST responden ERR).
+ *
+ * Cada USA_... vale 1 o 0 y se puede cambiar solo (por ejemplo -DUSA_BITACORA=0
+ * sobre la estacion 1). Con 0 la libreria no se incluye y Lab5.c no compila
+ * su tarea, su rama de la ISR ni sus comandos. Las tareas apagadas dejan su
+ * posicion vacia en la tabla de LibTareasXC8.h (las prioridades no cambian).
+ *
+ * USA_PARADA_EXTERNA pone el boton de parada (a tierra, con el pull-up de
+ * PORTB) en RB0/INT0, que siempre es de alta prioridad. RB0 es una fila del
+ * teclado: solo se puede en una estacion sin teclado.
+ *
+ * Los puertos en el montaje de Lab5 (para ver que queda libre):
+ *
+ *   RA  RA0/AN0 el ADC, RA1..RA3 LED, buzzer y luz, RA4 y RA5 RS y E del LCD.
+ *   RB  el teclado (filas RB0..RB3, columnas RB4..RB7) o, sin teclado, el
+ *       boton de parada en RB0/INT0 o el LCD de 8 bits.
+ *   RC  RC1 el sensor (CCP2), RC2 el motor (CCP1), RC6 y RC7 el UART. RC0
+ *       queda libre (el R/W del LCD en ConfigLCD.h); RC4 y RC5 son del USB y
+ *       solo sirven como entradas.
+ *   RD  D7..D4 del LCD en RD7..RD4 y el 7 segmentos en RD0..RD3.
+ *   RE  el LED RGB en RE0..RE2 (RE3 es MCLR).
+ *
+ * El LCD con bus de 8 bits (LCD_BUS 8 en ConfigLCD.h) necesita un puerto
+ * completo. Con teclado no queda ninguno y el 7 segmentos no tiene a donde
+ * irse del puerto D (SIETE_SEG no puede ir en LATE: borraria el RGB), asi
+ * que el LCD va en el puerto B y solo cabe en ESTACION 2, que con LCD_BUS 8
+ * deja USA_PARADA_EXTERNA en 0 (make lcd8 la compila con -DESTACION=2
+ * -DLCD_BUS=8 y la corre en el simulador).
+ *
+ * Los pines se pueden redefinir antes de incluir este archivo, cada uno junto
+ * con su TRIS (main configura las direcciones con esos nombres). El sensor
+ * tiene que ser la entrada de CCP2 (RC1 con CCP2MX=ON) y el motor la salida
+ * P1A de CCP1 (RC2). El LCD se configura en ConfigLCD.h y el reloj (y con el
+ * _XTAL_FREQ) en ConfigReloj.h.
+ */
+
+#ifndef CONFIGTARJETA_H
+#define	CONFIGTARJETA_H
+
+#include "ConfigReloj.h"
+#include "ConfigLCD.h"
+
+#ifndef ESTACION
+#define ESTACION 1
+#endif
+
+#if ESTACION == 1
+
+#ifndef USA_TECLADO
+#define USA_TECLADO 1
+#endif
+#ifndef USA_TELEMETRIA
+#define USA_TELEMETRIA 1
+#endif
+#ifndef USA_BITACORA
+#define USA_BITACORA 1
+#endif
+#ifndef USA_ESTADISTICA
+#define USA_ESTADISTICA 1
+#endif
+#ifndef USA_PARADA_EXTERNA
+#define USA_PARADA_EXTERNA 0
+#endif
+
+#elif ESTACION == 2
+
+#ifndef USA_TECLADO
+#define USA_TECLADO 0
+#endif
+#ifndef USA_TELEMETRIA
+#define USA_TELEMETRIA 1
+#endif
+#ifndef USA_BITACORA
+#define USA_BITACORA 1
+#endif
+#ifndef USA_ESTADISTICA
+#define USA_ESTADISTICA 1
+#endif
+#ifndef USA_PARADA_EXTERNA
+#if LCD_BUS == 8
+#define USA_PARADA_EXTERNA 0            // RB0 es D0 del LCD.
+#else
+#define USA_PARADA_EXTERNA 1
+#endif
+#endif
+
+#elif ESTACION == 3
+
+#ifndef USA_TECLADO
+#define USA_TECLADO 1
+#endif
+#ifndef USA_TELEMETRIA
+#define USA_TELEMETRIA 0
+#endif
+#ifndef USA_BITACORA
+#define USA_BITACORA 0
+#endif
+#ifndef USA_ESTADISTICA
+#define USA_ESTADISTICA 0
+#endif
+#ifndef USA_PARADA_EXTERNA
+#define USA_PARADA_EXTERNA 0
+#endif
+
+#else
+#error "ESTACION debe ser 1, 2 o 3"
+#endif
+
+#if USA_TECLADO && USA_PARADA_EXTERNA
+#error "USA_PARADA_EXTERNA usa RB0/INT0, que es una fila del teclado (USA_TECLADO 0)"
+#endif
+
+#if LCD_BUS == 8 && (USA_TECLADO || USA_PARADA_EXTERNA)
+#error "LCD_BUS 8 usa todo el puerto B: sin teclado ni boton de parada (ESTACION 2, ver el encabezado de ConfigTarjeta.h)"
+#endif
+
+// ============================== PINES ==============================
+
+#ifndef SENSOR_PIEZA
+#define SENSOR_PIEZA    RC1             // Sensor/pulsador de piezas, activo en bajo (entrada de CCP2).
+#define SENSOR_TRIS     TRISC1
+#endif
+#ifndef MOTOR
+#define MOTOR           LATC2           // Motor (transistor/driver), 1 = encendido. Salida P1A del PWM.
+#define MOTOR_TRIS      TRISC2
+#endif
+#ifndef LED_OPERACION
+#define LED_OPERACION   LATA1           // LED que parpadea mientras el programa corre.
+#define LED_OPERACION_TRIS TRISA1
+#endif
+#ifndef BUZZER
+#define BUZZER          LATA2           // Buzzer/LED de aviso.
+#define BUZZER_TRIS     TRISA2
+#endif
+#ifndef LUZ
+#define LUZ             LATA3           // Luz/backlight que se apaga por inactividad.
+#define LUZ_TRIS        TRISA3
+#endif
+#ifndef RGB
+#define RGB             LATE            // LED RGB en RE0..RE2.
+#define RGB_TRIS        TRISE
+#endif
+#ifndef SIETE_SEG
+#define SIETE_SEG       LATD            // Unidades hacia el display de 7 segmentos (RD0..RD3).
+#define SIETE_SEG_TRIS  TRISD
+#endif
+#if USA_PARADA_EXTERNA
+#define BOTON_PARADA    RB0             // Boton de parada de emergencia, activo en bajo (INT0: no se puede mover).
+#define BOTON_PARADA_TRIS TRISB0
+#endif
+#if USA_TECLADO
+#ifndef TECLADO_FILAS
+#define TECLADO_FILAS   LATB            // RB0..RB3: filas del teclado (salidas).
+#define TECLADO_PUERTO  PORTB           // RB4..RB7: columnas del teclado (entradas con pull-up).
+#define TECLADO_TRIS    TRISB
+#endif
+#endif
+
+#endif	/* CONFIGTARJETA_H */
@@ -1,14 +1,41 @@
 #include <xc.h>                         // Incluye definiciones del PIC y registros (TRISx, LATx, ADCONx, TMRx, etc.). Sin esto no puedes usar los registros del microcontrolador.
 
-#include <stdio.h>                      // Incluye soporte para funciones tipo printf. Aqu? se usa para enviar texto por serial (USART) con printf().
-
-#define _XTAL_FREQ 1000000              // Define Fosc = 1 MHz para que __delay_ms() y __delay_us() calculen tiempos correctos.
-
+#include "ConfigTarjeta.h"              // Estaci?n (ESTACION 1, 2 o 3): pines, partes que se compilan (USA_TECLADO, USA_TELEMETRIA, ...), el LCD (ConfigLCD.h) y el reloj (ConfigReloj.h: _XTAL_FREQ).
+#include "LibHALXC8.h"                  // Nombres de los pines de la tarjeta (MOTOR, RGB, SENSOR_PIEZA, ...) y HAL_ESPERA() para el simulador (make host).
+#if USA_TECLADO
+#include "LibTecladoXC8.h"              // Teclado barrido por el tick de Timer0 con antirrebote por tecla y cola de eventos (sin __delay_ms en la ISR).
+#endif
 #include "LibLCDXC8_1.h"                // Incluye tu librer?a del LCD (funciones como ConfiguraLCD, InicializaLCD, MensajeLCD_Var, DireccionaLCD, CrearCaracter, etc.).
-
+#include "LibLCDBufXC8.h"               // Pantalla sombra 2x16: despu?s de la bienvenida todo se escribe en RAM y ServicioLCD() lo manda de a un nibble.
+#include "LibUARTXC8.h"                 // Buffer circular de transmisi?n serial atendido por TXIF (respuestas con UART_Texto y UART_Numero, sin printf).
+#include "LibADCXC8.h"                  // ADC por ADIF: 16 muestras por valor de 12 bits y promedio movil (reemplaza Conversion()).
+#include "LibMotorXC8.h"                // Motor por PWM de CCP1 (RC2) con hist?resis, tiempo m?nimo en cada estado y rampa.
+#if USA_TELEMETRIA
+#include "LibTelemetriaXC8.h"           // Tramas binarias con CRC-8 para el ADC, conteo, objetivo y motor (reemplazan el printf del ADC).
+#endif
+#if USA_BITACORA
+#include "LibBitacoraXC8.h"             // Conteo y objetivo en la EEPROM de datos, en ronda y con CRC: sobreviven a una falla de energ?a.
+#endif
+#if USA_ESTADISTICA
+#include "LibEstadisticaXC8.h"          // Piezas por minuto, histograma de intervalos y tiempo en marcha/parado con el instante de cada pieza.
+#endif
+#define MEDICION_MAX 11                 // Una posici?n m?s que el valor por defecto de LibMedicionXC8.h (ISR_Alta completa).
+#include "LibMedicionXC8.h"             // Tiempo de cada rama de la ISR con Timer3 (solo si se compila con MEDICION_ISR; GET ISR n).
+#include "LibEnergiaXC8.h"              // Niveles de bajo consumo (luz apagada, Sleep) decididos en main y estimaci?n de la corriente.
+#define TAREAS_MAX 11                   // Tres tareas m?s que el valor por defecto de LibTareasXC8.h (bit?cora, estad?sticas y energ?a).
+#include "LibTareasXC8.h"               // Planificador cooperativo: main ya no espera en ciclos vac?os ni con __delay_ms (ver TAREAS).
+#include "LibSalidasXC8.h"              // RGB y 7 segmentos por tabla, escritos juntos y sin tocar el bus del LCD en PORTD.
+
+#if RELOJ_MHZ == 48
+#pragma config FOSC=HSPLL_HS            // Cristal de 20 MHz (HS) con el PLL: la CPU corre a 96 MHz / 2 = 48 MHz.
+#pragma config PLLDIV=5                 // 20 MHz / 5 = 4 MHz, la entrada que pide el PLL.
+#pragma config CPUDIV=OSC1_PLL2         // Reloj de la CPU: salida del PLL (96 MHz) entre 2.
+#else
 #pragma config FOSC=INTOSC_EC           // Configuraci?n: usa oscilador interno del PIC (INTOSC). El _EC deja OSC2 disponible como salida clock/funci?n seg?n configuraci?n del PIC.
+#endif
 #pragma config WDT=OFF                  // Desactiva el Watchdog Timer: evita reinicios autom?ticos si el programa tarda o ?se cuelga?.
 #pragma config LVP=OFF                  // Desactiva programaci?n en bajo voltaje: evita conflictos y libera el pin asociado para uso normal.
+#pragma config CCP2MX=ON                // CCP2 en RC1: el sensor de piezas entra directo al m?dulo de captura.
 
 
 // ============================== CARACTERES PERSONALIZADOS LCD ==============================
@@ -40,46 +67,217 @@ unsigned char Marco[8] = {              // Arreglo 5x8 que dibuja un ?rect?ngulo
 
 unsigned int piezasTotalesContadas;     // Conteo global: cu?ntas piezas se han contado en total desde el ?ltimo reinicio del conteo.
 unsigned int unidades7Seg;              // Unidades (0 a 9) que se env?an al puerto del display 7 segmentos.
-unsigned int decenasRGB;                // Decenas (0 a 5) que se representan con colores del LED RGB (cada decena cambia color).
-
-unsigned char indiceDigitoObjetivo;     // ?ndice de digitaci?n: 0 significa ?voy a escribir la decena?, 1 significa ?voy a escribir la unidad?.
+unsigned int decenasRGB;                // Pasos (0 a 5) que se representan con colores del LED RGB: cada escalaRGB piezas cambia el color.
+unsigned int escalaRGB;                 // Piezas por color: 10, 100, 1000 o 10000 seg?n el objetivo (los 6 colores cubren todo el lote).
+unsigned int restoEscalaRGB;            // Piezas desde el ?ltimo cambio de color (0 a escalaRGB - 1).
+
+#define OBJETIVO_DIGITOS 5              // D?gitos del objetivo (teclado, SET TARGET y LCD).
+#define OBJETIVO_MAX 65535u             // El conteo y el objetivo son de 16 bits en el PIC.
+#define OBJETIVO_CELDA 0xC5             // Primer marco de la pregunta (los 5 quedan centrados en la segunda l?nea).
+#define RGB_PASOS 6                     // Colores del conteo antes de dar la vuelta (salidaColorDecena, LibSalidasXC8.h).
+
+unsigned char indiceDigitoObjetivo;     // ?ndice de digitaci?n: cu?ntos d?gitos del objetivo ya se escribieron (0 a OBJETIVO_DIGITOS).
+unsigned char digitosObjetivo;          // D?gitos con que se muestran faltantes y objetivo en el LCD (los del objetivo, 1 a 5).
+unsigned char paginaConteo;             // P?gina del LCD durante el conteo (OK pasa a la siguiente): PAGINA_...
+
+#define PAGINA_CONTEO 0                 // Faltantes y objetivo.
+#define PAGINA_RITMO 1                  // Piezas por minuto e intervalo promedio.
+#define PAGINA_INTERVALOS 2             // Intervalo m?nimo y m?ximo entre piezas.
+#define PAGINA_TIEMPOS 3                // Segundos en marcha y parado.
+#if USA_ESTADISTICA
+#define PAGINAS 4
+#else
+#define PAGINAS 1                       // Sin estad?sticas OK solo vuelve a dibujar el conteo.
+#endif
 unsigned char modoEdicionObjetivo;      // Bandera de edici?n: 1 = el usuario est? escribiendo el objetivo; 0 = no se acepta escritura.
 unsigned int piezasObjetivo;            // Meta (objetivo) que el usuario ingresa con el teclado (ej: 25 significa contar 25 piezas).
 
 unsigned char flagConteoActivo;         // Control de flujo: 1 = estoy contando; 0 = salgo del ciclo de conteo y vuelvo a pedir objetivo.
 unsigned char teclaLeida;               // ?ltima tecla detectada del teclado matricial (n?mero o '*' como OK).
-unsigned char pulsadorListo;            // Antirrebote del sensor/pulsador RC1: 1 = listo para detectar nueva pulsaci?n; 0 = ya detect? bajada, espero subida.
 
-unsigned char segundosSinActividad;     // Inactividad: contador de segundos sin interacci?n, incrementado por Timer1 para apagar luz / Sleep.
+volatile unsigned char segundosSinActividad; // Inactividad: contador de segundos sin interacci?n (teclado, sensor o serial), incrementado por Timer1. TareaEnergia decide luz / Sleep.
+unsigned char t1Vueltas;                // Desbordes de Timer1 en el segundo en curso (RELOJ_TMR1_VUELTAS por segundo, solo la ISR).
+unsigned char luzAntesEspera;           // LUZ al pasar de ENERGIA_ACTIVO a un nivel con la luz apagada (se vuelve a encender al salir).
 
 
 // ============================== NUEVO EN GU?A 5: ADC + SERIAL + MOTOR ==============================
 
-unsigned int adcValor;                  // Valor le?do del ADC. En PIC18F4550 t?pico ADC es 10 bits -> rango 0 a 1023 (dependiendo de justificaci?n y lectura ADRES).
+unsigned int adcValor;                  // Promedio m?vil del ADC en 12 bits (0 a 4095): 16 lecturas de 10 bits sumadas y corridas 2 bits (LibADCXC8.h).
 unsigned char rxByte;                   // ?ltimo byte recibido por serial USART (caracter ASCII recibido desde PC/terminal/etc).
 
-unsigned char paradaEmergencia;         //
+volatile unsigned char paradaEmergencia; // 1 = parada de emergencia: las salidas ya est?n seguras y main dibuja la pantalla (MuestraEmergencia).
+volatile unsigned char paradaFuente;    // Qui?n la pidi? (PARADA_...): se reporta por serial desde main.
 unsigned char ordenMotor;               //
 
+#define PARADA_SERIAL 1                 // L?nea "P" (ISR_Alta, con el fin de l?nea reci?n llegado).
+#define PARADA_TECLA 2                  // Tecla de emergencia (cambio en RB4..RB7 en ISR_Alta, o el barrido si ese aviso no lleg?).
+#define PARADA_BOTON 3                  // Bot?n en RB0/INT0 (ISR_Alta, USA_PARADA_EXTERNA).
+#define PARADA_COMANDO 4                // Comando STOP (desde main).
+
+#define ParadaEmergencia(fuente) do{ Motor_Parada(); Salida_Alarma(); paradaFuente = (fuente); paradaEmergencia = 1; }while(0) // Macro: primero los pines (RC2 y RGB), despu?s las banderas.
+
+
+// ============================== COMANDOS SERIALES (COLA DE RECEPCI?N) ==============================
+
+#define LARGO_COMANDO 20                // M?ximo de caracteres por l?nea de comando (sin contar el fin de l?nea).
+
+char lineaComando[LARGO_COMANDO + 1];   // L?nea que se va armando en main con los bytes de la cola de recepci?n.
+unsigned char largoComando;             // Caracteres acumulados en lineaComando.
+unsigned char comandoDesbordado;        // 1 = la l?nea super? LARGO_COMANDO y se descarta completa al llegar el fin de l?nea.
+volatile unsigned char rxInicioLinea;   // Lo usa la ISR: 1 = el pr?ximo byte es el primero de una l?nea.
+volatile unsigned char rxLineaParada;   // Lo usa la ISR: 1 = la l?nea va en "P"; si llega el fin de l?nea es parada inmediata.
+
+
+// ============================== TICK DE TIMER0 Y TAREAS ==============================
+
+#define TICKS_POR_SEGUNDO RELOJ_TICK_HZ // Desbordes de Timer0 por segundo (el LED sigue parpadeando cada 1 s). La recarga es RELOJ_TMR0_RECARGA.
+#define TICKS_ADC 25                    // Cada 250 ms: decisi?n del motor con el ADC filtrado, y un tick despu?s la telemetr?a (igual que antes).
+
+#define TAREA_SERIAL 0                  // ?ndice en la tabla de LibTareasXC8.h = prioridad (0 la m?s alta).
+#define TAREA_CONTEO 1                  // La cola de recepci?n (32 bytes) se llena en 33 ms a 9600 baudios: el serial va primero.
+#define TAREA_TECLADO 2
+#define TAREA_MOTOR 3
+#define TAREA_TELEMETRIA 4
+#define TAREA_UI 5
+#define TAREA_BUZZER 6                  // De una sola vez: apaga el buzzer.
+#define TAREA_LED 7
+#define TAREA_BITACORA 8                // Cada segundo: un registro en EEPROM si cambi? el objetivo o el estado; el conteo, cada minuto.
+#define TAREA_ESTADISTICA 9             // Cada segundo: ventana del ritmo, marcha/parado y la p?gina de estad?sticas.
+#define TAREA_ENERGIA 10                // Cada segundo: nivel de consumo por inactividad (antes en la ISR de Timer1).
+
+#define MEDIR_ISR 0                     // Posiciones de la tabla de LibMedicionXC8.h (GET ISR n): la ISR de baja prioridad completa,
+#define MEDIR_TX 1                      // cada rama,
+#define MEDIR_RC 2
+#define MEDIR_SENSOR 3
+#define MEDIR_LATENCIA_SENSOR 4         // del flanco del sensor (CCPR2) a la rama CCP2 (en la tarjeta; el simulador da valores de su modelo),
+#define MEDIR_ADC 5
+#define MEDIR_EEPROM 6
+#define MEDIR_TMR3 7
+#define MEDIR_TMR0 8
+#define MEDIR_TMR1 9
+#define MEDIR_ISR_ALTA 10               // y ISR_Alta completa. MEDIR_ISR incluye lo que ISR_Alta le quit? en medio.
+
+#define TICKS_US(t) ((unsigned long)(t) * RELOJ_T3_US_NUM / RELOJ_T3_US_DEN) // Ticks de Timer3 (RELOJ_T3_HZ) a microsegundos.
+
+#define UI_BIENVENIDA 0                 // Estados de TareaUI: lo que se hace cuando se cumple ticksUI.
+#define UI_ANIMACION 1                  // Un desplazamiento de pantalla cada 100 ms.
+#define UI_AVISO_RESET 2                // FALLA DE ENERG?A / RESET DE USUARIO.
+#define UI_FIN_AVISO 3                  // Termina el aviso y pide el objetivo.
+#define UI_PREGUNTA 4                   // Esperando OK (tecla o SET TARGET).
+#define UI_ERROR 5                      // "Error / Try again" durante 2 s.
+#define UI_CONTEO 6                     // Contando hasta llegar al objetivo.
+#define UI_CUMPLIDA 7                   // Buzzer 1 s antes del mensaje de cuenta cumplida.
+#define UI_ESPERA_OK 8                  // "Cuenta Cumplida / Presione OK".
+
+unsigned char estadoUI;                 // Estado actual de la pantalla (UI_...).
+unsigned char fallaEnergia;             // 1 = el arranque fue por falla de energ?a o ca?da de tensi?n (POR o BOR en 0).
+#if USA_BITACORA
+#define HLVD_NIVEL 0b00011110           // HLVDEN=1, VDIRMAG=0 (bajada) y HLVDL=1110: el nivel m?s alto con la referencia interna (1111 es HLVDIN).
+unsigned char bitacoraValida;           // 1 = Bitacora_Inicia() encontr? un registro (bitacoraConteo, bitacoraObjetivo, bitacoraEstado).
+#endif
+unsigned int ticksUI;                   // Ticks que faltan para ejecutar el estado (pantallas que se quedan un tiempo fijo).
+unsigned char pasoAnimacion;            // Desplazamientos hechos en la animaci?n de bienvenida.
+
+
+// ============================== SENSOR DE PIEZAS (CCP2 + TIMER3) ==============================
+
+#define SENSOR_VENTANA_MS 3             // Flancos a menos de 3 ms del ?ltimo aceptado son rebotes (a 100 piezas/s hay 10 ms entre piezas).
+#define SENSOR_VENTANA ((unsigned long)(RELOJ_T3_HZ / 1000) * SENSOR_VENTANA_MS) // La misma ventana en ticks de Timer3.
+
+#define SENSOR_MARCAS 8                 // Instantes guardados (potencia de 2): main lee el de cada pieza antes de que vuelvan a pasar 8.
+
+volatile unsigned char sensorPulsos;    // Piezas aceptadas por la ISR. Cuenta libre de 8 bits: main procesa la diferencia con sensorPulsosLeidos.
+#if USA_ESTADISTICA
+volatile unsigned long sensorMarcas[SENSOR_MARCAS]; // Instante (ticks de Timer3, 32 bits) de cada pieza aceptada, en la posici?n sensorPulsos % 8.
+#endif
+unsigned char sensorPulsosLeidos;       // Piezas que main ya sum? al conteo.
+volatile unsigned int sensorRebotes;    // Flancos descartados por caer dentro de la ventana (diagn?stico).
+unsigned int t3Vueltas;                 // Desbordes de Timer3: parte alta del tiempo de captura (solo ISR_Alta).
+unsigned long sensorUltimoFlanco;       // Tiempo (32 bits, ticks de Timer3) del ?ltimo flanco aceptado (solo la ISR).
+
+
+// ============================== TECLADO MATRICIAL ==============================
+
+#if USA_TECLADO
+#define TECLA_OK 3                      // ?ndices de LibTecladoXC8.h (fila * 4 + columna) de las teclas que no son d?gitos.
+#define TECLA_EMERGENCIA 7
+#define TECLA_SUPR 11
+#define TECLA_REINICIO 12
+#define TECLA_FIN 14
+#define TECLA_LUZ 15
+#define NO_DIGITO 0xFF
+
+const unsigned char teclaDigito[16] = { // D?gito de cada tecla seg?n su ?ndice (NO_DIGITO para las de funci?n).
+    1, 2, 3, NO_DIGITO,
+    4, 5, 6, NO_DIGITO,
+    7, 8, 9, NO_DIGITO,
+    NO_DIGITO, 0, NO_DIGITO, NO_DIGITO
+};
+#endif
+
 
 // ============================== PROTOTIPOS DE FUNCIONES ==============================
 
-void __interrupt() ISR(void);           // Prototipo de la rutina de interrupciones: aqu? se atienden Timer0, Timer1, cambio en PORTB y recepci?n serial.
+void __interrupt(high_priority) ISR_Alta(void); // Prototipo: alta prioridad, los flancos que no pueden esperar (sensor en CCP2/Timer3, recepci?n serial, bot?n en INT0 y tecla de parada).
+void __interrupt(low_priority) ISR(void); // Prototipo: baja prioridad, Timer0 (con el barrido del teclado), Timer1, ADC, EEPROM y transmisi?n.
 
 void ConfigVariables(void);             // Prototipo: funci?n que deja todas las variables en valores iniciales (estado conocido).
 void Bienvenida(void);                  // Prototipo: funci?n que inicializa LCD y muestra mensaje de bienvenida con estrella.
-void PreguntaAlUsuario(void);           // Prototipo: funci?n que pide al usuario la meta por teclado y no sale hasta tener un valor v?lido.
-void ConfigPregunta(void);              // Prototipo: arma el n?mero de dos d?gitos del objetivo a partir de teclas presionadas.
+void PreguntaAlUsuario(void);           // Prototipo: muestra la pregunta del objetivo y habilita la digitaci?n (TareaUI revisa el OK).
+unsigned char ObjetivoValido(void);     // Prototipo: revisa el objetivo al presionar OK (1 = v?lido; si no, deja el mensaje de error).
+void IniciaConteo(void);                // Prototipo: pantalla de faltantes/objetivo y arranque del conteo.
+void ConfigPregunta(void);              // Prototipo: arma el n?mero del objetivo (hasta 5 d?gitos) a partir de teclas presionadas.
 void Borrar(void);                      // Prototipo: borra la meta escrita (cuando el usuario presiona SUPR).
 
-unsigned int Conversion(unsigned char); // Prototipo: realiza una conversi?n ADC en el canal dado y retorna el resultado.
-void putch(char);                       // Prototipo: funci?n necesaria para que printf env?e caracteres por UART (USART).
+void AtiendeSerial(void);               // Prototipo: procesa desde main los bytes recibidos y la telemetr?a pendiente.
+void EjecutaComando(void);              // Prototipo: interpreta una l?nea completa (SET TARGET n, GET COUNT, MOTOR ON, ...).
+unsigned char EsComando(const char *);  // Prototipo: compara lineaComando con un texto fijo.
+void ReiniciaConteo(void);              // Prototipo: deja el conteo en cero y actualiza faltantes/7 segmentos.
+void MuestraEmergencia(void);           // Prototipo: pantalla de parada de emergencia y bloqueo hasta reset (desde main, no desde la ISR).
+#if USA_TECLADO
+void AtiendeTeclado(void);              // Prototipo: ejecuta desde main las teclas que dej? en cola el barrido de la ISR.
+#endif
+void ReportaTarea(unsigned char);       // Prototipo: responde GET TASK n con las medidas de la tarea.
+void ReportaMedicion(unsigned char);    // Prototipo: responde GET ISR n con las medidas de una rama de la ISR.
+void TareaUI(void);                     // Prototipo: m?quina de estados de la pantalla (bienvenida, pregunta, conteo, cumplida).
+void TareaConteo(void);                 // Prototipo: suma las piezas que acept? la ISR del sensor.
+void TareaMotor(void);                  // Prototipo: decisi?n del motor con el ADC filtrado cada 250 ms.
+#if USA_TELEMETRIA
+void TareaTelemetria(void);             // Prototipo: trama de telemetr?a con la ?ltima lectura del ADC.
+#endif
+void TareaLed(void);                    // Prototipo: parpadeo del LED de operaci?n.
+#if USA_BITACORA
+void TareaBitacora(void);               // Prototipo: guarda el conteo en la bit?cora de EEPROM si cambi?.
+unsigned char RecuperaConteo(void);     // Prototipo: retoma el conteo de la bit?cora despu?s de una falla de energ?a.
+#endif
+void ApagaBuzzer(void);                 // Prototipo: tarea de una sola vez que apaga el buzzer.
+void CambiaUI(unsigned char, unsigned int); // Prototipo: pasa TareaUI a otro estado despu?s de n ticks.
+void CuentaPieza(void);                 // Prototipo: suma una pieza (7 segmentos, RGB, faltantes, aviso de decena).
+void PosicionaConteo(void);             // Prototipo: unidades, color y resto a partir de piezasTotalesContadas (saltos del conteo).
+void DibujaConteo(void);                // Prototipo: escribe faltantes y objetivo con los d?gitos del objetivo.
+unsigned int EscalaRGB(unsigned int);   // Prototipo: piezas por color para que los 6 colores cubran el objetivo.
+unsigned char Digitos(unsigned int);    // Prototipo: cu?ntos d?gitos tiene un n?mero (1 a 5).
+void DibujaPagina(void);                // Prototipo: dibuja la p?gina del conteo que eligi? OK (conteo o estad?sticas).
+#if USA_ESTADISTICA
+void TareaEstadistica(void);            // Prototipo: segundo de las estad?sticas y refresco de su p?gina.
+void ReportaEstadistica(void);          // Prototipo: responde GET STATS.
+void ReportaHistograma(void);           // Prototipo: responde GET HIST.
+#endif
+void TareaEnergia(void);                // Prototipo: cada segundo elige el nivel de consumo y estima la corriente.
+unsigned char PuedeDormir(void);        // Prototipo: 1 si en Sleep no se pierde nada (sin lote, sin bytes por enviar, ...).
+void Duerme(void);                      // Prototipo: entra a Sleep desde main y vuelve (teclado o serial).
+void IniciaBuzzer(unsigned char);       // Prototipo: enciende el buzzer por n ticks de 10 ms sin bloquear.
+void RespondeCampo(unsigned int);       // Prototipo: un espacio y un n?mero en la respuesta serial (lo que era " %u" en printf).
+void RespondeCampo32(unsigned long);    // Prototipo: lo mismo con 32 bits (" %lu").
 
 
 // ============================== FUNCI?N PRINCIPAL ==============================
 
 void main(void){                        // Inicio del programa principal.
 
+    OSCCON = RELOJ_OSCCON;              // Frecuencia del INTOSC (o el oscilador primario con PLL) de ConfigReloj.h, antes de cualquier retardo.
+    HAL_RELOJ();                        // En el simulador (make host) fija la misma frecuencia.
+
     ConfigVariables();                  // Inicializa variables globales (contadores, banderas, etc.) para arrancar en estado limpio.
     modoEdicionObjetivo = 0;            // Asegura que NO se pueda escribir objetivo hasta que se entre expl?citamente a PreguntaAlUsuario.
     rxByte = 0;                         // Inicializa el ?ltimo byte recibido a 0 (sin comando recibido todav?a).
@@ -95,40 +293,43 @@ void main(void){                        // Inicio del programa principal.
                                         // Bit ADON=1 -> m?dulo ADC encendido.
                                         // CHS bits en 0 -> canal AN0 seleccionado (t?picamente RA0).
 
-    ADCON2 = 0b10001000;                // ADCON2: formato del resultado y temporizaci?n.
+    ADCON2 = 0b10001000 | RELOJ_ADCS;   // ADCON2: formato del resultado y temporizaci?n.
                                         // ADFM=1 (bit7) -> resultado justificado a la derecha (m?s c?modo para leer como n?mero normal).
-                                        // ACQT y ADCS ajustan tiempo de adquisici?n y reloj del ADC (tu valor define una combinaci?n espec?fica).
+                                        // ACQT y ADCS ajustan tiempo de adquisici?n y reloj del ADC (ADCS de ConfigReloj.h: TAD de al menos 0.8 us).
+                                        // ACQT=2 TAD deja que GO_DONE arranque la conversi?n sin esperar despu?s de cambiar de canal.
+
+    Adc_Inicia();                       // Ronda de canales vac?a y ADIE=1: el resultado llega por interrupci?n, nadie espera GO_DONE.
+    Adc_Agrega(0);                      // AN0 (RA0): ?nico canal anal?gico del montaje (los dem?s AN son LCD, RGB y teclado). Es el ?ndice 0.
 
     // ===================== LED RGB EN PORTE (RE0, RE1, RE2) =====================
 
-    TRISE = 0;                          // TRIS=0 significa salida. Esto pone RE0, RE1, RE2 como SALIDAS para controlar el LED RGB.
-    LATE  = 0b00000111;                 // Estado inicial del RGB. Dependiendo de si tu LED es ?nodo com?n/c?todo com?n, 1 puede significar apagado o encendido.
+    RGB_TRIS = 0;                       // TRIS=0 significa salida. Esto pone RE0, RE1, RE2 como SALIDAS para controlar el LED RGB.
 
     // ===================== DISPLAY 7 SEGMENTOS EN PORTD =====================
 
-    TRISD = 0;                          // Puerto D como salida para manejar el display de 7 segmentos (o su decodificador).
-    LATD  = unidades7Seg;               // Muestra inicialmente el valor de unidades7Seg (normalmente 0 reci?n inicializado).
+    SIETE_SEG_TRIS = 0;                 // Puerto D como salida: RD0..RD3 al decodificador del 7 segmentos y RD4..RD7 al LCD.
+    Salida_Inicia();                    // RGB apagado (los bits en 1 lo apagan) y display en 0 sin tocar RD4..RD7.
 
     // ===================== LED DE OPERACI?N (RA1) =====================
 
-    TRISA1 = 0;                         // RA1 como salida digital (LED de operaci?n parpadeante).
-    LATA1  = 0;                         // LED inicialmente apagado.
+    LED_OPERACION_TRIS = 0;             // RA1 como salida digital (LED de operaci?n parpadeante).
+    LED_OPERACION  = 0;                 // LED inicialmente apagado.
 
     // ===================== BUZZER / LED DE AVISO (RA2) =====================
 
-    TRISA2 = 0;                         // RA2 como salida digital (buzzer o LED).
-    LATA2  = 0;                         // Inicialmente apagado.
+    BUZZER_TRIS = 0;                    // RA2 como salida digital (buzzer o LED).
+    BUZZER  = 0;                        // Inicialmente apagado.
 
     // ===================== CONTROL DEL LCD (seg?n tu librer?a) =====================
 
-    TRISA3 = 0;                         // RA3 como salida (en tu proyecto lo usas tambi?n como ?luz? o control de backlight, seg?n montaje).
-    LATA3  = 0;                         // Estado inicial en 0.
+    LUZ_TRIS = 0;                       // RA3 como salida (en tu proyecto lo usas tambi?n como ?luz? o control de backlight, seg?n montaje).
+    LUZ  = 0;                           // Estado inicial en 0.
     TRISA4 = 0;                         // RA4 como salida (frecuentemente pin RS del LCD en muchas librer?as; depende de tu configuraci?n interna).
 
     // ===================== MOTOR EN RC2 (NUEVO EN GU?A 5) =====================
 
-    TRISC2 = 0;                         // RC2 como salida digital: este pin enciende/apaga el motor (probablemente a trav?s de un transistor/driver).
-    LATC2  = 0;                         // Motor inicialmente apagado por seguridad.
+    MOTOR_TRIS = 0;                     // RC2 como salida: es la salida P1A del PWM de CCP1 hacia el transistor/driver del motor.
+    Motor_Inicia();                     // Timer2 a 1 kHz y CCP1 en PWM con ciclo ?til 0: motor inicialmente apagado por seguridad.
 
     // ===================== USART SERIAL (NUEVO EN GU?A 5) =====================
 
@@ -146,24 +347,96 @@ void main(void){                        // Inicio del programa principal.
                                         // CREN=1 habilita recepci?n continua.
 
     BAUDCON= 0b00001000;                // BAUDCON controla el generador de baud.
-                                        // BRG16=1 -> usa baud generator de 16 bits (SPBRGH:SPBRG). En tu caso no usas SPBRGH, pero dejas BRG16 activo.
-
-    SPBRG  = 25;                        // Valor del generador de baud para aproximar 9600 bps con Fosc=1MHz y BRGH=1.
-                                        // F?rmula t?pica: SPBRG = (Fosc/(4*BAUD)) - 1. Con 1MHz y 9600 da ~25.
+                                        // BRG16=1 -> usa baud generator de 16 bits (SPBRGH:SPBRG). A 48 MHz el valor ya no cabe en SPBRG.
+
+    SPBRGH = UART_SPBRG >> 8;           // Generador de baud para UART_BAUDIOS con BRGH=1 y BRG16=1 (LibUARTXC8.h lo calcula con _XTAL_FREQ).
+    SPBRG  = UART_SPBRG & 0xFF;         // F?rmula: SPBRGH:SPBRG = (Fosc/(4*BAUD)) - 1. Con 1 MHz da 25, con 8 MHz 207 y con 48 MHz 1249.
+
+    UART_IniciaTx();                    // Buffer de transmisi?n vac?o y TXIE=0: la ISR de TXIF solo se activa cuando hay bytes en cola.
+    UART_IniciaRx();                    // Cola de recepci?n vac?a.
+#if UART_AUTOBAUD
+    UART_AutoBaud();                    // El primer byte del otro lado (0x55, 'U') fija la velocidad: SPBRGH:SPBRG de arriba queda solo de partida.
+#endif
+    largoComando = 0;                   // Sin l?nea de comando en curso.
+    comandoDesbordado = 0;
+    rxInicioLinea = 1;                  // El primer byte que llegue se trata como inicio de l?nea.
+    rxLineaParada = 0;
+#if USA_TELEMETRIA
+    Telemetria_Inicia();                // La primera trama sale completa (conteo, objetivo y modo).
+#endif
+    Medicion_Inicia();                  // Tabla de GET ISR n en 0 (vac?a si no se compil? con MEDICION_ISR).
+    Energia_Inicia();                   // ENERGIA_ACTIVO y la carga estimada en 0.
+    luzAntesEspera = 0;
+
+#if USA_BITACORA
+    // ===================== BIT?CORA EN EEPROM (NUEVO) =====================
+
+    bitacoraValida = Bitacora_Inicia(); // Lee las 32 posiciones y deja en RAM el ?ltimo registro v?lido (se usa en TareaUI, UI_FIN_AVISO).
+    HLVDCON = HLVD_NIVEL;               // HLVD: avisa cuando VDD baja del nivel (VDIRMAG=0), antes del BOR. HLVDIE lo pone la rama de Timer1 cuando IRVST=1.
+#endif
+
+    // ===================== TECLADO EN PORTB =====================
+
+#if USA_TECLADO
+    TECLADO_TRIS = 0b11110000;          // Teclado matricial: RB0-RB3 salidas (filas), RB4-RB7 entradas (columnas).
+    TECLADO_FILAS   = 0b00000000;       // Inicializa filas en 0.
+    RBPU   = 0;                         // Activa pull-ups internos en PORTB (para columnas en 1 cuando no se presiona nada).
+    __delay_ms(100);                    // Delay de estabilizaci?n para que entradas no queden flotantes justo al arrancar (antes de arrancar
+                                        // Timer3, Timer0 y Timer1: a 48 MHz desbordar?an varias veces sin GIE).
+    Teclado_Inicia();                   // Filas en 0 y RBIE=1: una fila por tick de Timer0 y, entre barridos, cualquier tecla avisa a ISR_Alta.
+#endif
 
     // ===================== ENTRADA DEL SENSOR/PULSADOR DE CONTEO (RC1) =====================
 
-    TRISC1 = 1;                         // RC1 como entrada digital. Aqu? conectas sensor/pulsador que genera el evento de ?contar una pieza?.
+    SENSOR_TRIS = 1;                    // RC1 como entrada digital. Aqu? conectas sensor/pulsador que genera el evento de ?contar una pieza?.
+
+    T3CON  = 0b10001001 | (RELOJ_T3CKPS << 4); // Timer3 libre como base de tiempo de la captura: RD16=1, T3CCP2:T3CCP1=01 (Timer3 para CCP2,
+                                        // Timer1 para CCP1), prescaler de ConfigReloj.h (4 us por tick a 1 MHz), reloj interno, TMR3ON=1.
+    CCP2CON = 0b00000100;               // CCP2 en captura con cada flanco de bajada (llega una pieza: el sensor es activo en bajo).
+    sensorPulsos = 0;
+    sensorPulsosLeidos = 0;
+    sensorRebotes = 0;
+    t3Vueltas = 0;
+    sensorUltimoFlanco = 0;
+    CCP2IF = 0;
+    CCP2IE = 1;                         // Cada flanco entra a ISR_Alta: ah? se filtra el rebote y se cuenta la pieza.
+    TMR3IF = 0;
+    TMR3IE = 1;                         // Desborde de Timer3 cada 65536 ticks (262 ms a 1 MHz): extiende el tiempo de captura a 32 bits (tambi?n en ISR_Alta, junto a la captura).
 
     // ===================== BACKLIGHT LCD EN RA5 =====================
 
     TRISA5 = 0;                         // RA5 como salida digital para encender/apagar el backlight del LCD (seg?n tu circuito).
     LATA5  = 1;                         // Backlight inicialmente encendido (si tu l?gica es activa con 1). Esto depende de tu driver.
 
+    // ===================== TAREAS (NUEVO: PLANIFICADOR COOPERATIVO) =====================
+
+    Tareas_Inicia();                    // La tabla se llena antes de habilitar Timer0: la ISR la recorre en cada tick.
+    Tareas_Agrega(TAREA_SERIAL, AtiendeSerial, 1, 1);        // Cada tick: comandos recibidos y parada de emergencia.
+    Tareas_Agrega(TAREA_CONTEO, TareaConteo, 1, 1);          // Cada tick: piezas de la ISR del sensor.
+#if USA_TECLADO
+    Tareas_Agrega(TAREA_TECLADO, AtiendeTeclado, 1, 1);      // Cada tick: cola del teclado.
+#endif
+    Tareas_Agrega(TAREA_MOTOR, TareaMotor, TICKS_ADC, TICKS_ADC);
+#if USA_TELEMETRIA
+    Tareas_Agrega(TAREA_TELEMETRIA, TareaTelemetria, TICKS_ADC, TICKS_ADC + 1); // Un tick despu?s del ADC.
+#endif
+    Tareas_Agrega(TAREA_UI, TareaUI, 1, 1);
+    Tareas_Agrega(TAREA_BUZZER, ApagaBuzzer, TAREA_UNA_VEZ, 0); // La arma IniciaBuzzer().
+    Tareas_Agrega(TAREA_LED, TareaLed, TICKS_POR_SEGUNDO, TICKS_POR_SEGUNDO);
+#if USA_BITACORA
+    Tareas_Agrega(TAREA_BITACORA, TareaBitacora, TICKS_POR_SEGUNDO, TICKS_POR_SEGUNDO);
+#endif
+#if USA_ESTADISTICA
+    Tareas_Agrega(TAREA_ESTADISTICA, TareaEstadistica, TICKS_POR_SEGUNDO, TICKS_POR_SEGUNDO + 1);
+#endif
+    Tareas_Agrega(TAREA_ENERGIA, TareaEnergia, TICKS_POR_SEGUNDO, TICKS_POR_SEGUNDO + 2);
+    Tareas_Fondo(ServicioLCD);          // Sin tareas listas se manda un nibble al LCD; si el LCD est? al d?a la CPU queda en IDLE.
+    CambiaUI(UI_BIENVENIDA, 0);
+
     // ===================== CONFIGURACI?N DE INTERRUPCIONES =====================
 
     T0CON  = 0b00000001;                // Configura Timer0. Modo 16 bits + prescaler seg?n bits. Lo usas para parpadeo y tareas peri?dicas.
-    TMR0   = 3036;                      // Precarga Timer0 para que desborde aproximadamente cada cierto tiempo (en tu caso lo usas como ?tick?).
+    TMR0   = RELOJ_TMR0_RECARGA;        // Precarga Timer0 para que desborde cada 10 ms (tick del sistema y de las tareas).
     TMR0IF = 0;                         // Limpia bandera de interrupci?n de Timer0.
     TMR0IE = 1;                         // Habilita interrupci?n de Timer0.
     TMR0ON = 1;                         // Enciende Timer0.
@@ -171,365 +444,204 @@ void main(void){                        // Inicio del programa principal.
     T1CON  = 0b10110001;                // NUEVO: configura Timer1 para medir segundos de inactividad.
                                         // RD16=1 (lectura/escritura 16 bits), prescaler 1:8, reloj interno (Fosc/4), Timer1 ON.
 
-    TMR1   = 3036;                      // Valor inicial (precarga). En tu ISR realmente recargas con 34286 para aproximar 1 segundo (esa es la importante).
+    TMR1   = RELOJ_TMR1_RECARGA;        // Precarga: RELOJ_TMR1_VUELTAS desbordes son 1 segundo (34286 y una vuelta a 1 MHz).
+    t1Vueltas = 0;
     TMR1IF = 0;                         // Limpia bandera de Timer1.
     TMR1IE = 1;                         // Habilita interrupci?n de Timer1.
     TMR1ON = 1;                         // Enciende Timer1.
 
-    TRISB  = 0b11110000;                // Teclado matricial: RB0-RB3 salidas (filas), RB4-RB7 entradas (columnas).
-    LATB   = 0b00000000;                // Inicializa filas en 0.
-    RBPU   = 0;                         // Activa pull-ups internos en PORTB (para columnas en 1 cuando no se presiona nada).
-    __delay_ms(100);                    // Delay de estabilizaci?n para que entradas no queden flotantes justo al arrancar.
-    RBIF   = 0;                         // Limpia bandera de cambio en PORTB.
-    RBIE   = 1;                         // Habilita interrupci?n por cambio en RB4-RB7.
-
     RCIF   = 0;                         // Limpia bandera de recepci?n serial (RCIF) antes de empezar (seguridad).
     RCIE   = 1;                         // Habilita interrupci?n de recepci?n serial: cuando llegue un byte, entra a ISR.
 
-    PEIE   = 1;                         // Habilita interrupciones de perif?ricos (Timer0, Timer1, USART, etc.).
-    GIE    = 1;                         // Habilita interrupciones globales (si esto est? en 0, no entra a ISR).
-
-    // ===================== INICIO: LCD Y MENSAJES DE RESET (NUEVO EN GU?A 5) =====================
-
-    LATA3 = 1;                          // Enciende ?luz? asociada a RA3 (en tu montaje lo usas como indicador/backlight alterno).
-    Bienvenida();                       // Muestra el mensaje de bienvenida usando Estrella (car?cter CGRAM 0).
-
-    if(POR == 0){                       // NUEVO: revisa si el reset se asocia a Power-On Reset (POR). Este bit es una bandera del hardware del PIC.
-        POR = 1;                        // Limpia la bandera POR para futuras detecciones (no confundir eventos).
-        BorraLCD();                     // Limpia LCD.
-        OcultarCursor();                // Oculta cursor.
-        MensajeLCD_Var("    FALLA DE"); // Mensaje: primera l?nea.
-        DireccionaLCD(0xC0);            // Cursor al inicio de segunda l?nea.
-        MensajeLCD_Var("     ENERGIA"); // Mensaje: segunda l?nea.
-    }else{                              // Caso contrario: se interpreta como reset no-POR (por ejemplo reset manual).
-        BorraLCD();                     // Limpia LCD.
-        OcultarCursor();                // Oculta cursor.
-        MensajeLCD_Var("    RESET DE"); // Mensaje: primera l?nea.
-        DireccionaLCD(0xC0);            // Cursor a segunda l?nea.
-        MensajeLCD_Var("     USUARIO"); // Mensaje: segunda l?nea.
-    }
-
-    __delay_ms(1000);                   // Pausa para que el mensaje se vea 1 segundo.
-    LATA3 = 0;                          // Apaga ?luz? en RA3 despu?s del aviso.
+#if USA_PARADA_EXTERNA
+    BOTON_PARADA_TRIS = 1;              // RB0/INT0 entrada: el bot?n de parada va a tierra.
+    RBPU   = 0;                         // Pull-up interno de RB0 (sin bot?n presionado lee 1).
+    INTEDG0 = 0;                        // INT0 en el flanco de bajada (al presionar).
+    INT0IF = 0;
+    INT0IE = 1;                         // INT0 siempre es de alta prioridad.
+#endif
+
+    IPEN   = 1;                         // Dos niveles de prioridad: ISR_Alta interrumpe a ISR aunque est? a medias.
+    IPR1   = 0;                         // Todos los perif?ricos en baja prioridad (despu?s del reset est?n en alta)...
+    IPR2   = 0;
+    TMR0IP = 0;
+    RBIP   = 1;                         // ...menos el cambio en RB4..RB7 (la tecla de parada, Teclado_Cambio),
+    CCP2IP = 1;                         // el sensor, el desborde de Timer3 que completa su marca de tiempo
+    TMR3IP = 1;
+    RCIP   = 1;                         // y la recepci?n serial: la pieza y la l?nea "P" de parada no esperan a ninguna rama de ISR.
+    GIEL   = 1;                         // Habilita las de baja prioridad (con IPEN=1 este bit es el antiguo PEIE).
+    GIEH   = 1;                         // Habilita las de alta prioridad y el conjunto (el antiguo GIE: en 0 no entra ninguna).
+
+    LUZ = 1;                            // Enciende ?luz? asociada a RA3 (en tu montaje lo usas como indicador/backlight alterno). TareaUI la apaga despu?s del aviso de reset.
 
     // ===================== LOOP PRINCIPAL =====================
 
     while(1){                           // Bucle infinito: el sistema corre siempre.
+        Tareas_Ejecuta();               // Una tarea lista (la de mayor prioridad), o un paso del LCD, o IDLE hasta la pr?xima interrupci?n.
+    }
+}
 
-        PreguntaAlUsuario();            // Pide al usuario el objetivo con teclado (usa Marco, dos d?gitos + OK). Se queda aqu? hasta que salga con objetivo v?lido.
-        OcultarCursor();                // Oculta el cursor despu?s de terminar la digitaci?n.
-
-        MensajeLCD_Var("Faltantes: ");  // Muestra texto ?Faltantes:? en primera l?nea.
-        EscribeLCD_n8(piezasObjetivo - piezasTotalesContadas, 2); // Escribe cu?ntas faltan (2 d?gitos).
-        DireccionaLCD(0xC0);            // Salta a segunda l?nea.
-        MensajeLCD_Var("Objetivo: ");   // Muestra texto ?Objetivo:? en segunda l?nea.
-        EscribeLCD_n8(piezasObjetivo, 2); // Escribe el valor objetivo (2 d?gitos).
-
-        flagConteoActivo = 1;           // Activa el modo conteo: permite entrar al while interno de conteo.
-
-        while(flagConteoActivo == 1){  // Mientras estemos contando, se eval?an eventos (cumplir meta, pulsador RC1).
-
-            if(piezasTotalesContadas == piezasObjetivo){ // Caso: ya alcanzamos el objetivo.
-
-                LATA2 = 1;              // Activa buzzer/LED de aviso.
-                __delay_ms(1000);       // Mantiene 1 segundo para indicar ?cumplido?.
-                LATA2 = 0;              // Apaga buzzer/LED.
-
-                BorraLCD();             // Limpia pantalla.
-                MensajeLCD_Var("Cuenta Cumplida"); // Texto de ?xito.
-                DireccionaLCD(0xC0);    // Segunda l?nea.
-                MensajeLCD_Var("   Presione OK"); // Indicaci?n al usuario.
-
-                flagConteoActivo = 0;   // Sale del modo conteo (romper? el while interno).
-                teclaLeida = '\0';      // Limpia la tecla anterior.
-
-                while(teclaLeida != '*'){} // Espera hasta que el teclado mande '' (OK) a trav?s de la ISR del PORTB.
-
-                ConfigVariables();      // Reinicia variables para comenzar de nuevo desde cero.
-            }
-
-            if(RC1 == 0 && piezasTotalesContadas != piezasObjetivo){ // Si RC1 est? presionado (activo en bajo) y a?n no llegamos al objetivo.
-                segundosSinActividad = 0; // Se reinicia inactividad: porque el usuario/sensor est? generando actividad real.
-                pulsadorListo = 0;        // Marca que se detect? la bajada y ahora se espera la subida (antirrebote por flanco).
-            }
-
-            if(pulsadorListo == 0){       // Si estamos esperando la subida...
-                if(RC1 == 1){             // Si RC1 volvi? a 1, eso significa que se complet? un pulso v?lido (flanco de subida).
-
-                    pulsadorListo = 1;    // Se bloquea para no contar otra vez hasta una nueva bajada.
 
-                    unidades7Seg++;       // Aumenta las unidades del conteo (0?9) para el display.
-                    piezasTotalesContadas++; // Aumenta el total global de piezas.
+// ============================== ISR DE ALTA PRIORIDAD: SENSOR, PARADA Y RECEPCI?N ==============================
+// Solo bandera y cola: cada rama guarda el dato (marca de la pieza, byte recibido) y main hace el resto.
 
-                    if(unidades7Seg == 10){ // Si pasamos de 9 a 10, entonces se completa una decena.
+void __interrupt(high_priority) ISR_Alta(void){ // Entra aunque ISR est? a medias: la reacci?n no depende de lo que haga la de baja prioridad.
 
-                        LATA2 = 1;        // Aviso corto por decena.
-                        __delay_ms(300);  // Duraci?n del aviso.
-                        LATA2 = 0;        // Apaga aviso.
+    unsigned char datoRx;                // Byte recibido en esta interrupci?n (rxByte es de main, la ISR no lo toca).
+    unsigned long sensorMarca;           // Tiempo de la captura en 32 bits (vueltas de Timer3 : CCPR2).
 
-                        unidades7Seg = 0; // Reinicia unidades.
-                        decenasRGB++;     // Incrementa decenas, que se ?ver?n? por el color del RGB.
+    MEDICION_ENTRA_ALTA();
 
-                        if(decenasRGB == 6){ // Si llega a 6, se reinicia (porque tu esquema de colores/m?ximo era hasta 59).
+#if USA_PARADA_EXTERNA
+    if(INT0IF == 1){                     // Flanco de bajada en RB0: bot?n de parada de la estaci?n.
+        INT0IF = 0;
+        ParadaEmergencia(PARADA_BOTON);  // Salidas seguras aqu? mismo; pantalla y aviso por serial los hace main.
+    }
+#endif
 
-                            LATA2 = 1;    // Segundo aviso (opcional) que t? ten?as cuando reinicia.
-                            __delay_ms(300);
-                            LATA2 = 0;
+#if USA_TECLADO
+    if(RBIE == 1 && RBIF == 1){          // Cambi? una columna del teclado con las filas en reposo (el barrido apaga RBIE).
+        if(Teclado_Cambio(TECLA_EMERGENCIA) == 1 && paradaEmergencia == 0){ // Solo mira la fila de la tecla de parada: las dem?s esperan al barrido.
+            ParadaEmergencia(PARADA_TECLA);
+        }
+    }
+#endif
 
-                            decenasRGB = 0; // Reinicia decenas.
-                        }
-                    }
+    // ===================== INTERRUPCI?N POR RECEPCI?N SERIAL (ALTA PRIORIDAD) =====================
 
-                    if(decenasRGB == 0){
-                        LATE = 0b00000001; // Magenta (Rojo+Azul) seg?n tu conexi?n.
-                    }else if(decenasRGB == 1){
-                        LATE = 0b00000101; // Azul
-                    }else if(decenasRGB == 2){
-                        LATE = 0b00000100; // Cyan
-                    }else if(decenasRGB == 3){
-                        LATE = 0b00000110; // Verde
-                    }else if(decenasRGB == 4){
-                        LATE = 0b00000010; // Amarillo
-                    }else if(decenasRGB == 5){
-                        LATE = 0b00000000; // Blanco
-                    }
+    if(RCIF == 1){                       // RCIF=1 significa: lleg? un byte por UART al registro RCREG.
+        MEDICION_INICIO_ALTA();
+        datoRx = UART_RecibeISR();       // Lee RCREG (reiniciando CREN si hubo OERR) y lo deja en la cola; main lo interpreta despu?s.
+                                         // Un byte con error de trama llega como UART_RX_ERROR: no es 'P' ni fin de l?nea.
 
-                    DireccionaLCD(0x8B);      // Posiciona cursor donde est?s mostrando el n?mero de ?faltantes? en la primera l?nea.
-                    EscribeLCD_n8(piezasObjetivo - piezasTotalesContadas, 2); // Actualiza faltantes.
+        if(rxLineaParada == 1 && (datoRx == '\r' || datoRx == '\n')){ // L?nea "P" completa: PARADA DE EMERGENCIA inmediata.
+            ParadaEmergencia(PARADA_SERIAL); // Motor apagado ya mismo (sin rampa) y RGB en rojo; la pantalla la dibuja main (MuestraEmergencia).
+        }
+        rxLineaParada = (rxInicioLinea == 1 && (datoRx == 'P' || datoRx == 'p')); // Una 'P' suelta (ruido) no para: hace falta el fin de l?nea.
+        rxInicioLinea = (datoRx == '\r' || datoRx == '\n'); // Despu?s de un fin de l?nea empieza un comando nuevo.
+        segundosSinActividad = 0;        // Un comando por serial tambi?n es actividad (la estaci?n no se duerme mientras la usan por serial).
+        MEDICION_FIN_ALTA(MEDIR_RC);
+    }
 
-                    LATD = unidades7Seg;      // Actualiza el display de 7 segmentos con las unidades actuales.
+    // ===================== SENSOR DE PIEZAS: CAPTURA EN CCP2 =====================
 
-                    __delay_ms(500);          // Retardo adicional para que un pulso mec?nico no cuente varias veces (antirrebote extra).
-                }
-            }
+    if(CCP2IF == 1){                     // Flanco de bajada en RC1: CCPR2 tiene el valor de Timer3 en ese instante.
+        MEDICION_LATENCIA(MEDIR_LATENCIA_SENSOR, CCPR2); // Desde el flanco hasta aqu? (incluye entrar a ISR_Alta y las ramas de INT0 y de recepci?n).
+        MEDICION_INICIO_ALTA();
+        CCP2IF = 0;
+        sensorMarca = t3Vueltas;
+        if(TMR3IF == 1 && CCPR2 < 0x8000){ // Timer3 ya desbord? pero su rama (abajo) todav?a no corre: la captura es de la vuelta siguiente.
+            sensorMarca++;
         }
-
-        LATE = 0b00000010;                // Al salir del conteo, dejas el RGB en estado base (tu color ?reposo?).
-        LATD = unidades7Seg;              // Mantienes visualmente el ?ltimo valor en el 7 segmentos.
+        sensorMarca = (sensorMarca << 16) | CCPR2;
+        if(sensorMarca - sensorUltimoFlanco >= SENSOR_VENTANA){ // Pas? la ventana desde la ?ltima pieza: es una pieza nueva.
+            sensorUltimoFlanco = sensorMarca;
+#if USA_ESTADISTICA
+            sensorMarcas[sensorPulsos & (SENSOR_MARCAS - 1)] = sensorMarca; // Antes de avisar a main: cuando main ve la pieza el instante ya est?.
+#endif
+            sensorPulsos++;
+            segundosSinActividad = 0;    // Se reinicia inactividad: el sensor est? generando actividad real.
+        }else{
+            sensorRebotes++;             // Rebote del mismo flanco.
+        }
+        MEDICION_FIN_ALTA(MEDIR_SENSOR);
     }
-}
 
+    if(TMR3IF == 1){                     // Desborde de Timer3 (cada 65536 ticks), en la misma ISR que la captura: t3Vueltas nunca queda a medias para la rama CCP2.
+        MEDICION_INICIO_ALTA();
+        TMR3IF = 0;
+        t3Vueltas++;
+        MEDICION_FIN_ALTA(MEDIR_TMR3);
+    }
 
-// ============================== ISR (RUTINA DE INTERRUPCIONES) ==============================
+    MEDICION_SALE_ALTA(MEDIR_ISR_ALTA);
+}
 
-void __interrupt() ISR(void){            // Funci?n llamada autom?ticamente cuando ocurre una interrupci?n habilitada.
 
-    // ===================== NUEVO EN GU?A 5: INTERRUPCI?N POR RECEPCI?N SERIAL =====================
+// ============================== ISR DE BAJA PRIORIDAD (RUTINA DE INTERRUPCIONES) ==============================
 
-    if(RCIF == 1){                       // RCIF=1 significa: lleg? un byte por UART al registro RCREG.
-        if(RCSTAbits.OERR == 1){
-            RCSTAbits.CREN = 0;
-            RCSTAbits.CREN = 1;
-        }
+void __interrupt(low_priority) ISR(void){ // Funci?n llamada autom?ticamente cuando ocurre una interrupci?n habilitada de baja prioridad.
 
-        rxByte = RCREG;                  // Leer RCREG es obligatorio: ?consume? el byte recibido y limpia la condici?n de recepci?n.
+    MEDICION_ENTRA_ISR();                // Solo con MEDICION_ISR (LibMedicionXC8.h): si no, no genera c?digo.
 
-        if(rxByte == 'P' || rxByte == 'p'){ // Si por serial llega P/p, se interpreta como PARADA DE EMERGENCIA.
+    // ===================== TRANSMISI?N SERIAL: UN BYTE POR CADA TXIF =====================
 
-            paradaEmergencia = 1;
-            LATC2 = 0;
+    if(TXIE == 1 && TXIF == 1){          // TXIF=1 mientras TXREG est? libre; solo interesa si hay datos en cola (TXIE=1).
+        MEDICION_INICIO();
+        UART_ServicioTx();               // Carga el siguiente byte del buffer en TXREG y apaga TXIE si ya no queda nada.
+        MEDICION_FIN(MEDIR_TX);
+    }
 
-            LATE = 0b00000011;           // Coloca el RGB en rojo (seg?n tu configuraci?n f?sica del LED RGB).
-            BorraLCD();                  // Limpia pantalla.
-            OcultarCursor();             // Oculta cursor.
-            MensajeLCD_Var("   PARADA DE"); // Mensaje l?nea 1.
-            DireccionaLCD(0xC0);         // L?nea 2.
-            MensajeLCD_Var("   EMERGENCIA"); // Mensaje l?nea 2.
+    // ===================== ADC: FIN DE CONVERSI?N =====================
 
-            while(1){}                   // Bucle infinito: el sistema se ?detiene? hasta reset (seguridad).
-        }
-        else if(paradaEmergencia == 0 && (rxByte == 'E' || rxByte == 'e')){
+    if(ADIF == 1){                       // Termin? la conversi?n que arranc? el tick de Timer0.
+        MEDICION_INICIO();
+        Adc_ISR();                       // Suma la muestra, decima cada 16, actualiza el promedio y pasa al siguiente canal.
+        MEDICION_FIN(MEDIR_ADC);
+    }
 
-            ordenMotor = 1;
-            LATC2 = 1;
-        }
-        else if(paradaEmergencia == 0 && (rxByte == 'A' || rxByte == 'a')){
+#if USA_BITACORA
+    // ===================== EEPROM: FIN DE ESCRITURA DE UN BYTE =====================
 
-            ordenMotor = 2;
-            LATC2 = 0;
-        }
-        else if(flagConteoActivo == 1 && (rxByte == 'R' || rxByte == 'r')){ // Si llega R/r mientras cuentas, reinicia el conteo.
+    if(EEIF == 1){                       // Termin? un byte de la bit?cora (o main pidi? un registro nuevo).
+        MEDICION_INICIO();
+        Bitacora_ISR();                  // Escribe el siguiente byte: el conteo nunca espera los ~4 ms de la EEPROM.
+        MEDICION_FIN(MEDIR_EEPROM);
+    }
 
-            unidades7Seg = 0;            // Reinicia unidades a 0.
-            piezasTotalesContadas = 0;   // Reinicia conteo global a 0.
-            decenasRGB = 0;              // Reinicia decenas a 0.
-            LATE = 0b00000001;           // RGB vuelve a color de reposo.
+    // ===================== HLVD: LA TENSI?N EST? BAJANDO =====================
 
-            DireccionaLCD(0x8B);         // Posiciona donde van los faltantes.
-            EscribeLCD_n8(piezasObjetivo - piezasTotalesContadas, 2); // Actualiza faltantes (ahora ser? igual al objetivo).
-            LATD = unidades7Seg;         // Display vuelve a 0.
-        }
+    if(HLVDIE == 1 && HLVDIF == 1){      // VDD baj? de HLVD_NIVEL: puede venir un corte.
+        HLVDIE = 0;                      // Una vez: la rama de Timer1 la vuelve a armar (a lo sumo un aviso por segundo).
+        Bitacora_Urgente();              // Las piezas pendientes no esperan al minuto.
+        Tareas_Programa(TAREA_BITACORA, 1); // En el pr?ximo tick, no en el pr?ximo segundo.
     }
+#endif
 
-    // ===================== TIMER0: PARPADEO + ADC + PRINTF + CONTROL MOTOR =====================
+    // ===================== TIMER0: TICK DE 10 ms (TECLADO Y TAREAS) =====================
 
     if(TMR0IF == 1){                     // Si TMR0IF=1 es porque Timer0 desbord?.
-        TMR0 = 3036;                     // Recarga Timer0 para mantener periodicidad.
+        MEDICION_INICIO();
+        TMR0 = RELOJ_TMR0_RECARGA;       // Recarga Timer0 para mantener periodicidad.
         TMR0IF = 0;                      // Limpia bandera para poder detectar el pr?ximo desborde.
 
-        LATA1 = LATA1 ^ 1;               // Toggle LED operaci?n (parpadeo).
-
-        adcValor = Conversion(0);        // NUEVO: lee el ADC canal 0 (AN0/RA0). Retorna ADRES.
-        printf("Valor del ADC:%d\r\n", adcValor); // NUEVO: env?a el valor por serial usando printf (putch se encarga del env?o).
-
-        if(paradaEmergencia == 0){
-            if(ordenMotor == 1){
-                LATC2 = 1;
-            }else if(ordenMotor == 2){
-                LATC2 = 0;
-            }else{
-                if(adcValor >= 511){
-                    LATC2 = 1;
-                }else{
-                    LATC2 = 0;
-                }
-            }
-        }else{
-            LATC2 = 0;
+#if USA_TECLADO
+        Teclado_Escanea();               // Una fila del teclado por tick: las teclas quedan en cola y las ejecuta main (AtiendeTeclado).
+        if(Teclado_Presionada(TECLA_EMERGENCIA) == 1 && paradaEmergencia == 0){ // Respaldo si ISR_Alta no vio el cambio (otra tecla de su columna abajo).
+            ParadaEmergencia(PARADA_TECLA); // Igual que 'P' por serial: la pantalla la dibuja main.
         }
+#endif
+
+        Motor_Rampa();                   // Acerca el PWM del motor a la decisi?n de main (5 % por tick).
+        Adc_Dispara();                   // Una conversi?n por tick: 16 ticks (160 ms) por cada valor de 12 bits.
+        Tareas_Tick();                   // Marca como listas las tareas a las que se les cumpli? el periodo (el trabajo lo hace main).
+        MEDICION_FIN(MEDIR_TMR0);
     }
 
-    // ===================== TIMER1: INACTIVIDAD + BACKLIGHT + SLEEP (NUEVO EN GU?A 5) =====================
+    // ===================== TIMER1: SEGUNDOS DE INACTIVIDAD (NUEVO EN GU?A 5) =====================
 
     if(TMR1IF == 1){                     // Si TMR1IF=1, Timer1 desbord? (tick de inactividad).
-        TMR1 = 34286;                    // Precarga para aproximar 1 segundo (seg?n Fosc y prescaler); esto es el ?segundo? de tu contador de inactividad.
+        MEDICION_INICIO();
+        TMR1 = RELOJ_TMR1_RECARGA;       // Precarga de ConfigReloj.h; esto es el ?segundo? de tu contador de inactividad.
         TMR1IF = 0;                      // Limpia bandera.
 
-        segundosSinActividad++;          // Incrementa contador de segundos sin actividad.
-
-        if(segundosSinActividad == 30){  // Si pasan 10 s sin actividad...
-            LATA3 = 0;                   // Apaga la ?luz/backlight? controlada por RA3 (seg?n tu montaje).
-        }
-
-        if(segundosSinActividad >= 60){  // Si pasan 20 s sin actividad...
-            Sleep();                     // Instrucci?n del PIC: entra en modo bajo consumo hasta que una interrupci?n lo despierte.
-
-            segundosSinActividad = 0;    // Al despertar, reinicia el conteo de inactividad.
-            RBIF = 0;                    // Limpia bandera del teclado (si despert? por ah?).
-            TMR1ON = 1;                  // Asegura que Timer1 vuelva a correr tras el sleep.
-        }
-    }
-
-    // ===================== TECLADO MATRICIAL: CAMBIO EN PORTB (MISMO ESQUEMA GU?A 4) =====================
-
-    if(RBIF == 1){                       // RBIF=1 indica cambio en RB4-RB7 (columnas), t?pico cuando se presiona una tecla.
-        if(PORTB != 0b11110000){         // Verifica que haya una tecla real presionada (no todo en 1).
-
-            segundosSinActividad = 0;    // Como hubo interacci?n, reinicia inactividad.
-
-            LATB = 0b11111110;           // Activa fila 1 (RB0=0).
-            if(RB4 == 0){                // Columna 1 presionada con fila 1 activa -> tecla '1'
-                teclaLeida = 1;          // Guarda 1.
-                ConfigPregunta();        // Construye objetivo si estamos en modo edici?n.
+        t1Vueltas++;
+        if(t1Vueltas >= RELOJ_TMR1_VUELTAS){ // Con reloj r?pido el segundo son varios desbordes (1 a 1 MHz).
+            t1Vueltas = 0;
+            if(segundosSinActividad != 255){ // Incrementa contador de segundos sin actividad (se queda en 255).
+                segundosSinActividad++;  // La luz y el Sleep los decide TareaEnergia desde main: la ISR ya no duerme.
             }
-            else if(RB5 == 0){           // Tecla '2'
-                teclaLeida = 2;
-                ConfigPregunta();
+#if USA_BITACORA
+            if(HLVDIE == 0 && IRVST == 1){ // HLVD estable (o ya se atendi? el aviso anterior): se vuelve a armar una vez por segundo.
+                HLVDIF = 0;
+                HLVDIE = 1;
             }
-            else if(RB6 == 0){           // Tecla '3'
-                teclaLeida = 3;
-                ConfigPregunta();
-            }
-            else if(RB7 == 0){           // Tecla OK
-                teclaLeida = '*';        // '' se usa como ?confirmar?.
-            }
-            else{
-                LATB = 0b11111101;       // Activa fila 2 (RB1=0).
-                if(RB4 == 0){            // Tecla '4'
-                    teclaLeida = 4;
-                    ConfigPregunta();
-                }
-                else if(RB5 == 0){       // Tecla '5'
-                    teclaLeida = 5;
-                    ConfigPregunta();
-                }
-                else if(RB6 == 0){       // Tecla '6'
-                    teclaLeida = 6;
-                    ConfigPregunta();
-                }
-                else if(RB7 == 0){       // Parada de emergencia por teclado.
-
-                    LATE = 0b00000110;   // RGB rojo.
-                    BorraLCD();
-                    OcultarCursor();
-                    MensajeLCD_Var("   PARADA DE");
-                    DireccionaLCD(0xC0);
-                    MensajeLCD_Var("   EMERGENCIA");
-                    while(1){}
-                }
-                else{
-                    LATB = 0b11111011;   // Activa fila 3 (RB2=0).
-                    if(RB4 == 0){        // Tecla '7'
-                        teclaLeida = 7;
-                        ConfigPregunta();
-                    }
-                    else if(RB5 == 0){   // Tecla '8'
-                        teclaLeida = 8;
-                        ConfigPregunta();
-                    }
-                    else if(RB6 == 0){   // Tecla '9'
-                        teclaLeida = 9;
-                        ConfigPregunta();
-                    }
-                    else if(RB7 == 0){   // SUPR
-                        Borrar();        // Borra objetivo si se est? editando.
-                    }
-                    else{
-                        LATB = 0b11110111; // Activa fila 4 (RB3=0).
-                        if(RB4 == 0){      // REINICIO de conteo.
-
-                            unidades7Seg = 0;
-                            piezasTotalesContadas = 0;
-                            decenasRGB = 0;
-                            LATE = 0b00000001;
-
-                            if(flagConteoActivo == 1){
-                                DireccionaLCD(0x8B);
-                                EscribeLCD_n8(piezasObjetivo - piezasTotalesContadas, 2);
-                                LATD = unidades7Seg;
-                            }
-                        }
-                        else if(RB5 == 0){ // Tecla '0'
-                            teclaLeida = 0;
-                            ConfigPregunta();
-                        }
-                        else if(RB6 == 0){ // FIN: fuerza objetivo cumplido.
-
-                            Borrar();
-                            piezasTotalesContadas = piezasObjetivo;
-                            decenasRGB = piezasObjetivo / 10;
-                            unidades7Seg = piezasObjetivo - decenasRGB * 10;
-
-                          if(decenasRGB == 0){
-                        LATE = 0b00000001; // Magenta (Rojo+Azul) seg?n tu conexi?n.
-                    }else if(decenasRGB == 1){
-                        LATE = 0b00000101; // Azul
-                    }else if(decenasRGB == 2){
-                        LATE = 0b00000100; // Cyan
-                    }else if(decenasRGB == 3){
-                        LATE = 0b00000110; // Verde
-                    }else if(decenasRGB == 4){
-                        LATE = 0b00000010; // Amarillo
-                    }else if(decenasRGB == 5){
-                        LATE = 0b00000000; // Blanco
-                    }
-
-                            LATD = unidades7Seg;
-                        }
-                        else if(RB7 == 0){ // LUZ: toggle RA3 manual.
-                            LATA3 = LATA3 ^ 1;
-                            TMR1ON = 1;
-                        }
-                    }
-                }
-            }
-
-            LATB = 0b11110000;           // Restablece filas a estado ?inactivo?.
+#endif
         }
-
-        __delay_ms(300);                 // Antirrebote del teclado (evita m?ltiples lecturas por una sola pulsaci?n).
-        RBIF = 0;                        // Limpia bandera para permitir nuevas interrupciones por teclado.
+        MEDICION_FIN(MEDIR_TMR1);
     }
+
+    MEDICION_SALE_ISR(MEDIR_ISR);
 }
 
 
@@ -537,11 +649,14 @@ void __interrupt() ISR(void){            // Funci?n llamada autom?ticamente cuan
 
 void ConfigVariables(void){             // Funci?n de inicializaci?n de variables globales.
 
-    pulsadorListo = 1;                  // Estado inicial: listo para detectar nueva pulsaci?n en RC1.
     unidades7Seg = 0;                   // Unidades del display en 0.
     flagConteoActivo = 0;               // No estamos contando al inicio.
     piezasTotalesContadas = 0;          // Conteo total en 0.
     decenasRGB = 0;                     // Decenas en 0.
+    escalaRGB = 10;                     // Un color por decena hasta que haya objetivo.
+    restoEscalaRGB = 0;
+    digitosObjetivo = 2;
+    fallaEnergia = 0;                   // Se decide en el aviso de reset (POR/BOR).
     indiceDigitoObjetivo = 0;           // Primer d?gito al iniciar digitaci?n.
     piezasObjetivo = 0;                 // Objetivo inicial vac?o.
     teclaLeida = '\0';                  // Sin tecla v?lida al inicio.
@@ -556,11 +671,13 @@ void ConfigVariables(void){             // Funci?n de inicializaci?n de variable
 
 void Bienvenida(void){                  // Mensaje inicial en el LCD.
 
-    ConfiguraLCD(4);                    // Configura LCD en modo 4 bits (menos pines).
+    HAL_LCD();                          // En el simulador: el bus del LCD est? en LCD_PUERTO.
+    ConfiguraLCD(LCD_BUS);              // 4 bits (menos pines, comparte PORTD con el 7 segmentos) u 8 bits en el puerto B seg?n ConfigLCD.h.
     InicializaLCD();                    // Inicializa LCD (secuencia de arranque interna del controlador HD44780 o similar).
     OcultarCursor();                    // Oculta cursor para est?tica.
 
     CrearCaracter(Estrella, 0);         // Guarda el car?cter ?Estrella? en CGRAM posici?n 0.
+    CrearCaracter(Marco, 1);            // Guarda el car?cter ?Marco? en CGRAM posici?n 1 (una sola vez: la CGRAM no se borra).
 
     // Mensaje en pantalla con estrellas decorativas
     EscribeLCD_c(0); 
@@ -578,104 +695,816 @@ void Bienvenida(void){                  // Mensaje inicial en el LCD.
     MensajeLCD_Var("  Operario ");
     EscribeLCD_c(0);
     EscribeLCD_c(0);
-    __delay_ms(4200);                   // Pausa para que el usuario lo vea.
+    // La pausa de 4.2 s y la animaci?n de desplazamiento las lleva TareaUI sin __delay_ms.
+}
+
+void PreguntaAlUsuario(void){           // Pide al usuario el objetivo a contar. Solo dibuja: TareaUI espera el OK.
+
+    unsigned char i;
 
-    for(int i = 0; i < 18; i++){        // Loop de animaci?n: desplaza pantalla a la derecha.
-        DesplazaPantallaD();            // Comando del LCD para desplazar todo el display.
-        __delay_ms(100);                // Retardo entre desplazamientos para ver la animaci?n.
+    indiceDigitoObjetivo = 0;           // Arranca digitaci?n en el primer d?gito.
+
+    BorraBufLCD();                      // Limpia pantalla.
+    MensajeBufLCD(0x80, "Piezas a contar:"); // Mensaje de solicitud.
+    for(i = 0; i < OBJETIVO_DIGITOS; i++){
+        EscribeBufLCD_c(OBJETIVO_CELDA + i, 1); // Un Marco por d?gito posible.
     }
+    CursorBufLCD(OBJETIVO_CELDA, 1);    // Muestra cursor en el primer d?gito para indicar ?puedes escribir?.
+
+#if USA_TECLADO
+    Teclado_Vacia();                    // Lo que se presion? antes de mostrar la pregunta (por ejemplo durante "Try again") no cuenta.
+#endif
+    modoEdicionObjetivo = 1;            // Activa modo edici?n: ConfigPregunta() ahora s? modifica piezasObjetivo.
+                                        // Las teclas num?ricas las procesa AtiendeTeclado(), que llama ConfigPregunta().
+}
+
+unsigned char ObjetivoValido(void){     // Se llama cuando lleg? OK (tecla o SET TARGET).
+
+    if(piezasObjetivo == 0){            // Sin d?gitos o en cero (el m?ximo ya lo cuida ConfigPregunta: nunca pasa de OBJETIVO_MAX).
+
+        modoEdicionObjetivo = 0;        // Desactiva edici?n.
+        teclaLeida = '\0';              // Limpia tecla.
+        piezasObjetivo = 0;             // Borra el objetivo armado.
+
+        BorraBufLCD();                  // Limpia pantalla (y oculta cursor).
+        MensajeBufLCD(0x80, "Error");   // Mensaje neutro (no ?ERROR?).
+        MensajeBufLCD(0xC0, "Try again"); // Indicaci?n simple. TareaUI lo deja 2 s y vuelve a preguntar.
+        return 0;
+    }
+
+    modoEdicionObjetivo = 0;            // Desactiva edici?n: ya no se aceptan n?meros para objetivo.
+    indiceDigitoObjetivo = 0;           // Reinicia ?ndice por limpieza.
+    BorraBufLCD();                      // Limpia pantalla para empezar conteo.
+    teclaLeida = '\0';                  // Limpia tecla.
+    return 1;
+}
+
+void IniciaConteo(void){                // Pantalla de conteo y arranque (antes en el while(1) de main).
+
+    CursorBufLCD(0x80, 0);              // Oculta el cursor despu?s de terminar la digitaci?n.
+
+    escalaRGB = EscalaRGB(piezasObjetivo); // Objetivo <= 59: un color por decena, como antes.
+    paginaConteo = PAGINA_CONTEO;
+    DibujaConteo();
+#if USA_ESTADISTICA
+    Estadistica_Inicia();               // Las estad?sticas son del lote que empieza.
+#endif
+
+    sensorPulsosLeidos = sensorPulsos;  // Lo que pas? por el sensor antes de empezar no cuenta.
+    flagConteoActivo = 1;               // Activa el modo conteo: TareaConteo empieza a sumar piezas.
 }
 
-void PreguntaAlUsuario(void){           // Pide al usuario el objetivo a contar.
+void ConfigPregunta(void){              // Construye el objetivo de hasta OBJETIVO_DIGITOS d?gitos.
 
-    while(1){                           // Se repite hasta que el objetivo sea v?lido.
+    if(modoEdicionObjetivo == 0 || indiceDigitoObjetivo >= OBJETIVO_DIGITOS){
+        return;                         // No se est? pidiendo el objetivo o ya est?n todos los d?gitos.
+    }
+    if(piezasObjetivo > (OBJETIVO_MAX - teclaLeida) / 10){
+        return;                         // Con este d?gito pasar?a de 65535: se ignora (sin desbordar, en 16 o 32 bits).
+    }
+
+    EscribeBufLCD_c(OBJETIVO_CELDA + indiceDigitoObjetivo, teclaLeida + '0'); // Escribe el d?gito en el LCD (solo RAM: ServicioLCD lo dibuja despu?s).
+    piezasObjetivo = piezasObjetivo * 10 + teclaLeida; // Corre lo anterior una posici?n y suma el d?gito nuevo.
+    indiceDigitoObjetivo++;             // Avanza al siguiente d?gito.
+    if(indiceDigitoObjetivo < OBJETIVO_DIGITOS){
+        CursorBufLCD(OBJETIVO_CELDA + indiceDigitoObjetivo, 1); // El cursor pasa al siguiente marco.
+    }else{
+        CursorBufLCD(OBJETIVO_CELDA, 0); // Oculta cursor porque ya se completaron los d?gitos.
+    }
+}
 
-        CrearCaracter(Marco, 1);        // Guarda el car?cter ?Marco? en CGRAM posici?n 1.
-        indiceDigitoObjetivo = 0;       // Arranca digitaci?n en el primer d?gito.
+void Borrar(void){                      // Borra el objetivo digitado.
 
-        BorraLCD();                     // Limpia pantalla.
-        MensajeLCD_Var("Piezas a contar:"); // Mensaje de solicitud.
-        DireccionaLCD(0xC7);            // Posiciona cursor en lugar de entrada (coordenada que t? elegiste).
-        EscribeLCD_c(1);                // Imprime primer Marco.
-        EscribeLCD_c(1);                // Imprime segundo Marco.
-        DireccionaLCD(0xC7);            // Cursor vuelve al inicio del primer d?gito.
-        MostrarCursor();                // Muestra cursor para indicar ?puedes escribir?.
+    unsigned char i;
 
-        modoEdicionObjetivo = 1;        // Activa modo edici?n: ConfigPregunta() ahora s? modifica piezasObjetivo.
+    if(modoEdicionObjetivo == 1){       // Solo borra si estamos en edici?n.
 
-        while(teclaLeida != '*'){       // Espera a que el usuario presione OK.
-                                        // Las teclas num?ricas se procesan en la ISR, que llama ConfigPregunta().
+        piezasObjetivo = 0;             // Reinicia valor objetivo.
+        indiceDigitoObjetivo = 0;       // Reinicia ?ndice a primer d?gito.
+        for(i = 0; i < OBJETIVO_DIGITOS; i++){
+            EscribeBufLCD_c(OBJETIVO_CELDA + i, 1); // Dibuja Marco.
         }
+        CursorBufLCD(OBJETIVO_CELDA, 1); // Muestra cursor en el primer d?gito para indicar que se puede reescribir.
+    }
+}
+
+void RespondeCampo(unsigned int valor){ // Las respuestas se arman con UART_Texto y estos campos: sin printf no se enlaza doprnt.
 
-        if((piezasObjetivo > 59) || (piezasObjetivo == 0)){ // Si el valor est? fuera de rango (mismo comportamiento de tu gu?a original).
+    UART_Texto(" ");
+    UART_Numero(valor);                 // Decimal sin ceros a la izquierda, sin divisiones (LibBCDXC8.h). Si el buffer est? lleno se descarta y se cuenta en uartTxDescartados.
+}
 
-            modoEdicionObjetivo = 0;    // Desactiva edici?n.
-            teclaLeida = '\0';          // Limpia tecla.
-            piezasObjetivo = 0;         // Borra el objetivo armado.
+void RespondeCampo32(unsigned long valor){
+
+    UART_Texto(" ");
+    UART_Numero32(valor);
+}
 
-            BorraLCD();                 // Limpia pantalla.
-            OcultarCursor();            // Oculta cursor.
-            MensajeLCD_Var("Error"); // Mensaje neutro (no ?ERROR?).
-            DireccionaLCD(0xC0);        // Segunda l?nea.
-            MensajeLCD_Var("Try again"); // Indicaci?n simple.
-            __delay_ms(2000);           // Tiempo para leer.
-            BorraLCD();                 // Limpia y vuelve a pedir.
+void AtiendeSerial(void){               // Tarea serial: vaciar la cola de recepci?n y atender la parada de emergencia.
+
+    while(UART_HayDato() == 1){         // Consume todo lo que la ISR dej? en la cola.
+        rxByte = UART_LeeDato();
+
+        if(rxByte == '\r' || rxByte == '\n'){ // Fin de l?nea: se ejecuta lo acumulado.
+            if(comandoDesbordado == 1){
+                UART_Texto("ERR\r\n");  // L?nea demasiado larga.
+            }else if(largoComando > 0){
+                lineaComando[largoComando] = '\0';
+                EjecutaComando();
+            }
+            largoComando = 0;
+            comandoDesbordado = 0;
+        }else if(largoComando < LARGO_COMANDO){
+            if(rxByte >= 'a' && rxByte <= 'z'){
+                rxByte = rxByte - 'a' + 'A'; // Los comandos no distinguen may?sculas/min?sculas.
+            }
+            lineaComando[largoComando] = rxByte;
+            largoComando++;
         }else{
+            comandoDesbordado = 1;
+        }
+    }
+
+    UART_ServicioCambio();              // SET BAUD: la velocidad cambia cuando ya sali? el OK.
+
+    if(paradaEmergencia == 1){          // La ISR ya dej? las salidas seguras; aqu? solo falta la pantalla.
+        MuestraEmergencia();
+    }
+
+}
+
+void EjecutaComando(void){              // Interpreta lineaComando (ya en may?sculas y terminada en '\0').
+
+    unsigned int valor;                 // N?mero le?do en SET TARGET o GET TASK, o rebotes de GET SENSOR.
+    unsigned long baudios;              // N?mero le?do en SET BAUD.
+    unsigned int brg;                   // SPBRGH:SPBRG de SET BAUD y GET BAUD.
+    unsigned char i;
+
+    if(EsComando("P") || EsComando("STOP")){ // Parada de emergencia (la l?nea "P" ya la atendi? ISR_Alta).
+        if(paradaEmergencia == 0){
+            ParadaEmergencia(PARADA_COMANDO);
+        }
+        UART_Texto("OK\r\n");
+    }
+    else if(paradaEmergencia == 0 && (EsComando("E") || EsComando("MOTOR ON"))){
+        ordenMotor = 1;                 // Motor forzado encendido.
+        Motor_Decide(adcValor, ordenMotor); // Los modos forzados no esperan la pr?xima decisi?n (la rampa s? corre).
+        UART_Texto("OK\r\n");
+    }
+    else if(paradaEmergencia == 0 && (EsComando("A") || EsComando("MOTOR OFF"))){
+        ordenMotor = 2;                 // Motor forzado apagado.
+        Motor_Decide(adcValor, ordenMotor);
+        UART_Texto("OK\r\n");
+    }
+    else if(paradaEmergencia == 0 && EsComando("MOTOR AUTO")){
+        ordenMotor = 0;                 // El motor vuelve a depender del umbral del ADC.
+        UART_Texto("OK\r\n");
+    }
+    else if(flagConteoActivo == 1 && (EsComando("R") || EsComando("RESET"))){
+        ReiniciaConteo();
+        UART_Texto("OK\r\n");
+    }
+    else if(EsComando("GET COUNT")){
+        UART_Texto("COUNT");
+        RespondeCampo(piezasTotalesContadas);
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("GET SENSOR")){   // SENSOR rebotes_descartados ventana_ms
+        GIE = 0;                        // sensorRebotes es de 16 bits y lo escribe ISR_Alta: se lee sin que entre en medio.
+        valor = sensorRebotes;
+        GIE = 1;
+        UART_Texto("SENSOR");
+        RespondeCampo(valor);
+        RespondeCampo(SENSOR_VENTANA_MS);
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("OK")){           // Igual que la tecla OK (la ?nica forma de confirmar en una estaci?n sin teclado).
+        teclaLeida = '*';
+        UART_Texto("OK\r\n");
+    }
+#if USA_ESTADISTICA
+    else if(EsComando("GET STATS")){
+        ReportaEstadistica();
+    }
+    else if(EsComando("GET HIST")){
+        ReportaHistograma();
+    }
+#endif
+    else if(EsComando("GET TARGET")){
+        UART_Texto("TARGET");
+        RespondeCampo(piezasObjetivo);
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("GET ADC")){
+        UART_Texto("ADC");
+        RespondeCampo(adcValor);
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("GET MOTOR")){
+        UART_Texto("MOTOR");
+        RespondeCampo(motorEncendido);  // Decisi?n,
+        RespondeCampo(ordenMotor);      // modo (0 auto, 1 forzado ON, 2 forzado OFF),
+        RespondeCampo(Motor_Porcentaje()); // ciclo ?til en %
+        RespondeCampo(motorConmutaciones); // y veces que cambi? la decisi?n.
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("GET POWER")){   // POWER nivel corriente_uA carga_mAs veces_dormido
+        UART_Texto("POWER");
+        RespondeCampo(energiaNivel);
+        RespondeCampo(energiaCorriente);
+        RespondeCampo32(energiaCarga);
+        RespondeCampo(energiaSuenos);
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("GET BAUD")){     // BAUD baudios_reales SPBRGH:SPBRG mediciones_de_auto-baud
+        brg = UART_LeeBRG();
+        UART_Texto("BAUD");
+        RespondeCampo32(UART_REALES(_XTAL_FREQ, (unsigned long)brg));
+        RespondeCampo(brg);
+        RespondeCampo(uartAutoBauds);
+        UART_Texto("\r\n");
+    }
+    else if(EsComando("SET BAUD AUTO")){ // El otro lado responde al OK cambiando de velocidad y mandando 0x55 ('U').
+        UART_Texto("OK\r\n");
+        UART_PideCambio(UART_CAMBIO_AUTO, 0);
+    }
+    else if(largoComando >= 13 && largoComando <= 15 && lineaComando[8] == ' '){ // Posible "SET BAUD n" (4 a 6 d?gitos).
 
-            modoEdicionObjetivo = 0;    // Desactiva edici?n: ya no se aceptan n?meros para objetivo.
-            indiceDigitoObjetivo = 0;   // Reinicia ?ndice por limpieza.
-            BorraLCD();                 // Limpia pantalla para empezar conteo.
-            teclaLeida = '\0';          // Limpia tecla.
-            break;                      // Sale del while(1) porque ya tenemos objetivo v?lido.
+        lineaComando[8] = '\0';
+        if(EsComando("SET BAUD") == 0){
+            UART_Texto("ERR\r\n");
+            return;
         }
+        baudios = 0;
+        for(i = 9; i < largoComando; i++){
+            if(lineaComando[i] < '0' || lineaComando[i] > '9'){
+                UART_Texto("ERR\r\n");
+                return;
+            }
+            baudios = baudios * 10 + (lineaComando[i] - '0');
+        }
+        if(UART_Divisor(baudios, &brg) == 0){ // M?s de UART_ERROR_MAX con este reloj (a 1 MHz, de 38400 en adelante).
+            UART_Texto("ERR\r\n");
+            return;
+        }
+        UART_Texto("OK\r\n");         // Sale a la velocidad actual: UART_ServicioCambio espera a que termine.
+        UART_PideCambio(UART_CAMBIO_BRG, brg);
+    }
+    else if((largoComando == 10 || largoComando == 11) && lineaComando[8] == ' '){ // "GET TASK n": medidas de la tarea n (uno o dos d?gitos).
+
+        lineaComando[8] = '\0';
+        valor = 0;
+        for(i = 9; i < largoComando; i++){
+            if(lineaComando[i] < '0' || lineaComando[i] > '9'){
+                UART_Texto("ERR\r\n");
+                return;
+            }
+            valor = valor * 10 + (lineaComando[i] - '0');
+        }
+        if(EsComando("GET TASK") == 0 || valor >= TAREAS_MAX){
+            UART_Texto("ERR\r\n");
+            return;
+        }
+        ReportaTarea((unsigned char)valor);
+    }
+    else if((largoComando == 9 || largoComando == 10) && lineaComando[7] == ' '){ // "GET ISR n": medidas de la rama n (MEDIR_..., uno o dos d?gitos).
+
+        lineaComando[7] = '\0';
+        valor = 0;
+        for(i = 8; i < largoComando; i++){
+            if(lineaComando[i] < '0' || lineaComando[i] > '9'){
+                UART_Texto("ERR\r\n");
+                return;
+            }
+            valor = valor * 10 + (lineaComando[i] - '0');
+        }
+        if(EsComando("GET ISR") == 0){
+            UART_Texto("ERR\r\n");
+            return;
+        }
+        ReportaMedicion((unsigned char)valor); // ERR si no existe (Medicion_Copia).
+    }
+    else if(largoComando > 11 && largoComando <= 16 && lineaComando[10] == ' '){ // Posible "SET TARGET n" (hasta 5 d?gitos).
+
+        lineaComando[10] = '\0';        // Separa la palabra clave del n?mero.
+        if(EsComando("SET TARGET") == 0){
+            UART_Texto("ERR\r\n");
+            return;
+        }
+        valor = 0;
+        for(i = 11; i < largoComando; i++){
+            if(lineaComando[i] < '0' || lineaComando[i] > '9' ||
+               valor > (OBJETIVO_MAX - (unsigned int)(lineaComando[i] - '0')) / 10){
+                UART_Texto("ERR\r\n");  // No es n?mero o se pasar?a de 65535: se revisa antes de multiplicar.
+                return;
+            }
+            valor = valor * 10 + (lineaComando[i] - '0');
+        }
+
+        if(valor == 0){                 // Mismo rango que acepta PreguntaAlUsuario() (1 a 65535).
+            UART_Texto("ERR\r\n");
+        }else if(modoEdicionObjetivo == 1){ // Se est? pidiendo el objetivo: equivale a digitarlo y presionar OK.
+            piezasObjetivo = valor;
+            EscribeBufLCD_n(OBJETIVO_CELDA, piezasObjetivo, Digitos(piezasObjetivo));
+            CursorBufLCD(OBJETIVO_CELDA, 0);
+            teclaLeida = '*';
+            UART_Texto("OK\r\n");
+        }else if(flagConteoActivo == 1 && valor >= piezasTotalesContadas){ // Cambio de meta en pleno conteo.
+            piezasObjetivo = valor;
+            escalaRGB = EscalaRGB(piezasObjetivo); // Con otra escala el color se recalcula desde el conteo.
+            PosicionaConteo();
+            DibujaPagina();
+            UART_Texto("OK\r\n");
+        }else{
+            UART_Texto("ERR\r\n");
+        }
+    }
+    else{
+        UART_Texto("ERR\r\n");          // Comando desconocido o no permitido en el estado actual.
     }
 }
 
-void ConfigPregunta(void){              // Construye el objetivo de dos d?gitos.
+unsigned char EsComando(const char *texto){ // Retorna 1 si lineaComando es exactamente igual a texto.
 
-    if(indiceDigitoObjetivo == 0 && modoEdicionObjetivo == 1){ // Primer d?gito (decenas).
+    unsigned char i;
 
-        EscribeLCD_n8(teclaLeida, 1);   // Escribe el d?gito en el LCD.
-        piezasObjetivo = teclaLeida;    // Guarda ese d?gito como base (por ejemplo: si presiona 3, objetivo temporal = 3).
+    for(i = 0; texto[i] != '\0'; i++){
+        if(lineaComando[i] != texto[i]){
+            return 0;
+        }
     }
-    else if(indiceDigitoObjetivo == 1 && modoEdicionObjetivo == 1){ // Segundo d?gito (unidades).
+    return (unsigned char)(lineaComando[i] == '\0');
+}
+
+void ReiniciaConteo(void){              // Equivale al antiguo comando 'R': vuelve a empezar el conteo en curso.
 
-        EscribeLCD_n8(teclaLeida, 1);   // Escribe el segundo d?gito en el LCD.
-        piezasObjetivo = piezasObjetivo * 10 + teclaLeida; // Forma el n?mero final: (decena*10 + unidad).
-        OcultarCursor();                // Oculta cursor porque ya se completaron los dos d?gitos.
+    unidades7Seg = 0;                   // Reinicia unidades a 0.
+    piezasTotalesContadas = 0;          // Reinicia conteo global a 0.
+    decenasRGB = 0;                     // Reinicia decenas a 0.
+    restoEscalaRGB = 0;
+
+    if(paginaConteo == PAGINA_CONTEO){
+        EscribeBufLCD_n(0x8B, piezasObjetivo - piezasTotalesContadas, digitosObjetivo); // Actualiza faltantes (ahora ser? igual al objetivo).
     }
+    Salida_Conteo(unidades7Seg, decenasRGB); // RGB al color de la decena 0 y display en 0.
+}
 
-    indiceDigitoObjetivo++;             // Avanza al siguiente d?gito (0->1->2...). Despu?s de 2, ya no deber?a seguir escribiendo.
+void MuestraEmergencia(void){           // Pantalla de parada de emergencia. Se llama desde main cuando paradaEmergencia=1.
+
+    Motor_Parada();                     // Refuerza motor apagado (la rampa de la ISR de Timer0 tambi?n lo mantiene en 0).
+    Salida_Alarma();                    // RGB en rojo (ya lo hizo ParadaEmergencia; una pieza contada despu?s no lo cambia).
+    UART_Texto("ESTOP");                // El aviso por serial sale de aqu?, no de la ISR.
+    RespondeCampo(paradaFuente);
+    UART_Texto("\r\n");
+    BorraBufLCD();                      // Limpia pantalla (y oculta cursor).
+    MensajeBufLCD(0x80, "   PARADA DE"); // Mensaje l?nea 1.
+    MensajeBufLCD(0xC0, "   EMERGENCIA"); // Mensaje l?nea 2.
+    VaciaBufLCD();                      // Se termina de dibujar antes de quedarse detenido.
+
+    while(1){                           // El sistema queda detenido hasta reset (la ISR sigue vaciando el buffer de transmisi?n).
+        HAL_ESPERA();
+    }
 }
 
-void Borrar(void){                      // Borra el objetivo digitado.
+void ReportaTarea(unsigned char i){     // TASK n ejecuciones ?ltima_us m?xima_us latencia_m?x_us perdidas
 
-    if(modoEdicionObjetivo == 1){       // Solo borra si estamos en edici?n.
+    UART_Texto("TASK");
+    RespondeCampo(i);
+    RespondeCampo(tareas[i].ejecuciones);
+    RespondeCampo32(TICKS_US(tareas[i].ultimo));
+    RespondeCampo32(TICKS_US(tareas[i].maximo));
+    RespondeCampo32(TICKS_US(tareas[i].latenciaMax));
+    RespondeCampo(tareas[i].perdidas);
+    UART_Texto("\r\n");
+}
 
-        MostrarCursor();                // Muestra cursor para indicar que se puede reescribir.
-        piezasObjetivo = 0;             // Reinicia valor objetivo.
-        indiceDigitoObjetivo = 0;       // Reinicia ?ndice a primer d?gito.
-        DireccionaLCD(0xC7);            // Cursor al lugar de entrada.
-        EscribeLCD_c(1);                // Dibuja Marco.
-        EscribeLCD_c(1);                // Dibuja Marco.
-        DireccionaLCD(0xC7);            // Cursor al primer d?gito.
+void ReportaMedicion(unsigned char i){  // ISR n veces ?ltimo_us m?nimo_us m?ximo_us (ERR si no se compil? con MEDICION_ISR).
+
+#ifdef MEDICION_ISR
+    Medicion copia;
+
+    if(Medicion_Copia(i, &copia) == 1){
+        UART_Texto("ISR");
+        RespondeCampo(i);
+        RespondeCampo(copia.veces);
+        RespondeCampo32(TICKS_US(copia.ultimo));
+        RespondeCampo32(TICKS_US(copia.minimo));
+        RespondeCampo32(TICKS_US(copia.maximo));
+        UART_Texto("\r\n");
+        return;
+    }
+#else
+    (void)i;                            // Sin MEDICION_ISR no hay tabla: siempre ERR.
+#endif
+    UART_Texto("ERR\r\n");
+}
+
+#if USA_TECLADO
+void AtiendeTeclado(void){              // Lo que antes hac?a la rama RBIF de la ISR, ahora desde main y sin __delay_ms(300).
+
+    unsigned char evento, tecla;
+
+    while(Teclado_HayEvento() == 1){
+        evento = Teclado_LeeEvento();
+        tecla = evento & TECLA_INDICE;
+        segundosSinActividad = 0;       // Como hubo interacci?n, reinicia inactividad.
+
+        if(evento & TECLA_MULTIPLE){    // Otra tecla ya estaba abajo: no se sabe cu?l quiso el usuario.
+            continue;
+        }
+        if(teclaDigito[tecla] != NO_DIGITO){ // D?gitos: la auto-repetici?n escribe el d?gito otra vez.
+            teclaLeida = teclaDigito[tecla];
+            ConfigPregunta();           // Construye objetivo si estamos en modo edici?n.
+        }
+        else if(tecla == TECLA_SUPR){   // SUPR (tambi?n con auto-repetici?n).
+            Borrar();                   // Borra objetivo si se est? editando.
+        }
+        else if(evento & TECLA_REPETIDA){ // OK, REINICIO, FIN y LUZ solo cuentan una vez por pulsaci?n.
+            continue;
+        }
+        else if(tecla == TECLA_OK){
+            teclaLeida = '*';           // '*' se usa como ?confirmar?.
+        }
+        else if(tecla == TECLA_REINICIO){ // REINICIO de conteo.
+            if(flagConteoActivo == 1){
+                ReiniciaConteo();
+            }else{
+                piezasTotalesContadas = 0;
+                PosicionaConteo();
+            }
+        }
+        else if(tecla == TECLA_FIN){    // FIN: fuerza objetivo cumplido.
+
+            Borrar();
+            piezasTotalesContadas = piezasObjetivo;
+            PosicionaConteo();
+        }
+        else if(tecla == TECLA_LUZ){    // LUZ: toggle RA3 manual.
+            LUZ = LUZ ^ 1;
+            TMR1ON = 1;
+        }
+        // TECLA_EMERGENCIA ya la atendi? la ISR (Teclado_Presionada).
+    }
+}
+#endif
+
+void CuentaPieza(void){                 // Suma una pieza aceptada por la ISR del sensor.
+
+    unidades7Seg++;                     // Aumenta las unidades del conteo (0?9) para el display.
+    piezasTotalesContadas++;            // Aumenta el total global de piezas (TareaConteo no pasa del objetivo: no desborda).
+
+    if(unidades7Seg == 10){             // Si pasamos de 9 a 10, entonces se completa una decena.
+        unidades7Seg = 0;               // Reinicia unidades.
+    }
+    restoEscalaRGB++;                   // Solo sumas y comparaciones por pieza: las divisiones quedan en PosicionaConteo.
+    if(restoEscalaRGB == escalaRGB){    // Se completa un paso de color (una decena, centena, ... seg?n el objetivo).
+        restoEscalaRGB = 0;
+        decenasRGB++;                   // Siguiente color del RGB.
+        IniciaBuzzer(30);               // Aviso corto por paso (300 ms) mientras se sigue contando.
+
+        if(decenasRGB == RGB_PASOS){    // Se usaron los 6 colores: vuelve al primero.
+            decenasRGB = 0;             // Reinicia decenas.
+            IniciaBuzzer(60);           // Los dos avisos seguidos que hab?a al reiniciar quedan como uno de 600 ms.
+        }
+    }
+
+    Salida_Conteo(unidades7Seg, decenasRGB); // Color de la decena y unidades en el mismo instante (tabla, sin if/else).
+    if(paginaConteo == PAGINA_CONTEO){  // En las p?ginas de estad?sticas los faltantes se dibujan al volver.
+        EscribeBufLCD_n(0x8B, piezasObjetivo - piezasTotalesContadas, digitosObjetivo); // Actualiza faltantes: solo cambia la RAM, ServicioLCD manda los d?gitos despu?s.
+    }
+}
+
+void PosicionaConteo(void){             // Para saltos del conteo (FIN, REINICIO, bit?cora, cambio de objetivo): lo que CuentaPieza llevar?a pieza a pieza.
+
+    unidades7Seg = piezasTotalesContadas % 10;
+    restoEscalaRGB = piezasTotalesContadas % escalaRGB;
+    decenasRGB = (piezasTotalesContadas / escalaRGB) % RGB_PASOS;
+    Salida_Conteo(unidades7Seg, decenasRGB);
+}
+
+void DibujaConteo(void){                // "Faltantes: n" y "Objetivo: n" con tantos d?gitos como el objetivo (faltantes nunca es mayor).
+
+    digitosObjetivo = Digitos(piezasObjetivo);
+    MensajeBufLCD(0x80, "Faltantes:      "); // Las 16 celdas: si el objetivo baj? de d?gitos no quedan restos.
+    EscribeBufLCD_n(0x8B, piezasObjetivo - piezasTotalesContadas, digitosObjetivo);
+    MensajeBufLCD(0xC0, "Objetivo:       ");
+    EscribeBufLCD_n(0xCA, piezasObjetivo, digitosObjetivo); // Justo despu?s de "Objetivo: ".
+}
+
+unsigned int EscalaRGB(unsigned int objetivo){ // 10 hasta 59, 100 hasta 599, 1000 hasta 5999 y 10000 desde 6000.
+
+    unsigned int escala;
+
+    escala = 10;
+    while(escala < 10000 && objetivo >= escala * RGB_PASOS){ // escala * 6 <= 60000: cabe en 16 bits.
+        escala = escala * 10;
+    }
+    return escala;
+}
+
+unsigned char Digitos(unsigned int n){  // 1 para 0..9, 2 para 10..99, ... 5 para 10000..65535.
+
+    unsigned char d;
+
+    d = 1;
+    while(n >= 10){
+        n = n / 10;
+        d++;
+    }
+    return d;
+}
+
+void IniciaBuzzer(unsigned char ticks){ // Enciende el buzzer; la tarea ApagaBuzzer lo apaga despu?s de ticks x 10 ms.
+
+    BUZZER = 1;
+    Tareas_Programa(TAREA_BUZZER, ticks); // Si ya estaba sonando, el aviso nuevo reemplaza el tiempo que faltaba.
+}
+
+void ApagaBuzzer(void){                 // Tarea de una sola vez.
+
+    BUZZER = 0;
+}
+
+void TareaLed(void){                    // Cada segundo.
+
+    LED_OPERACION = LED_OPERACION ^ 1;  // Toggle LED operaci?n (parpadeo).
+}
+
+#if USA_BITACORA
+void TareaBitacora(void){               // Cada segundo: las piezas de un minuto quedan en un solo registro (la EEPROM aguanta un n?mero limitado de escrituras).
+
+    if(estadoUI <= UI_FIN_AVISO){       // Durante la bienvenida el conteo a?n no se recuper?: no se pisa el ?ltimo registro.
+        return;
+    }
+    if(Bitacora_Guarda(piezasTotalesContadas, piezasObjetivo, flagConteoActivo) == 0 && bitacoraUrgente == 1){
+        Tareas_Programa(TAREA_BITACORA, 1); // Ocupada con el anterior tras un aviso del HLVD: se intenta en el pr?ximo tick, no en un segundo.
+    }
+}
+
+unsigned char RecuperaConteo(void){     // Retoma el conteo de la bit?cora. Retorna 1 si hab?a un lote v?lido en curso.
+
+    if(bitacoraValida == 0 || bitacoraEstado != 1 || bitacoraObjetivo == 0 || bitacoraConteo > bitacoraObjetivo){
+        return 0;                       // Sin lote en curso (o datos fuera de rango): se pide un objetivo nuevo.
+    }
+    piezasObjetivo = bitacoraObjetivo;
+    piezasTotalesContadas = bitacoraConteo;
+    escalaRGB = EscalaRGB(piezasObjetivo);
+    PosicionaConteo();                  // Display y color del conteo recuperado.
+    IniciaConteo();                     // Pantalla de faltantes/objetivo y flagConteoActivo = 1.
+    return 1;
+}
+#endif
+
+#if USA_ESTADISTICA
+void TareaEstadistica(void){            // Cada segundo: las estad?sticas solo suman tiempo durante un lote.
+
+    Estadistica_Segundo(flagConteoActivo);
+    if(estadoUI == UI_CONTEO && paginaConteo != PAGINA_CONTEO){
+        DibujaPagina();                 // Los valores cambian aunque no lleguen piezas (ritmo, tiempo parado).
+    }
+}
+#endif
+
+void DibujaPagina(void){                // Solo RAM del LCD: ServicioLCD manda lo que cambi?.
+
+#if USA_ESTADISTICA
+    if(paginaConteo == PAGINA_RITMO){
+        MensajeBufLCD(0x80, "Pz/min:         ");
+        EscribeBufLCD_n(0x8B, Estadistica_PorMinuto(), 5);
+        MensajeBufLCD(0xC0, "Promedio:     ms");
+        EscribeBufLCD_n(0xC9, Estadistica_Promedio(), 5);
+    }
+    else if(paginaConteo == PAGINA_INTERVALOS){
+        MensajeBufLCD(0x80, "Minimo:       ms");
+        EscribeBufLCD_n(0x89, estadMinimo, 5);
+        MensajeBufLCD(0xC0, "Maximo:       ms");
+        EscribeBufLCD_n(0xC9, estadMaximo, 5);
+    }
+    else if(paginaConteo == PAGINA_TIEMPOS){
+        MensajeBufLCD(0x80, "Marcha:        s");
+        EscribeBufLCD_n(0x89, estadMarcha, 5);
+        MensajeBufLCD(0xC0, "Parado:        s");
+        EscribeBufLCD_n(0xC9, estadParado, 5);
+    }
+    else{
+        DibujaConteo();
+    }
+#else
+    DibujaConteo();                     // Sin estad?sticas la ?nica p?gina es la del conteo.
+#endif
+}
+
+#if USA_ESTADISTICA
+void ReportaEstadistica(void){          // STATS pz/min prom_ms min_ms max_ms marcha_s parado_s
+
+    UART_Texto("STATS");
+    RespondeCampo(Estadistica_PorMinuto());
+    RespondeCampo(Estadistica_Promedio());
+    RespondeCampo(estadMinimo);
+    RespondeCampo(estadMaximo);
+    RespondeCampo(estadMarcha);
+    RespondeCampo(estadParado);
+    UART_Texto("\r\n");
+}
+
+void ReportaHistograma(void){           // HIST ancho_ms barra0 ... barra7 (en otra l?nea: las dos juntas no caben en los 64 bytes de transmisi?n).
+
+    unsigned char i;
+
+    UART_Texto("HIST");
+    RespondeCampo(ESTAD_BIN_MS);
+    for(i = 0; i < ESTAD_BINS; i++){
+        RespondeCampo(estadHistograma[i]);
+    }
+    UART_Texto("\r\n");
+}
+#endif
+
+void TareaEnergia(void){                // Cada segundo. Las entradas y salidas de cada nivel se hacen aqu?, no en la ISR.
+
+    unsigned char anterior, nivel;
+
+    Energia_Cuenta(tareasReposo, LUZ);  // Corriente del segundo que pas? con el tiempo que la CPU estuvo en IDLE.
+    anterior = energiaNivel;
+    nivel = Energia_Decide(segundosSinActividad, PuedeDormir());
+
+    if(anterior == ENERGIA_ACTIVO && nivel != ENERGIA_ACTIVO){
+        luzAntesEspera = LUZ;           // ESPERA y SUENO: luz apagada.
+        LUZ = 0;
+    }
+    if(nivel == ENERGIA_SUENO){
+        Duerme();                       // Vuelve con segundosSinActividad = 0.
+        nivel = Energia_Decide(segundosSinActividad, 0);
+    }
+    if(nivel == ENERGIA_ACTIVO && anterior != ENERGIA_ACTIVO && luzAntesEspera == 1){
+        LUZ = 1;                        // Solo la enciende: si la tecla LUZ la cambi? mientras tanto, se respeta.
+    }
+}
+
+unsigned char PuedeDormir(void){        // En Sleep se detienen Timer3 (captura del sensor), el UART y el PWM.
+
+    if(flagConteoActivo == 1 || paradaEmergencia == 1){
+        return 0;                       // Con un lote en curso no se pierde ninguna pieza: se queda en ENERGIA_ESPERA.
+    }
+    if(TXIE == 1 || TRMT == 0){
+        return 0;                       // Bytes por transmitir.
+    }
+#if USA_BITACORA
+    if(bitacoraOcupada == 1 || bitacoraEspera != 0){
+        return 0;                       // Un registro de la bit?cora a medio escribir, o piezas que esperan el minuto.
     }
+#endif
+    return 1;
 }
 
-unsigned int Conversion(unsigned char canal){ // Conversi?n ADC: retorna lectura de ADRES.
+void Duerme(void){                      // ENERGIA_SUENO. Con GIE=0 la tecla o el serial despiertan al PIC sin entrar a la ISR (Tareas_Reposo hace lo mismo).
 
-    ADCON0 = (canal << 2);              // Selecciona el canal poniendo canal en bits CHS (se desplaza 2 posiciones porque CHS empieza en bit2).
-                                        // Importante: aqu? est?s reescribiendo ADCON0, as? que si quieres conservar ADON deber?as reactivar ADON luego.
+    GIE = 0;
+#if USA_TECLADO
+    Teclado_PreparaSleep();             // Todas las filas en 0 y RBIE=1: cualquier tecla despierta al PIC.
+#endif
+    Motor_PreparaSleep();               // Timer2 se detiene en Sleep: RC2 queda fijo en la decisi?n en vez de en un punto del PWM.
+    WUE = 1;                            // El bit de inicio en RX despierta al PIC.
+    Sleep();                            // IDLEN=0 (Tareas_Reposo lo deja as?): bajo consumo completo.
+    NOP();
+
+    if(RCIF == 1){                      // Despert? el serial: ese primer byte no se recibi? completo y se descarta.
+        (void)RCREG;
+    }
+    WUE = 0;
+    segundosSinActividad = 0;           // Al despertar, reinicia el conteo de inactividad.
+#if USA_TECLADO
+    Teclado_DespuesSleep();             // Vuelve al barrido; la tecla que despert? al PIC cuenta si se sigue presionando.
+#endif
+    Motor_DespuesSleep();               // Vuelve al PWM.
+    GIE = 1;
+}
 
-    ADON = 1;                           // Enciende el ADC (si por reescritura se apag? o para asegurar que est? encendido).
-    GO_DONE = 1;                        // Inicia conversi?n (bit GO/DONE = 1).
-    while(GO_DONE == 1);                // Espera a que termine la conversi?n (GO_DONE vuelve a 0 al terminar).
+void TareaConteo(void){                 // Cada tick: suma las piezas que la ISR del sensor acept?.
 
-    return ADRES;                       // Retorna el resultado del ADC (ADRESH:ADRESL combinados).
+    if(flagConteoActivo == 0){
+        sensorPulsosLeidos = sensorPulsos; // Fuera del conteo las piezas no cuentan.
+        return;
+    }
+    while(sensorPulsos != sensorPulsosLeidos && piezasTotalesContadas != piezasObjetivo){
+#if USA_ESTADISTICA
+        Estadistica_Pieza(sensorMarcas[sensorPulsosLeidos & (SENSOR_MARCAS - 1)]); // Intervalo, histograma y ritmo con el instante de la captura.
+#endif
+        sensorPulsosLeidos++;           // A 250 piezas/s llegan menos de 3 por tick.
+        CuentaPieza();
+    }
 }
 
-void putch(char data){                  // Funci?n que usa printf para transmitir caracteres.
+void TareaMotor(void){                  // Cada 250 ms: decisi?n del motor (antes en la ISR de Timer0). El ADC lo muestrea la ISR.
+
+    adcValor = Adc_Filtrado(0);         // Promedio m?vil de AN0 en 12 bits (ya no hay espera de GO_DONE).
+    Motor_Decide(adcValor, ordenMotor); // Hist?resis y tiempo m?nimo en cada estado; la parada de emergencia la respeta LibMotorXC8.h.
+}
+
+#if USA_TELEMETRIA
+void TareaTelemetria(void){             // Cada 250 ms, un tick despu?s de TareaMotor.
+
+    Telemetria_Envia(adcValor,          // Trama corta (5 bytes) o completa (10 bytes) si cambi? conteo/objetivo/modo.
+                     paradaEmergencia == 1 ? MOTOR_ESTADO_EMERGENCIA : motorEncendido,
+                     piezasTotalesContadas, piezasObjetivo, ordenMotor);
+}
+#endif
+
+void CambiaUI(unsigned char estado, unsigned int ticks){ // El estado se ejecuta dentro de ticks ticks (0 = en la pr?xima vuelta de TareaUI).
+
+    estadoUI = estado;
+    ticksUI = ticks;
+}
+
+void TareaUI(void){                     // Cada tick. Reemplaza los ciclos de espera de main, PreguntaAlUsuario y Bienvenida.
+
+    if(ticksUI > 0){                    // Pantalla fija: espera sin bloquear a las dem?s tareas.
+        ticksUI--;
+        if(ticksUI > 0){
+            return;
+        }
+    }
 
-    while(TRMT == 0);                   // Espera hasta que el registro de transmisi?n est? vac?o (TRMT=1 indica listo para nuevo car?cter).
-    TXREG = data;                       // Carga el car?cter a transmitir. USART lo enviar? por el pin TX (RC6).
+    if(estadoUI == UI_BIENVENIDA){
+        Bienvenida();                   // Inicializa el LCD y muestra el mensaje con la Estrella (car?cter CGRAM 0).
+        pasoAnimacion = 0;
+        CambiaUI(UI_ANIMACION, 420);    // Pausa de 4.2 s para que el usuario lo vea.
+    }
+    else if(estadoUI == UI_ANIMACION){  // Animaci?n: desplaza la pantalla a la derecha 18 veces, una cada 100 ms.
+        DesplazaPantallaD();
+        pasoAnimacion++;
+        CambiaUI(pasoAnimacion < 18 ? UI_ANIMACION : UI_AVISO_RESET, 10);
+    }
+    else if(estadoUI == UI_AVISO_RESET){
+        IniciaBufLCD();                 // ?ltimo borrado bloqueante: desde aqu? el LCD se maneja con la pantalla sombra.
+
+        if(POR == 0 || BOR == 0){       // NUEVO: revisa si el reset se asocia a Power-On Reset (POR) o a una ca?da de tensi?n (BOR). Son banderas del hardware del PIC.
+            POR = 1;                    // Limpia las banderas para futuras detecciones (no confundir eventos).
+            BOR = 1;
+            fallaEnergia = 1;           // En UI_FIN_AVISO se retoma el conteo que estaba en curso.
+            MensajeBufLCD(0x80, "    FALLA DE"); // Mensaje: primera l?nea.
+            MensajeBufLCD(0xC0, "     ENERGIA"); // Mensaje: segunda l?nea.
+        }else{                          // Caso contrario: se interpreta como reset no-POR (por ejemplo reset manual).
+            MensajeBufLCD(0x80, "    RESET DE"); // Mensaje: primera l?nea.
+            MensajeBufLCD(0xC0, "     USUARIO"); // Mensaje: segunda l?nea.
+        }
+        CambiaUI(UI_FIN_AVISO, 100);    // El mensaje se ve 1 segundo.
+    }
+    else if(estadoUI == UI_FIN_AVISO){
+        LUZ = 0;                        // Apaga ?luz? en RA3 despu?s del aviso.
+        Tareas_BorraMedidas();          // Bienvenida usa la librer?a del LCD con sus retardos (~0.9 s): esas vueltas perdidas no cuentan en GET TASK.
+#if USA_BITACORA
+        if(fallaEnergia == 1 && RecuperaConteo() == 1){
+            CambiaUI(UI_CONTEO, 0);     // Sigue el lote que la falla de energ?a interrumpi?.
+            return;
+        }
+#endif
+        PreguntaAlUsuario();            // Sin bit?cora una falla de energ?a siempre empieza un lote nuevo.
+        CambiaUI(UI_PREGUNTA, 0);
+    }
+    else if(estadoUI == UI_PREGUNTA){   // Espera a que el usuario presione OK (o a que llegue SET TARGET por serial).
+        if(teclaLeida == '*'){
+            if(ObjetivoValido() == 1){
+                IniciaConteo();
+                CambiaUI(UI_CONTEO, 0);
+            }else{
+                CambiaUI(UI_ERROR, 200); // Tiempo para leer.
+            }
+        }
+    }
+    else if(estadoUI == UI_ERROR){
+        PreguntaAlUsuario();            // Limpia y vuelve a pedir.
+        CambiaUI(UI_PREGUNTA, 0);
+    }
+    else if(estadoUI == UI_CONTEO){
+        if(teclaLeida == '*'){          // OK durante el conteo: siguiente p?gina (conteo y estad?sticas).
+            teclaLeida = '\0';
+            paginaConteo++;
+            if(paginaConteo == PAGINAS){
+                paginaConteo = PAGINA_CONTEO;
+            }
+            DibujaPagina();
+        }
+        if(piezasTotalesContadas == piezasObjetivo){ // Caso: ya alcanzamos el objetivo.
+            IniciaBuzzer(100);          // Buzzer/LED de aviso por 1 segundo para indicar ?cumplido?.
+            CambiaUI(UI_CUMPLIDA, 100); // Se mantiene la pantalla 1 segundo (el ?ltimo faltante alcanza a dibujarse).
+        }
+    }
+    else if(estadoUI == UI_CUMPLIDA){
+        BorraBufLCD();                  // Limpia pantalla.
+        MensajeBufLCD(0x80, "Cuenta Cumplida"); // Texto de ?xito.
+        MensajeBufLCD(0xC0, "   Presione OK"); // Indicaci?n al usuario.
+
+        flagConteoActivo = 0;           // Sale del modo conteo.
+        teclaLeida = '\0';              // Limpia la tecla anterior.
+        CambiaUI(UI_ESPERA_OK, 0);
+    }
+    else if(estadoUI == UI_ESPERA_OK){  // Espera hasta que el teclado mande '*' (OK).
+        if(teclaLeida == '*'){
+            ConfigVariables();          // Reinicia variables para comenzar de nuevo desde cero.
+            Salida_Escribe(RGB_AMARILLO, unidades7Seg); // RGB en el color de reposo y el display en 0 (ConfigVariables).
+            PreguntaAlUsuario();
+            CambiaUI(UI_PREGUNTA, 0);
+        }
+    }
 }
@@ -0,0 +1,171 @@
+/*
+ * File:   LibADCXC8.h
+ *
+ * Muestreo del ADC por interrupcion (ADIF) con sobremuestreo, decimacion y
+ * promedio movil. Reemplaza Conversion(), que esperaba en GO_DONE una sola
+ * muestra del canal 0 cada 250 ms.
+ *
+ * Adc_Dispara() se llama en cada tick de Timer0 y arranca una conversion del
+ * canal que toca (ACQT en ADCON2 da el tiempo de adquisicion). Al terminar
+ * entra la ISR por ADIF y Adc_ISR() suma ADRES. Cada ADC_SOBREMUESTREO
+ * muestras (4^ADC_DECIMA) la suma se corre ADC_DECIMA bits: con ADC_DECIMA 2
+ * son 16 muestras por valor de 12 bits (0..4095). El ruido de la entrada
+ * (al menos 1 LSB) es lo que da los bits de mas.
+ *
+ * Cada valor decimado entra a un buffer circular de ADC_PROMEDIO valores por
+ * canal y se mantiene la suma del buffer: el promedio movil cuesta una resta
+ * y una suma por valor nuevo. El primer valor de un canal llena todo el
+ * buffer (el promedio no arranca desde 0).
+ *
+ * Los canales se atienden en ronda: el siguiente se selecciona al terminar
+ * los ADC_SOBREMUESTREO del actual, asi CHS cambia un tick antes de la
+ * siguiente conversion. Con tick de 10 ms cada canal da un valor decimado
+ * cada 160 ms x canales. Con el ADCS de ConfigReloj.h y ACQT de 2 TAD la
+ * conversion dura 13 TAD: 26 us a 1 MHz, 13 us a 8 MHz y 17 us a 48 MHz.
+ */
+
+#ifndef LIBADCXC8_H
+#define	LIBADCXC8_H
+
+#include "LibHALXC8.h"
+
+#ifndef ADC_CANALES_MAX
+#define ADC_CANALES_MAX 4               // Canales en la ronda.
+#endif
+
+#ifndef ADC_DECIMA
+#define ADC_DECIMA 2                    // Bits que se ganan: 4^ADC_DECIMA muestras por valor (2 -> 16 muestras, 12 bits).
+#endif
+
+#ifndef ADC_PROMEDIO_BITS
+#define ADC_PROMEDIO_BITS 2             // Promedio movil de 2^n valores decimados (2 -> 4 valores, 640 ms con un canal).
+#endif
+
+#define ADC_SOBREMUESTREO (1 << (2 * ADC_DECIMA))
+#define ADC_BITS (10 + ADC_DECIMA)      // Bits de Adc_Valor() y Adc_Filtrado().
+#define ADC_PROMEDIO (1 << ADC_PROMEDIO_BITS)
+
+#if ADC_SOBREMUESTREO > 64
+#error "ADC_DECIMA maximo 3: la suma de muestras es de 16 bits"
+#endif
+#if (ADC_PROMEDIO << ADC_BITS) > 65536
+#error "ADC_PROMEDIO_BITS muy grande para la suma de 16 bits"
+#endif
+
+unsigned char adcCanalesN;                       // Canales agregados.
+unsigned char adcCanalAN[ADC_CANALES_MAX];       // Numero AN de cada canal (lo que va en CHS).
+unsigned char adcActual;                         // Canal que se esta sobremuestreando (solo la ISR).
+unsigned char adcMuestras;                       // Muestras sumadas del canal actual.
+unsigned int adcSuma;                            // Suma de esas muestras.
+
+unsigned int adcHistoria[ADC_CANALES_MAX][ADC_PROMEDIO]; // Ultimos valores decimados de cada canal (buffer circular).
+unsigned char adcPosicion[ADC_CANALES_MAX];      // Posicion del buffer que se reemplaza en el proximo valor.
+unsigned int adcSumaHistoria[ADC_CANALES_MAX];   // Suma del buffer.
+volatile unsigned int adcDecimado[ADC_CANALES_MAX]; // Ultimo valor decimado.
+volatile unsigned int adcPromedio[ADC_CANALES_MAX]; // Promedio movil.
+volatile unsigned char adcNuevos[ADC_CANALES_MAX]; // Valores decimados desde que arranco (0 = todavia sin dato; se queda en 255).
+
+void Adc_Inicia(void);
+unsigned char Adc_Agrega(unsigned char);
+void Adc_Dispara(void);
+void Adc_ISR(void);
+unsigned int Adc_Valor(unsigned char);
+unsigned int Adc_Filtrado(unsigned char);
+unsigned int Adc_Lee16(volatile unsigned int *);
+
+
+void Adc_Inicia(void){
+//Funcion que deja la ronda vacia y habilita ADIE
+//ADCON0 (ADON), ADCON1 y ADCON2 los configura main
+    unsigned char i;
+
+    adcCanalesN = 0;
+    adcActual = 0;
+    adcMuestras = 0;
+    adcSuma = 0;
+    for(i = 0; i < ADC_CANALES_MAX; i++){
+        adcNuevos[i] = 0;
+        adcDecimado[i] = 0;
+        adcPromedio[i] = 0;
+    }
+    ADIF = 0;
+    ADIE = 1;                           // Necesita PEIE.
+}
+unsigned char Adc_Agrega(unsigned char canalAN){
+//Funcion que agrega un canal AN a la ronda y retorna su indice para Adc_Valor/Adc_Filtrado
+//Llamarla antes de habilitar la interrupcion de Timer0
+    if(adcCanalesN == 0){
+        ADCON0 = (unsigned char)(canalAN << 2) | 0x01; // CHS del primer canal y ADON.
+    }
+    adcCanalAN[adcCanalesN] = canalAN;
+    adcCanalesN++;
+    return (unsigned char)(adcCanalesN - 1);
+}
+void Adc_Dispara(void){
+//Funcion que se llama desde la ISR en cada tick: arranca una conversion
+    if(adcCanalesN != 0 && GO_DONE == 0){
+        GO_DONE = 1;
+    }
+}
+void Adc_ISR(void){
+//Funcion que se llama desde la ISR cuando ADIF=1
+    unsigned char i, p;
+    unsigned int valor;
+
+    ADIF = 0;
+    adcSuma += ADRES;
+    adcMuestras++;
+    if(adcMuestras < ADC_SOBREMUESTREO){
+        return;
+    }
+
+    i = adcActual;
+    valor = adcSuma >> ADC_DECIMA;      // Decimacion: la suma de 4^n muestras de 10 bits corrida n bits queda en 10+n bits.
+    adcSuma = 0;
+    adcMuestras = 0;
+    adcDecimado[i] = valor;
+
+    if(adcNuevos[i] == 0){              // Primer valor: llena el buffer para que el promedio no suba desde 0.
+        for(p = 0; p < ADC_PROMEDIO; p++){
+            adcHistoria[i][p] = valor;
+        }
+        adcSumaHistoria[i] = valor << ADC_PROMEDIO_BITS;
+        adcPosicion[i] = 0;
+    }else{
+        p = adcPosicion[i];
+        adcSumaHistoria[i] = adcSumaHistoria[i] - adcHistoria[i][p] + valor;
+        adcHistoria[i][p] = valor;
+        adcPosicion[i] = (p + 1) & (ADC_PROMEDIO - 1);
+    }
+    adcPromedio[i] = adcSumaHistoria[i] >> ADC_PROMEDIO_BITS;
+    if(adcNuevos[i] != 255){
+        adcNuevos[i]++;
+    }
+
+    i++;                                // Siguiente canal de la ronda: CHS cambia ya y la conversion sale en el proximo tick.
+    if(i == adcCanalesN){
+        i = 0;
+    }
+    adcActual = i;
+    ADCON0 = (unsigned char)(adcCanalAN[i] << 2) | 0x01;
+}
+unsigned int Adc_Valor(unsigned char i){
+//Funcion que retorna el ultimo valor decimado del canal i (ADC_BITS bits) desde main
+    return Adc_Lee16(&adcDecimado[i]);
+}
+unsigned int Adc_Filtrado(unsigned char i){
+//Funcion que retorna el promedio movil del canal i (ADC_BITS bits) desde main
+    return Adc_Lee16(&adcPromedio[i]);
+}
+unsigned int Adc_Lee16(volatile unsigned int *dato){
+//Funcion que lee un valor de 16 bits que escribe la ISR (en el PIC se lee de a un byte)
+    unsigned char gie;
+    unsigned int valor;
+
+    gie = GIE;
+    GIE = 0;
+    valor = *dato;
+    GIE = gie;
+    return valor;
+}
+#endif	/* LIBADCXC8_H */
@@ -0,0 +1,168 @@
+/*
+ * File:   LibBCDXC8.h
+ *
+ * Conversion de binario a digitos decimales sin divisiones (double dabble:
+ * corrimientos a la izquierda y +3 a cada nibble BCD que vale 5 o mas antes
+ * de correr). En el PIC18 cada % o / es una llamada a __lwdiv/__lwmod de
+ * XC8 (un ciclo de 16 restas): sacar 5 digitos con divisiones son 9 o 10 de
+ * esas llamadas; aqui son 13 vueltas de corrimientos y comparaciones, y el
+ * tiempo no depende del valor.
+ *
+ * Los digitos quedan de mayor a menor peso y valen 0..9 (sumar '0' para
+ * escribirlos). BCD_PASO() y BCD_AJUSTE() estan vacias; make banco las define
+ * para contar vueltas y ajustes y estimar los ciclos (host/banco.c).
+ *
+ * Los 32 bits (BCD_Convierte32) van restando potencias de diez: como mucho 9
+ * restas por digito, y un valor chico (lo normal en las respuestas por
+ * serial) solo hace las comparaciones. El double dabble de 32 bits serian 29
+ * vueltas revisando 10 nibbles. BCD_RESTA() cuenta cada comparacion.
+ *
+ * BCD_Texto16/BCD_Texto32 dejan el numero en ASCII sin ceros a la izquierda
+ * y con '\0' en un arreglo de quien llama (BCD_TEXTO16/BCD_TEXTO32 bytes):
+ * es lo que hacia printf con %u y %lu, sin doprnt ni divisiones. El LCD usa
+ * las mismas conversiones con ancho fijo (EscribeLCD_n8/n16, EscribeBufLCD_n)
+ * y el UART las de texto (UART_Numero/UART_Numero32 en LibUARTXC8.h).
+ */
+
+#ifndef LIBBCDXC8_H
+#define	LIBBCDXC8_H
+
+#ifndef BCD_PASO
+#define BCD_PASO(bytes)                 // Una vuelta del double dabble (bytes: cuantos bytes BCD se revisan).
+#endif
+
+#ifndef BCD_AJUSTE
+#define BCD_AJUSTE()                    // Un +3 a un nibble.
+#endif
+
+#ifndef BCD_RESTA
+#define BCD_RESTA()                     // Una comparacion (y resta si cabe) de 32 bits en BCD_Convierte32.
+#endif
+
+#define BCD_TEXTO16 6                   // Bytes para BCD_Texto16: "65535" y el '\0'.
+#define BCD_TEXTO32 11                  // Bytes para BCD_Texto32: "4294967295" y el '\0'.
+
+const unsigned long bcdPotencias[9] = { // 10^9 .. 10^1 (las unidades son lo que sobra).
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL
+};
+
+void BCD_Convierte16(unsigned int, unsigned char *);
+void BCD_Convierte8(unsigned char, unsigned char *);
+void BCD_Convierte32(unsigned long, unsigned char *);
+unsigned char BCD_Texto16(unsigned int, char *);
+unsigned char BCD_Texto32(unsigned long, char *);
+unsigned char BCD_Recorta(const unsigned char *, unsigned char, char *);
+
+
+void BCD_Convierte16(unsigned int valor, unsigned char *digitos){
+//Funcion que deja en digitos[0..4] las decenas de mil, millares, centenas, decenas y unidades de valor (0 a 65535)
+    unsigned char i, alto, medio, bajo;
+
+    alto = 0;                           // Decenas de mil (nunca pasa de 6: no necesita ajuste).
+    medio = 0;                          // Millares | centenas.
+    bajo = (unsigned char)((valor >> 13) & 0x07); // Los 3 primeros bits no alcanzan a dar un nibble de 5: entran sin ajuste.
+    valor <<= 3;
+    for(i = 3; i < 16; i++){
+        BCD_PASO(2);
+        if((bajo & 0x0F) >= 0x05){
+            bajo += 0x03;
+            BCD_AJUSTE();
+        }
+        if((bajo & 0xF0) >= 0x50){
+            bajo += 0x30;
+            BCD_AJUSTE();
+        }
+        if((medio & 0x0F) >= 0x05){
+            medio += 0x03;
+            BCD_AJUSTE();
+        }
+        if((medio & 0xF0) >= 0x50){
+            medio += 0x30;
+            BCD_AJUSTE();
+        }
+        alto = (unsigned char)((alto << 1) | (medio >> 7));
+        medio = (unsigned char)((medio << 1) | (bajo >> 7));
+        bajo = (unsigned char)((bajo << 1) | ((valor & 0x8000) ? 1 : 0));
+        valor <<= 1;
+    }
+    digitos[0] = alto;
+    digitos[1] = medio >> 4;
+    digitos[2] = medio & 0x0F;
+    digitos[3] = bajo >> 4;
+    digitos[4] = bajo & 0x0F;
+}
+void BCD_Convierte8(unsigned char valor, unsigned char *digitos){
+//Funcion que deja en digitos[0..2] las centenas, decenas y unidades de valor (0 a 255)
+    unsigned char i, alto, bajo;
+
+    alto = 0;                           // Centenas (nunca pasa de 2).
+    bajo = (unsigned char)(valor >> 5);
+    valor = (unsigned char)(valor << 3);
+    for(i = 3; i < 8; i++){
+        BCD_PASO(1);
+        if((bajo & 0x0F) >= 0x05){
+            bajo += 0x03;
+            BCD_AJUSTE();
+        }
+        if((bajo & 0xF0) >= 0x50){
+            bajo += 0x30;
+            BCD_AJUSTE();
+        }
+        alto = (unsigned char)((alto << 1) | (bajo >> 7));
+        bajo = (unsigned char)((bajo << 1) | (valor >> 7));
+        valor = (unsigned char)(valor << 1);
+    }
+    digitos[0] = alto;
+    digitos[1] = bajo >> 4;
+    digitos[2] = bajo & 0x0F;
+}
+void BCD_Convierte32(unsigned long valor, unsigned char *digitos){
+//Funcion que deja en digitos[0..9] los 10 digitos de valor (0 a 4294967295), restando potencias de diez
+    unsigned char i, d;
+
+    for(i = 0; i < 9; i++){
+        d = 0;
+        BCD_RESTA();
+        while(valor >= bcdPotencias[i]){
+            valor -= bcdPotencias[i];
+            d++;
+            BCD_RESTA();
+        }
+        digitos[i] = d;
+    }
+    digitos[9] = (unsigned char)valor;
+}
+unsigned char BCD_Recorta(const unsigned char *digitos, unsigned char n, char *texto){
+//Funcion que pasa n digitos a ASCII sin los ceros de la izquierda (el ultimo siempre queda)
+//Retorna cuantos caracteres quedaron en texto (sin contar el '\0')
+    unsigned char i, largo;
+
+    i = 0;
+    while(i < n - 1 && digitos[i] == 0){
+        i++;
+    }
+    largo = 0;
+    while(i < n){
+        texto[largo] = (char)(digitos[i] + '0');
+        largo++;
+        i++;
+    }
+    texto[largo] = '\0';
+    return largo;
+}
+unsigned char BCD_Texto16(unsigned int valor, char *texto){
+//Funcion que escribe valor en decimal en texto (BCD_TEXTO16 bytes), como %u
+//Ejemplo BCD_Texto16(204, texto); deja "204"
+    unsigned char digitos[5];
+
+    BCD_Convierte16(valor, digitos);
+    return BCD_Recorta(digitos, 5, texto);
+}
+unsigned char BCD_Texto32(unsigned long valor, char *texto){
+//Funcion que escribe valor en decimal en texto (BCD_TEXTO32 bytes), como %lu
+    unsigned char digitos[10];
+
+    BCD_Convierte32(valor, digitos);
+    return BCD_Recorta(digitos, 10, texto);
+}
+#endif	/* LIBBCDXC8_H */
@@ -0,0 +1,206 @@
+/*
+ * File:   LibBitacoraXC8.h
+ *
+ * Bitacora del conteo en la EEPROM de datos (256 bytes del PIC18F4550). Cada
+ * registro es de 8 bytes y va en la siguiente de las 32 posiciones (en ronda),
+ * asi cada posicion se escribe 1 de cada 32 veces:
+ *   [0] [1] secuencia (16 bits, byte alto primero; 0xFFFF no se usa)
+ *   [2] [3] piezas contadas
+ *   [4] [5] objetivo
+ *   [6] estado (1 = conteo en curso)
+ *   [7] CRC-8 (LibCRC8XC8.h, valor inicial 0xFF) de los bytes [0]..[6]
+ *
+ * Al arrancar Bitacora_Inicia() lee todas las posiciones y se queda con el
+ * registro valido de secuencia mas alta. Un registro a medio escribir (corte
+ * de energia durante la escritura) no pasa el CRC y queda el anterior. La
+ * EEPROM borrada (0xFF) tampoco pasa el CRC.
+ *
+ * La escritura no bloquea: Bitacora_Guarda() arma el registro en RAM y pone
+ * EEIF=1; la ISR (Bitacora_ISR) escribe un byte cada vez que entra por EEIF,
+ * o sea un byte cada ~4 ms, y el conteo nunca espera a la EEPROM. Mientras
+ * un registro se escribe los cambios nuevos se ignoran: quien llama repite.
+ *
+ * Bitacora_Guarda() se llama cada segundo. Un cambio de objetivo o de estado
+ * se escribe en esa misma llamada; si solo cambio el conteo espera a que
+ * pasen BITACORA_SEGUNDOS llamadas desde la primera pieza sin guardar (todas
+ * las piezas de ese minuto van en un registro), salvo que Bitacora_Urgente()
+ * pida escribir ya (aviso de tension baja del HLVD). Un corte sin aviso pierde
+ * a lo sumo las piezas del ultimo minuto.
+ *
+ * Desgaste: contando sin parar sale un registro por minuto, y con 32
+ * posiciones cada celda se escribe una vez cada 32 minutos: 100 000 ciclos
+ * (minimo de la hoja de datos) son unos 6 anos y 1 000 000 (tipico) unos
+ * 60. Cada cambio de objetivo o de estado (lo hace el operador) y cada aviso
+ * de tension baja gastan un registro mas.
+ */
+
+#ifndef LIBBITACORAXC8_H
+#define	LIBBITACORAXC8_H
+
+#include "LibHALXC8.h"
+#include "LibCRC8XC8.h"
+
+#define BITACORA_REGISTRO 8             // Bytes por registro.
+#define BITACORA_RANURAS 32             // 256 / 8.
+#define BITACORA_CRC_INICIO 0xFF        // Con 0x00 un registro en ceros tendria CRC valido.
+#define BITACORA_SIN_SECUENCIA 0xFFFF
+#define BITACORA_SEGUNDOS 60            // Llamadas (segundos) que espera un conteo nuevo. No mas que el tiempo hasta Sleep.
+
+unsigned char bitacoraRegistro[BITACORA_REGISTRO]; // Registro que se esta escribiendo.
+volatile unsigned char bitacoraIndice;           // Proximo byte a escribir (BITACORA_REGISTRO = todos pedidos).
+volatile unsigned char bitacoraOcupada;          // 1 = hay un registro a medio escribir (la ISR lo baja).
+unsigned char bitacoraRanura;                    // Posicion del proximo registro.
+unsigned short bitacoraSecuencia;                // Secuencia del proximo registro (16 bits tambien en gcc: make host).
+unsigned int bitacoraConteo;                     // Ultimo registro guardado (o el que se recupero al arrancar).
+unsigned int bitacoraObjetivo;
+unsigned char bitacoraEstado;
+unsigned int bitacoraEscritos;                   // Registros escritos desde el arranque.
+unsigned char bitacoraEspera;                    // Llamadas con un conteo sin guardar.
+volatile unsigned char bitacoraUrgente;          // 1 = el proximo cambio se escribe sin esperar (lo pone la ISR).
+
+unsigned char Bitacora_Inicia(void);
+unsigned char Bitacora_LeeByte(unsigned char);
+unsigned char Bitacora_Guarda(unsigned int, unsigned int, unsigned char);
+void Bitacora_Urgente(void);
+void Bitacora_ISR(void);
+
+
+unsigned char Bitacora_Inicia(void){
+//Funcion que busca el ultimo registro valido y prepara la escritura del siguiente
+//Retorna 1 si encontro uno (queda en bitacoraConteo, bitacoraObjetivo y bitacoraEstado)
+//Llamarla antes de habilitar las interrupciones (deja EEIE=1)
+    unsigned char ranura, i, crc, encontrado;
+    unsigned char leido[BITACORA_REGISTRO];
+    unsigned short secuencia;
+
+    encontrado = 0;
+    bitacoraRanura = 0;
+    bitacoraSecuencia = 0;
+    bitacoraConteo = 0;
+    bitacoraObjetivo = 0;
+    bitacoraEstado = 0;
+    for(ranura = 0; ranura < BITACORA_RANURAS; ranura++){
+        crc = BITACORA_CRC_INICIO;
+        for(i = 0; i < BITACORA_REGISTRO; i++){
+            leido[i] = Bitacora_LeeByte((unsigned char)(ranura * BITACORA_REGISTRO + i));
+            if(i < BITACORA_REGISTRO - 1){
+                crc = CRC8_Agrega(crc, leido[i]);
+            }
+        }
+        secuencia = (unsigned short)(((unsigned int)leido[0] << 8) | leido[1]);
+        if(crc != leido[BITACORA_REGISTRO - 1] || secuencia == BITACORA_SIN_SECUENCIA){
+            continue;
+        }
+        if(encontrado == 0 || (signed short)(secuencia - bitacoraSecuencia) > 0){ // La secuencia da la vuelta: se compara la diferencia.
+            encontrado = 1;
+            bitacoraSecuencia = secuencia;
+            bitacoraRanura = ranura;
+            bitacoraConteo = ((unsigned int)leido[2] << 8) | leido[3];
+            bitacoraObjetivo = ((unsigned int)leido[4] << 8) | leido[5];
+            bitacoraEstado = leido[6];
+        }
+    }
+    if(encontrado == 1){                // El siguiente va despues del mas nuevo.
+        bitacoraSecuencia++;
+        bitacoraRanura = (bitacoraRanura + 1) & (BITACORA_RANURAS - 1);
+    }
+    if(bitacoraSecuencia == BITACORA_SIN_SECUENCIA){
+        bitacoraSecuencia = 0;
+    }
+    bitacoraIndice = BITACORA_REGISTRO;
+    bitacoraOcupada = 0;
+    bitacoraEscritos = 0;
+    bitacoraEspera = 0;
+    bitacoraUrgente = 0;
+    EEIF = 0;
+    EEIE = 1;                           // Necesita PEIE.
+    return encontrado;
+}
+unsigned char Bitacora_LeeByte(unsigned char direccion){
+//Funcion que lee un byte de la EEPROM de datos (no espera: la lectura es de un ciclo)
+    EEADR = direccion;
+    EEPGD = 0;                          // EEPROM de datos, no flash.
+    CFGS = 0;
+    RD = 1;
+    return EEDATA;
+}
+unsigned char Bitacora_Guarda(unsigned int conteo, unsigned int objetivo, unsigned char estado){
+//Funcion que pide escribir un registro si algo cambio desde el ultimo (desde main, cada segundo)
+//Retorna 0 si la bitacora estaba ocupada con el registro anterior (hay que volver a llamarla)
+    unsigned char i, crc;
+
+    if(bitacoraOcupada == 1){
+        return 0;
+    }
+    if(objetivo == bitacoraObjetivo && estado == bitacoraEstado){
+        if(conteo == bitacoraConteo){
+            bitacoraEspera = 0;
+            bitacoraUrgente = 0;
+            return 1;                   // Nada nuevo: no se gasta la EEPROM.
+        }
+        bitacoraEspera++;
+        if(bitacoraUrgente == 0 && bitacoraEspera < BITACORA_SEGUNDOS){
+            return 1;                   // Solo piezas: se juntan hasta el minuto.
+        }
+    }
+    bitacoraEspera = 0;
+    bitacoraUrgente = 0;
+
+    bitacoraRegistro[0] = (unsigned char)(bitacoraSecuencia >> 8);
+    bitacoraRegistro[1] = (unsigned char)bitacoraSecuencia;
+    bitacoraRegistro[2] = (unsigned char)(conteo >> 8);
+    bitacoraRegistro[3] = (unsigned char)conteo;
+    bitacoraRegistro[4] = (unsigned char)(objetivo >> 8);
+    bitacoraRegistro[5] = (unsigned char)objetivo;
+    bitacoraRegistro[6] = estado;
+    crc = BITACORA_CRC_INICIO;
+    for(i = 0; i < BITACORA_REGISTRO - 1; i++){
+        crc = CRC8_Agrega(crc, bitacoraRegistro[i]);
+    }
+    bitacoraRegistro[BITACORA_REGISTRO - 1] = crc; // El CRC se escribe de ultimo: hasta ahi el registro no vale.
+
+    bitacoraConteo = conteo;
+    bitacoraObjetivo = objetivo;
+    bitacoraEstado = estado;
+    bitacoraIndice = 0;
+    bitacoraOcupada = 1;
+    EEIF = 1;                           // La ISR escribe el primer byte (la secuencia 0x55/0xAA va con GIE=0).
+    return 1;
+}
+void Bitacora_Urgente(void){
+//Funcion que hace escribir lo pendiente en la proxima llamada a Bitacora_Guarda (desde la ISR)
+//El registro tarda BITACORA_REGISTRO bytes de ~4 ms: la tension tiene que aguantar eso mas hasta la llamada
+    bitacoraUrgente = 1;
+}
+void Bitacora_ISR(void){
+//Funcion que se llama desde la ISR cuando EEIF=1: escribe el siguiente byte o cierra el registro
+    unsigned char i;
+    unsigned char gie;
+
+    EEIF = 0;
+    i = bitacoraIndice;
+    if(i < BITACORA_REGISTRO){
+        EEADR = (unsigned char)(bitacoraRanura * BITACORA_REGISTRO + i);
+        EEDATA = bitacoraRegistro[i];
+        EEPGD = 0;
+        CFGS = 0;
+        WREN = 1;
+        gie = GIE;
+        GIE = 0;                        // Con IPEN=1 la ISR de baja prioridad solo apaga GIEL: la de alta podria entrar en medio.
+        EECON2 = 0x55;                  // Secuencia obligatoria, sin interrupciones en medio.
+        EECON2 = 0xAA;
+        WR = 1;
+        GIE = gie;
+        WREN = 0;                       // La escritura en curso sigue; evita otra escritura accidental.
+        bitacoraIndice = i + 1;
+    }else if(bitacoraOcupada == 1){     // Termino el ultimo byte.
+        bitacoraRanura = (bitacoraRanura + 1) & (BITACORA_RANURAS - 1);
+        bitacoraSecuencia++;
+        if(bitacoraSecuencia == BITACORA_SIN_SECUENCIA){
+            bitacoraSecuencia = 0;
+        }
+        bitacoraEscritos++;
+        bitacoraOcupada = 0;
+    }
+}
+#endif	/* LIBBITACORAXC8_H */
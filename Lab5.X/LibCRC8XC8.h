@@ -0,0 +1,27 @@
+/*
+ * File:   LibCRC8XC8.h
+ *
+ * CRC-8 con polinomio 0x07 (x^8+x^2+x+1), de a un nibble por tabla. Lo
+ * usan las tramas de telemetria y los registros de la bitacora en EEPROM.
+ * El valor inicial lo pone quien llama (las tramas usan 0x00).
+ */
+
+#ifndef LIBCRC8XC8_H
+#define	LIBCRC8XC8_H
+
+const unsigned char crc8Tabla[16] = {   // CRC-8 (x^8+x^2+x+1) de a un nibble: 16 bytes de flash en vez de 256.
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+unsigned char CRC8_Agrega(unsigned char, unsigned char);
+
+
+unsigned char CRC8_Agrega(unsigned char crc, unsigned char dato){
+//Funcion que agrega un byte al CRC-8 acumulado
+    crc = crc ^ dato;
+    crc = (unsigned char)(crc << 4) ^ crc8Tabla[crc >> 4];
+    crc = (unsigned char)(crc << 4) ^ crc8Tabla[crc >> 4];
+    return crc;
+}
+#endif	/* LIBCRC8XC8_H */
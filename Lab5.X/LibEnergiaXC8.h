@@ -0,0 +1,141 @@
+/*
+ * File:   LibEnergiaXC8.h
+ *
+ * Niveles de bajo consumo por inactividad y estimacion de la corriente.
+ * Reemplaza el Sleep() que la ISR de Timer1 hacia a los 60 s: dormido se
+ * perdian las piezas (CCP2 necesita Timer3) y los comandos por serial.
+ *
+ * Niveles, de menor a mayor ahorro:
+ *   ENERGIA_ACTIVO  luz encendida. Entre interrupciones la CPU ya queda en
+ *                   IDLE (Tareas_Reposo): timers, UART, CCP y ADC siguen.
+ *   ENERGIA_ESPERA  luz (LATA3) apagada; todo lo demas sigue igual, asi que
+ *                   no se pierde ninguna pieza ni ningun byte.
+ *   ENERGIA_SUENO   Sleep(): se detienen los timers, el ADC y el PWM.
+ *                   Despiertan el teclado (RBIF) y el serial (WUE: el bit
+ *                   de inicio del primer byte despierta y ese byte se pierde).
+ *                   INT0..INT2 son filas del teclado (RB0..RB2) y no se
+ *                   usan como fuente aparte.
+ *
+ * Energia_Decide() solo elige el nivel con los segundos de inactividad y si
+ * en este momento se puede dormir (quien llama sabe si hay un lote en curso,
+ * bytes por transmitir, etc.). Las entradas y salidas de cada nivel las hace
+ * main, nunca la ISR.
+ *
+ * Energia_Cuenta() se llama cada segundo con el tiempo acumulado en IDLE
+ * (tareasReposo) y estima la corriente de ese segundo con las constantes
+ * ENERGIA_UA_... (valores tipicos de la hoja de datos para el reloj de
+ * ConfigReloj.h y una luz de 15 mA: cambiarlas por lo medido en la tarjeta). Dormido no corre ningun
+ * reloj, asi que ese tiempo no se puede medir: solo se cuentan las veces.
+ */
+
+#ifndef LIBENERGIAXC8_H
+#define	LIBENERGIAXC8_H
+
+#include "LibHALXC8.h"
+
+#define ENERGIA_ACTIVO 0
+#define ENERGIA_ESPERA 1
+#define ENERGIA_SUENO  2
+
+#ifndef ENERGIA_ESPERA_S
+#define ENERGIA_ESPERA_S 30             // Segundos sin actividad para apagar la luz.
+#endif
+
+#ifndef ENERGIA_SUENO_S
+#define ENERGIA_SUENO_S 60              // Segundos sin actividad para dormir (si se puede).
+#endif
+
+#ifndef ENERGIA_UA_CPU
+#if RELOJ_MHZ == 48
+#define ENERGIA_UA_CPU 25000            // uA con la CPU corriendo (PRI_RUN, HSPLL 48 MHz).
+#elif RELOJ_MHZ == 8
+#define ENERGIA_UA_CPU 3200             // uA con la CPU corriendo (RC_RUN, INTOSC 8 MHz).
+#else
+#define ENERGIA_UA_CPU 600              // uA con la CPU corriendo (RC_RUN, INTOSC 1 MHz).
+#endif
+#endif
+
+#ifndef ENERGIA_UA_IDLE
+#if RELOJ_MHZ == 48
+#define ENERGIA_UA_IDLE 11000           // uA en IDLE (PRI_IDLE: el PLL y los perifericos siguen).
+#elif RELOJ_MHZ == 8
+#define ENERGIA_UA_IDLE 1100            // uA en IDLE (RC_IDLE).
+#else
+#define ENERGIA_UA_IDLE 250             // uA en IDLE (RC_IDLE: perifericos con reloj).
+#endif
+#endif
+
+#ifndef ENERGIA_UA_LUZ
+#define ENERGIA_UA_LUZ 15000            // uA de la luz/backlight en RA3.
+#endif
+
+#ifndef ENERGIA_TICKS_S
+#define ENERGIA_TICKS_S RELOJ_T3_HZ     // Ticks de Timer3 por segundo: unidades de tareasReposo.
+#endif
+
+unsigned char energiaNivel;                      // Nivel actual (ENERGIA_...).
+unsigned int energiaCorriente;                   // uA estimados en el ultimo segundo.
+unsigned long energiaCarga;                      // mA*s estimados despierto desde el arranque.
+unsigned int energiaResto;                       // uA*s que todavia no completan 1 mA*s.
+unsigned long energiaReposoAnterior;             // tareasReposo en la llamada anterior.
+unsigned int energiaSuenos;                      // Veces que se entro a ENERGIA_SUENO.
+
+void Energia_Inicia(void);
+unsigned char Energia_Decide(unsigned char, unsigned char);
+void Energia_Cuenta(unsigned long, unsigned char);
+
+
+void Energia_Inicia(void){
+//Funcion que arranca en ENERGIA_ACTIVO con la carga en 0
+    energiaNivel = ENERGIA_ACTIVO;
+    energiaCorriente = 0;
+    energiaCarga = 0;
+    energiaResto = 0;
+    energiaReposoAnterior = 0;
+    energiaSuenos = 0;
+}
+unsigned char Energia_Decide(unsigned char inactivo, unsigned char puedeDormir){
+//Funcion que retorna el nivel que corresponde a los segundos de inactividad
+//puedeDormir: 1 si nada se pierde durmiendo; si no, el nivel se queda en ENERGIA_ESPERA
+    unsigned char nivel;
+
+    nivel = ENERGIA_ACTIVO;
+    if(inactivo >= ENERGIA_ESPERA_S){
+        nivel = ENERGIA_ESPERA;
+    }
+    if(inactivo >= ENERGIA_SUENO_S && puedeDormir == 1){
+        nivel = ENERGIA_SUENO;
+    }
+    if(nivel == ENERGIA_SUENO){
+        energiaSuenos++;
+    }
+    energiaNivel = nivel;
+    return nivel;
+}
+void Energia_Cuenta(unsigned long reposo, unsigned char luz){
+//Funcion que se llama cada segundo: corriente del segundo y carga acumulada
+//reposo: ticks de Timer3 en IDLE desde el arranque (tareasReposo); luz: 1 si la luz esta encendida
+    unsigned long enIdle;
+
+    enIdle = reposo - energiaReposoAnterior;
+    if(reposo < energiaReposoAnterior){ // Se borraron las medidas (Tareas_BorraMedidas).
+        enIdle = reposo;
+    }
+    energiaReposoAnterior = reposo;
+    if(enIdle > ENERGIA_TICKS_S){
+        enIdle = ENERGIA_TICKS_S;
+    }
+
+    enIdle /= ENERGIA_TICKS_S / 1000;   // En ms: con 1.5 MHz de Timer3 y 25 mA el producto en ticks ya no cabe en 32 bits.
+    energiaCorriente = ENERGIA_UA_CPU - (unsigned int)((unsigned long)(ENERGIA_UA_CPU - ENERGIA_UA_IDLE) * enIdle / 1000);
+    if(luz == 1){
+        energiaCorriente += ENERGIA_UA_LUZ;
+    }
+    energiaResto += energiaCorriente % 1000;
+    energiaCarga += energiaCorriente / 1000;
+    if(energiaResto >= 1000){
+        energiaResto -= 1000;
+        energiaCarga++;
+    }
+}
+#endif	/* LIBENERGIAXC8_H */
@@ -0,0 +1,193 @@
+/*
+ * File:   LibEstadisticaXC8.h
+ *
+ * Estadisticas de produccion a partir del instante de cada pieza: ritmo en
+ * piezas por minuto, intervalo minimo/maximo/promedio entre piezas con un
+ * histograma de ESTAD_BINS barras fijas, y tiempo en marcha y parado. Sirve
+ * para ver que la banda se esta frenando antes de que el lote termine tarde.
+ *
+ * Estadistica_Pieza() se llama desde main por cada pieza contada con el
+ * instante que capturo la ISR (ticks de un timer libre de 32 bits; Lab5 usa
+ * Timer3 extendido, ESTAD_TICKS_POR_MS ticks por ms). El intervalo se pasa a
+ * ms y se satura en 65535 ms: una parada larga cae en la ultima barra.
+ *
+ * Estadistica_Segundo() se llama una vez por segundo:
+ *   - el ritmo es la suma de ESTAD_CUBETAS cubetas de ESTAD_CUBETA_S
+ *     segundos (ventana movil de 60 s con los valores por defecto), asi baja
+ *     solo si las piezas dejan de llegar;
+ *   - con activo=1 el segundo cuenta como marcha si hubo una pieza en los
+ *     ultimos ESTAD_PARADA_S segundos y como parado si no.
+ *
+ * Todo el estado lo usa solo main (la ISR solo deja los instantes).
+ */
+
+#ifndef LIBESTADISTICAXC8_H
+#define	LIBESTADISTICAXC8_H
+
+#include "LibHALXC8.h"
+
+#ifndef ESTAD_TICKS_POR_MS
+#define ESTAD_TICKS_POR_MS (RELOJ_T3_HZ / 1000) // Timer3 con el prescaler de ConfigReloj.h.
+#endif
+
+#ifndef ESTAD_BINS
+#define ESTAD_BINS 8                    // Barras del histograma de intervalos.
+#endif
+
+#ifndef ESTAD_BIN_MS
+#define ESTAD_BIN_MS 250                // Ancho de cada barra (la ultima se queda con todo lo que pase de ESTAD_BINS - 1 barras).
+#endif
+
+#ifndef ESTAD_CUBETAS
+#define ESTAD_CUBETAS 12                // Cubetas de la ventana del ritmo.
+#endif
+
+#ifndef ESTAD_CUBETA_S
+#define ESTAD_CUBETA_S 5                // Segundos por cubeta (12 x 5 s = 60 s).
+#endif
+
+#ifndef ESTAD_PARADA_S
+#define ESTAD_PARADA_S 3                // Segundos sin piezas para considerar la banda parada.
+#endif
+
+#define ESTAD_VENTANA_S ((ESTAD_CUBETAS - 1) * ESTAD_CUBETA_S) // Cubetas completas de la ventana (la actual se suma aparte).
+
+unsigned long estadUltimaMarca;                  // Instante de la pieza anterior.
+unsigned char estadHayMarca;                     // 0 = todavia no hay pieza anterior (la primera no da intervalo).
+unsigned int estadIntervalos;                    // Intervalos medidos.
+unsigned long estadSuma;                         // Suma de los intervalos (ms), para el promedio.
+unsigned int estadMinimo;                        // Intervalos minimo y maximo (ms).
+unsigned int estadMaximo;
+unsigned int estadHistograma[ESTAD_BINS];        // Intervalos por barra.
+unsigned int estadCubetas[ESTAD_CUBETAS];        // Piezas por cubeta (ventana del ritmo).
+unsigned char estadCubeta;                       // Cubeta que se esta llenando.
+unsigned char estadSegundosCubeta;               // Segundos que lleva la cubeta actual.
+unsigned int estadSegundos;                      // Segundos desde Estadistica_Inicia (se queda en 65535).
+unsigned char estadSinPieza;                     // Segundos desde la ultima pieza (se queda en 255).
+unsigned int estadMarcha;                        // Segundos en marcha y parado (se quedan en 65535).
+unsigned int estadParado;
+
+void Estadistica_Inicia(void);
+void Estadistica_Pieza(unsigned long);
+void Estadistica_Segundo(unsigned char);
+unsigned int Estadistica_PorMinuto(void);
+unsigned int Estadistica_Promedio(void);
+
+
+void Estadistica_Inicia(void){
+//Funcion que borra todas las estadisticas (al empezar un lote)
+    unsigned char i;
+
+    estadHayMarca = 0;
+    estadIntervalos = 0;
+    estadSuma = 0;
+    estadMinimo = 0;
+    estadMaximo = 0;
+    for(i = 0; i < ESTAD_BINS; i++){
+        estadHistograma[i] = 0;
+    }
+    for(i = 0; i < ESTAD_CUBETAS; i++){
+        estadCubetas[i] = 0;
+    }
+    estadCubeta = 0;
+    estadSegundosCubeta = 0;
+    estadSegundos = 0;
+    estadSinPieza = 255;                // Hasta la primera pieza la banda esta parada.
+    estadMarcha = 0;
+    estadParado = 0;
+}
+void Estadistica_Pieza(unsigned long marca){
+//Funcion que agrega una pieza con su instante (ticks del timer libre)
+    unsigned long ms;
+    unsigned int intervalo;
+    unsigned char bin;
+
+    estadCubetas[estadCubeta]++;
+    estadSinPieza = 0;
+    if(estadHayMarca == 0){
+        estadHayMarca = 1;
+        estadUltimaMarca = marca;
+        return;
+    }
+
+    ms = (marca - estadUltimaMarca) / ESTAD_TICKS_POR_MS; // La resta de 32 bits sirve aunque el timer de la vuelta.
+    estadUltimaMarca = marca;
+    intervalo = ms > 65535 ? 65535 : (unsigned int)ms;
+
+    if(estadIntervalos == 0 || intervalo < estadMinimo){
+        estadMinimo = intervalo;
+    }
+    if(intervalo > estadMaximo){
+        estadMaximo = intervalo;
+    }
+    if(estadIntervalos != 65535){       // Mas de 65535 intervalos: el promedio sigue con los primeros.
+        estadIntervalos++;
+        estadSuma += intervalo;
+    }
+
+    bin = ESTAD_BINS - 1;
+    if(intervalo < (unsigned int)(ESTAD_BINS - 1) * ESTAD_BIN_MS){
+        bin = (unsigned char)(intervalo / ESTAD_BIN_MS);
+    }
+    if(estadHistograma[bin] != 65535){
+        estadHistograma[bin]++;
+    }
+}
+void Estadistica_Segundo(unsigned char activo){
+//Funcion que se llama cada segundo: mueve la ventana del ritmo y suma marcha o parado
+//activo: 1 si hay un lote en curso (fuera del lote no se cuenta el tiempo)
+    if(activo == 1){
+        if(estadSinPieza < ESTAD_PARADA_S){
+            if(estadMarcha != 65535){
+                estadMarcha++;
+            }
+        }else if(estadParado != 65535){
+            estadParado++;
+        }
+    }
+    if(estadSinPieza != 255){
+        estadSinPieza++;
+    }
+    if(estadSegundos != 65535){
+        estadSegundos++;
+    }
+
+    estadSegundosCubeta++;
+    if(estadSegundosCubeta == ESTAD_CUBETA_S){ // La cubeta mas vieja se vacia y pasa a ser la actual.
+        estadSegundosCubeta = 0;
+        estadCubeta++;
+        if(estadCubeta == ESTAD_CUBETAS){
+            estadCubeta = 0;
+        }
+        estadCubetas[estadCubeta] = 0;
+    }
+}
+unsigned int Estadistica_PorMinuto(void){
+//Funcion que retorna el ritmo en piezas por minuto en la ventana movil
+//Al empezar el lote la ventana es lo que va corrido
+    unsigned char i;
+    unsigned long piezas;
+    unsigned int ventana;
+
+    piezas = 0;
+    for(i = 0; i < ESTAD_CUBETAS; i++){
+        piezas += estadCubetas[i];
+    }
+    ventana = ESTAD_VENTANA_S + estadSegundosCubeta;
+    if(estadSegundos < ventana){
+        ventana = estadSegundos;
+    }
+    if(ventana == 0){
+        ventana = 1;
+    }
+    piezas = piezas * 60 / ventana;
+    return piezas > 65535 ? 65535 : (unsigned int)piezas;
+}
+unsigned int Estadistica_Promedio(void){
+//Funcion que retorna el intervalo promedio entre piezas en ms (0 si todavia no hay)
+    if(estadIntervalos == 0){
+        return 0;
+    }
+    return (unsigned int)(estadSuma / estadIntervalos);
+}
+#endif	/* LIBESTADISTICAXC8_H */
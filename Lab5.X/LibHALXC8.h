@@ -0,0 +1,33 @@
+/*
+ * File:   LibHALXC8.h
+ *
+ * Capa delgada de acceso al hardware de Lab5. La logica de Lab5.c usa estos
+ * nombres en vez de los pines (LATC2, RC1, LATE, ...), igual que la libreria
+ * del LCD usa Datos/RS/E. Los nombres estan en ConfigTarjeta.h (con los TRIS
+ * y las partes del programa que compila cada estacion); se pueden redefinir
+ * antes de incluir este archivo si el montaje cambia.
+ *
+ * Con HOST_SIM definido (make host) <xc.h> es host/xc.h: los registros son
+ * variables del simulador y HAL_ESPERA() le da tiempo al simulador para
+ * avanzar timers, UART, ADC y despachar la ISR. HAL_RELOJ() le pasa el
+ * _XTAL_FREQ de ConfigReloj.h al simulador al arrancar y HAL_LCD() el puerto
+ * del bus del LCD (LCD_PUERTO de ConfigLCD.h).
+ */
+
+#ifndef LIBHALXC8_H
+#define	LIBHALXC8_H
+
+#include <xc.h>
+#include "ConfigTarjeta.h"             // Mapa de pines de la estacion.
+
+#ifdef HOST_SIM
+#define HAL_ESPERA()    sim_espera()    // En el simulador cada vuelta de espera consume tiempo simulado.
+#define HAL_RELOJ()     sim_reloj((double)_XTAL_FREQ) // Los ciclos del simulador duran 4 / _XTAL_FREQ.
+#define HAL_LCD()       sim_lcd_puerto(LCD_PUERTO) // El simulador mira el bus en ese puerto.
+#else
+#define HAL_ESPERA()                    // En el PIC no hace nada: la espera es la propia vuelta del ciclo.
+#define HAL_RELOJ()                     // En el PIC el reloj lo fijan los pragmas y OSCCON.
+#define HAL_LCD()
+#endif
+
+#endif	/* LIBHALXC8_H */
@@ -0,0 +1,307 @@
+/*
+ * File:   LibLCDBufXC8.h
+ *
+ * Pantalla sombra de 2x16 para el LCD de LibLCDXC8_1.h.
+ * Las funciones EscribeBufLCD_*, MensajeBufLCD, BorraBufLCD y CursorBufLCD
+ * solo escriben en RAM (se pueden llamar desde la ISR). ServicioLCD() se
+ * llama seguido desde main y cada llamada manda a lo sumo un nibble (un
+ * pulso de E) de la primera celda que cambio, sin esperas de 40 us ni el
+ * 1.64 ms del comando de borrado.
+ *
+ * lcdSombra[] es lo que se quiere ver y lcdFisico[] lo que el HD44780 ya
+ * tiene. Una celda esta sucia mientras sean distintas; si la ISR cambia una
+ * celda mientras se esta enviando, en la siguiente pasada vuelve a salir.
+ *
+ * Las direcciones son las mismas de DireccionaLCD: 0x80..0x8F primera linea
+ * y 0xC0..0xCF segunda linea.
+ *
+ * Con _XTAL_FREQ de mas de 4 MHz dos llamadas seguidas pueden llegar antes de
+ * que el HD44780 termine el byte anterior (37 us). TerminaPasoLCD guarda el
+ * valor de Timer3 (RELOJ_T3_HZ, lo configura main) y ServicioLCD retorna 1
+ * sin dar el pulso mientras no pasen LCD_TICKS_PASO: no se espera dentro de
+ * la llamada. Con RW (y el LCD contestando) en vez del tiempo se lee BF una
+ * vez por llamada.
+ */
+
+#ifndef LIBLCDBUFXC8_H
+#define	LIBLCDBUFXC8_H
+
+#include "LibLCDXC8_1.h"
+
+#define LCD_COLUMNAS 16
+#define LCD_CELDAS 32                   // 2 lineas de 16.
+#define LCD_SIN_DIRECCION 0xFF          // No se sabe donde quedo el contador de direcciones del HD44780.
+
+#define PASO_LIBRE 0                    // No hay byte a medio enviar.
+#define PASO_NIBBLE_BAJO 1              // Ya salio el nibble alto, falta el bajo.
+
+#define TIPO_DATO 0                     // Que se esta enviando en el paso en curso.
+#define TIPO_DIRECCION 1
+#define TIPO_CURSOR 2
+
+#if _XTAL_FREQ > 4000000
+#ifndef RELOJ_T3_HZ
+#error "LibLCDBufXC8.h: con reloj de mas de 4 MHz hace falta Timer3 libre a RELOJ_T3_HZ (ConfigReloj.h)"
+#endif
+#define LCD_TICKS_PASO ((unsigned short)((RELOJ_T3_HZ * 37UL + 999999UL) / 1000000UL)) // 37 us en ticks de Timer3 (hacia arriba).
+#ifdef RW
+#define LCD_TICKS_MAX ((unsigned short)(RELOJ_T3_HZ / 1000UL * (LCD_ESPERA_MAX_US / 1000))) // Sin respuesta de BF en este tiempo se vuelve a los 37 us.
+#endif
+#endif
+
+unsigned char lcdSombra[LCD_CELDAS];             // Contenido deseado.
+unsigned char lcdFisico[LCD_CELDAS];             // Contenido que ya tiene el LCD.
+volatile unsigned char lcdCursor;                // Celda donde debe quedar el cursor visible.
+volatile unsigned char lcdCursorVisible;         // 1 = cursor parpadeante encendido.
+unsigned char lcdCursorFisico;                   // Estado de cursor que ya tiene el LCD.
+unsigned char lcdDireccionFisica;                // Celda a la que apunta el HD44780 (o LCD_SIN_DIRECCION).
+unsigned char lcdBusqueda;                       // Celda desde la que se empieza a buscar cambios (reparte el trabajo).
+
+unsigned char lcdPaso;                           // PASO_LIBRE o PASO_NIBBLE_BAJO.
+unsigned char lcdTipo;                           // TIPO_DATO, TIPO_DIRECCION o TIPO_CURSOR.
+unsigned char lcdByte;                           // Byte que se esta enviando.
+unsigned char lcdCelda;                          // Celda a la que corresponde el byte en curso.
+#if _XTAL_FREQ > 4000000
+unsigned char lcdOcupado;                        // 1 = el HD44780 puede estar ejecutando el ultimo byte.
+unsigned short lcdMarca;                         // Timer3 cuando salio ese byte.
+#endif
+
+void IniciaBufLCD(void);
+unsigned char CeldaLCD(unsigned char);
+void BorraBufLCD(void);
+void EscribeBufLCD_c(unsigned char, unsigned char);
+void EscribeBufLCD_n(unsigned char, unsigned int, unsigned char);
+void MensajeBufLCD(unsigned char, const char *);
+void CursorBufLCD(unsigned char, unsigned char);
+void PulsoLCD(void);
+void EnviaNibbleLCD(unsigned char);
+void TerminaPasoLCD(void);
+#if _XTAL_FREQ > 4000000
+unsigned short TiempoLCD(void);
+unsigned char OcupadoLCD(void);
+#endif
+unsigned char ServicioLCD(void);
+void VaciaBufLCD(void);
+
+
+void IniciaBufLCD(void){
+//Funcion que deja el LCD y la pantalla sombra en blanco
+//Es la unica que usa las esperas largas (BorraLCD): se llama una vez al arrancar,
+//despues de los mensajes de bienvenida, y tambien deshace el desplazamiento de pantalla
+    unsigned char i;
+
+    BorraLCD();
+    OcultarCursor();
+    for(i = 0; i < LCD_CELDAS; i++){
+        lcdSombra[i] = ' ';
+        lcdFisico[i] = ' ';
+    }
+    lcdCursor = 0;
+    lcdCursorVisible = 0;
+    lcdCursorFisico = 0;
+    lcdDireccionFisica = 0;             // BorraLCD deja la direccion en 0x80.
+    lcdBusqueda = 0;
+    lcdPaso = PASO_LIBRE;
+#if _XTAL_FREQ > 4000000
+    lcdOcupado = 0;                     // BorraLCD y OcultarCursor ya esperaron.
+#endif
+}
+unsigned char CeldaLCD(unsigned char direccion){
+//Funcion que convierte una direccion 0x80..0x8F / 0xC0..0xCF en celda 0..31
+    return (unsigned char)(((direccion & 0x40) ? LCD_COLUMNAS : 0) + (direccion & 0x0F));
+}
+void BorraBufLCD(void){
+//Funcion que llena la pantalla sombra de espacios (reemplaza a BorraLCD)
+    unsigned char i;
+
+    for(i = 0; i < LCD_CELDAS; i++){
+        lcdSombra[i] = ' ';
+    }
+    lcdCursorVisible = 0;
+}
+void EscribeBufLCD_c(unsigned char direccion, unsigned char a){
+//Funcion que escribe un caracter en la posicion indicada
+//Ejemplo EscribeBufLCD_c(0xC7, 1); dibuja el caracter CGRAM 1
+    lcdSombra[CeldaLCD(direccion)] = a;
+}
+void EscribeBufLCD_n(unsigned char direccion, unsigned int a, unsigned char b){
+//Funcion que escribe un numero positivo de 16 bits con b digitos (1 a 5)
+//empezando en la posicion indicada, igual que EscribeLCD_n16
+    unsigned char celda, i;
+    unsigned char digitos[5];
+
+    if(b == 0 || b > 5){
+        return;
+    }
+    BCD_Convierte16(a, digitos);        // Sin divisiones: tambien se llama desde la ISR.
+    celda = CeldaLCD(direccion);
+    for(i = 5 - b; i < 5; i++){
+        lcdSombra[celda] = digitos[i] + '0';
+        celda++;
+    }
+}
+void MensajeBufLCD(unsigned char direccion, const char *a){
+//Funcion que escribe una cadena desde la posicion indicada
+//Se corta al final de la linea, no pasa a la siguiente
+    unsigned char celda, fin;
+
+    celda = CeldaLCD(direccion);
+    fin = (celda < LCD_COLUMNAS) ? LCD_COLUMNAS : LCD_CELDAS;
+    while(*a != '\0' && celda < fin){
+        lcdSombra[celda] = (unsigned char)*a;
+        celda++;
+        a++;
+    }
+}
+void CursorBufLCD(unsigned char direccion, unsigned char visible){
+//Funcion que ubica el cursor parpadeante (visible=1) o lo oculta (visible=0)
+    lcdCursor = CeldaLCD(direccion);
+    lcdCursorVisible = visible;
+}
+void PulsoLCD(void){
+//Funcion que genera un pulso corto en E (sin los 40 us de HabilitaLCD)
+    E = 1;
+    PausaE();                           // El HD44780 pide E en alto al menos 450 ns.
+    E = 0;
+}
+void EnviaNibbleLCD(unsigned char a){
+//Funcion que pone en el bus los 4 bits altos de a (o el byte completo en modo 8 bits) y da el pulso
+    if(interfaz == 4){
+        Datos = (Datos & 0b00001111) | (a & 0b11110000);
+    }else{
+        Datos = a;
+    }
+    PulsoLCD();
+}
+unsigned char ServicioLCD(void){
+//Funcion que avanza un paso la actualizacion del LCD
+//Cada llamada da a lo sumo un pulso de E. Retorna 1 si hizo algo (o si el LCD sigue ocupado
+//con el byte anterior) y 0 si el LCD ya esta al dia
+//A 4 MHz o menos la propia llamada ya tarda mas que los 37 us de un byte
+    unsigned char i, celda;
+
+#if _XTAL_FREQ > 4000000
+    if(lcdPaso == PASO_LIBRE && OcupadoLCD() == 1){
+        return 1;                       // Todavia no: se vuelve a llamar sin esperar aqui.
+    }
+#endif
+    if(lcdPaso == PASO_NIBBLE_BAJO){    // Termina el byte que quedo a la mitad.
+        EnviaNibbleLCD((unsigned char)(lcdByte << 4));
+        TerminaPasoLCD();
+        return 1;
+    }
+
+    celda = LCD_SIN_DIRECCION;          // Busca la siguiente celda sucia empezando donde quedo la busqueda anterior.
+    i = lcdBusqueda;
+    do{
+        if(lcdSombra[i] != lcdFisico[i]){
+            celda = i;
+            break;
+        }
+        i++;
+        if(i == LCD_CELDAS){
+            i = 0;
+        }
+    }while(i != lcdBusqueda);
+
+    if(celda != LCD_SIN_DIRECCION){
+        lcdBusqueda = celda;
+        lcdCelda = celda;
+        if(lcdDireccionFisica != celda){ // Primero hay que mover el contador de direcciones.
+            lcdTipo = TIPO_DIRECCION;
+            lcdByte = 0x80 | ((celda >= LCD_COLUMNAS) ? 0x40 : 0x00) | (celda & 0x0F);
+            RS = 0;
+        }else{
+            lcdTipo = TIPO_DATO;
+            lcdByte = lcdSombra[celda];  // Se congela el valor: si la ISR lo cambia, la celda sigue sucia.
+            RS = 1;
+        }
+    }else if(lcdCursorVisible != lcdCursorFisico){ // Pantalla al dia: falta prender/apagar el cursor.
+        lcdTipo = TIPO_CURSOR;
+        lcdByte = lcdCursorVisible ? 0x0F : 0x0C;
+        RS = 0;
+    }else if(lcdCursorVisible == 1 && lcdDireccionFisica != lcdCursor){ // El cursor visible debe quedar en su celda.
+        lcdTipo = TIPO_DIRECCION;
+        lcdCelda = lcdCursor;
+        lcdByte = 0x80 | ((lcdCelda >= LCD_COLUMNAS) ? 0x40 : 0x00) | (lcdCelda & 0x0F);
+        RS = 0;
+    }else{
+        return 0;                       // Nada pendiente.
+    }
+
+    EnviaNibbleLCD(lcdByte);
+    if(interfaz == 4){
+        lcdPaso = PASO_NIBBLE_BAJO;     // El nibble bajo sale en la proxima llamada.
+    }else{
+        TerminaPasoLCD();               // En 8 bits el byte completo ya salio.
+    }
+    return 1;
+}
+void TerminaPasoLCD(void){
+//Funcion que registra el efecto del byte que se acaba de completar
+    lcdPaso = PASO_LIBRE;
+#if _XTAL_FREQ > 4000000
+    lcdMarca = TiempoLCD();             // Con reloj rapido la siguiente llamada podria llegar antes de que el LCD termine.
+    lcdOcupado = 1;
+#endif
+    if(lcdTipo == TIPO_DATO){
+        lcdFisico[lcdCelda] = lcdByte;
+        lcdDireccionFisica = lcdCelda + 1;
+        if(lcdDireccionFisica == LCD_COLUMNAS || lcdDireccionFisica == LCD_CELDAS){
+            lcdDireccionFisica = LCD_SIN_DIRECCION; // Al final de la linea el HD44780 no salta a la otra.
+        }
+    }else if(lcdTipo == TIPO_DIRECCION){
+        lcdDireccionFisica = lcdCelda;
+    }else{
+        lcdCursorFisico = lcdByte & 0x01;
+    }
+}
+#if _XTAL_FREQ > 4000000
+unsigned short TiempoLCD(void){
+//Funcion que lee Timer3 desde main sin que la ISR corrompa la parte alta (igual que Tareas_Tiempo)
+    unsigned short tiempo;
+    unsigned char gie;
+
+    gie = GIE;
+    GIE = 0;
+    tiempo = TMR3;
+    GIE = gie;
+    return tiempo;
+}
+unsigned char OcupadoLCD(void){
+//Funcion que retorna 1 si el byte que cerro TerminaPasoLCD puede seguir ejecutandose
+//Con RW lee BF una vez; sin RW (o si el LCD dejo de contestar) cuenta LCD_TICKS_PASO desde lcdMarca
+    unsigned short espera;
+
+    if(lcdOcupado == 0){
+        return 0;
+    }
+    espera = (unsigned short)(TiempoLCD() - lcdMarca);
+#ifdef RW
+    if(lcdLeeOcupado == 1){
+        if(LeeOcupadoLCD() == 0){
+            lcdOcupado = 0;
+            return 0;
+        }
+        if(espera < LCD_TICKS_MAX){
+            return 1;
+        }
+        lcdLeeOcupado = 0;              // Igual que EsperaOcupadoLCD: sin respuesta se vuelve a los tiempos fijos.
+    }
+#endif
+    if(espera <= LCD_TICKS_PASO){       // Con <= pasa al menos LCD_TICKS_PASO completos aunque lcdMarca caiga a mitad de un tick.
+        return 1;
+    }
+    lcdOcupado = 0;
+    return 0;
+}
+#endif
+void VaciaBufLCD(void){
+//Funcion que manda todo lo pendiente esperando entre pasos (bloquea)
+//Solo para cuando main se va a quedar detenido (por ejemplo la parada de emergencia)
+//Aunque haya R/W se esperan los 40 us fijos: a 1 MHz leer BF (dos pulsos de lectura) tarda mas
+    while(ServicioLCD() == 1){
+        __delay_us(40);
+    }
+}
+#endif	/* LIBLCDBUFXC8_H */
@@ -17,11 +17,18 @@ extern "C" {
 }
 #endif
 #include<xc.h>
+#include "LibBCDXC8.h"
 #ifndef _XTAL_FREQ
 #define _XTAL_FREQ 1000000
 #endif
 #ifndef Datos
 #define Datos LATD	//El puerto de conexin de los datos el cual se puede cambiar
+#endif			//(ConfigLCD.h elige el puerto y el bus de 4 u 8 bits)
+#ifndef DatosLee
+#define DatosLee PORTD	//Lectura y direccin del mismo puerto
+#endif
+#ifndef DatosTris
+#define DatosTris TRISD
 #endif
 #ifndef RS
 #define RS LATA4	//Los pines de control al LCD los cuales se
@@ -29,8 +36,26 @@ extern "C" {
 #ifndef E
 #define E LATA5	//pueden cambiar
 #endif
+//R/W es opcional: sin RW definido R/W va a tierra y se esperan los retardos fijos de
+//RetardoLCD. Con RW definido antes de incluir la librera (y RW_TRIS si la librera
+//debe dejar el pin como salida) se lee la bandera de ocupado (BF en D7) despus de
+//cada byte. Si el LCD no la baja en LCD_ESPERA_MAX_US se vuelve a los retardos fijos
+#ifdef RW
+#ifndef LCD_ESPERA_MAX_US
+#define LCD_ESPERA_MAX_US 4000	//Ms que el borrado de pantalla (1.64 ms)
+#endif
+#define LCD_SONDEO_US 10	//Pausa entre dos lecturas de BF
+#endif
+#if _XTAL_FREQ > 8000000
+#define PausaE() __delay_us(1)	//El HD44780 pide E en alto al menos 450 ns
+#else
+#define PausaE() NOP()	//A 8 MHz o menos un ciclo de instruccin ya dura 500 ns o ms
+#endif
 
 unsigned char interfaz=8;
+#ifdef RW
+unsigned char lcdLeeOcupado=0;	//1 = InicializaLCD termin y el LCD contesta por R/W
+#endif
 
 void ConfiguraLCD(unsigned char);
 void RetardoLCD(unsigned char);
@@ -52,17 +77,26 @@ void DesplazaPantallaI(void);
 void CrearCaracter(unsigned char *,unsigned char);
 void OcultarCursor(void);
 void MostrarCursor(void);
+#ifdef RW
+unsigned char LeeOcupadoLCD(void);
+unsigned char EsperaOcupadoLCD(void);
+#endif
 
 
 void ConfiguraLCD(unsigned char a){
-	if(a==4 | a ==8)
+	if(a==4 || a ==8)
 		interfaz=a;	
 }
 void EnviaDato(unsigned char a){
 	if(interfaz==4){
 		Datos=(Datos & 0b00001111) | (a & 0b11110000);
 		HabilitaLCD();
+#ifdef RW
+		if(lcdLeeOcupado==0)
+			RetardoLCD(1);	//Entre los dos nibbles no hace falta esperar: se deja solo sin R/W
+#else
 		RetardoLCD(1);
+#endif
 		Datos=(Datos & 0b00001111) | (a<<4);
 		//HabilitaLCD();
 		//RetardoLCD(1);
@@ -72,6 +106,18 @@ void EnviaDato(unsigned char a){
 }
 void InicializaLCD(void){
 //Funcin que inicializa el LCD caracteres
+//Usa siempre los retardos fijos: BF no se puede leer antes del "function set"
+	if(interfaz==4)
+		DatosTris&=0b00001111;	//Solo D7..D4 son del LCD
+	else
+		DatosTris=0x00;
+#ifdef RW
+	lcdLeeOcupado=0;
+#ifdef RW_TRIS
+	RW_TRIS=0;
+#endif
+	RW=0;
+#endif
 	RS=0;
 	if(interfaz==4)
 		Datos=(Datos & 0b00001111) | 0x30;//0011 1111
@@ -103,13 +149,27 @@ void InicializaLCD(void){
 	EnviaDato(0xF);//0000 1111
 	HabilitaLCD();
 	RetardoLCD(4);	
+#ifdef RW
+	lcdLeeOcupado=1;	//Desde aqu se espera con BF
+#endif
 }
 void HabilitaLCD(void){
 //Funcin que genera los pulsos de habilitacin al LCD 	
 	E=1;
+#ifdef RW
+	if(lcdLeeOcupado==1)
+		PausaE();	//Con BF no hace falta el pulso largo
+	else
+		__delay_us(40);
+#else
 	__delay_us(40);
+#endif
     //Delay1TCY();
 	E=0;
+#ifdef RW
+	if(lcdLeeOcupado==1)
+		PausaE();	//Sin los 40 us, E tambin tiene que quedar en bajo antes del siguiente pulso
+#endif
 }
 void BorraLCD(void){
 //Funcin que borra toda la pantalla	
@@ -151,37 +211,16 @@ void EscribeLCD_n8(unsigned char a,unsigned char b){
 //a es el nmero a escribir, el cual debe estar en el rango de 0 a 255
 //b es el nmero de digitos que se desea mostrar empezando desde las unidades
 //Ejemplo EscribeLCD_n8(204,3);	
-    unsigned char centena,decena,unidad;
+//Los digitos salen de BCD_Convierte8 (LibBCDXC8.h), sin divisiones
+    unsigned char digitos[3],i;
 	RS=1;
-	switch(b){
-		case 1: unidad=a%10;
-				EnviaDato(unidad+48);
-				HabilitaLCD();
-				RetardoLCD(4);
-				break;
-		case 2:	decena=(a%100)/10;
-				unidad=a%10;
-				EnviaDato(decena+48);
-				HabilitaLCD();
-				RetardoLCD(4);
-				EnviaDato(unidad+48);
-				HabilitaLCD();
-				RetardoLCD(4);
-				break;
-		case 3: centena=a/100;
-				decena=(a%100)/10;
-				unidad=a%10;
-				EnviaDato(centena+48);
-				HabilitaLCD();
-				RetardoLCD(4);
-				EnviaDato(decena+48);
-				HabilitaLCD();
-				RetardoLCD(4);
-				EnviaDato(unidad+48);
-				HabilitaLCD();
-				RetardoLCD(4);
-				break;
-		default: break;
+	if(b==0 || b>3)
+		return;
+	BCD_Convierte8(a,digitos);
+	for(i=3-b;i<3;i++){
+		EnviaDato(digitos[i]+48);
+		HabilitaLCD();
+		RetardoLCD(4);
 	}
 }
 void EscribeLCD_n16(unsigned int a,unsigned char b){
@@ -189,46 +228,15 @@ void EscribeLCD_n16(unsigned int a,unsigned char b){
 //a es el nmero a escribir, el cual debe estar en el rango de 0 a 65535
 //b es el nmero de digitos que se desea mostrar empezando desde las unidades
 //Ejemplo EscribeLCD_n16(12754,5);	
-    unsigned char decena,unidad;
-	unsigned int centena,millar;
+//Los digitos salen de BCD_Convierte16 (LibBCDXC8.h), sin divisiones
+    unsigned char digitos[5],i;
     RS=1;
-	switch(b){
-		case 1: unidad=a%10;
-                EscribeLCD_c(unidad+48);
-				break;
-		case 2:	decena=(a%100)/10;
-				unidad=a%10;
-				EscribeLCD_c(decena+48);
-                EscribeLCD_c(unidad+48);
-				break;
-		case 3: centena=(a%1000)/100;
-                decena=(a%100)/10;
-				unidad=a%10;
-                EscribeLCD_c(centena+48);
-				EscribeLCD_c(decena+48);
-                EscribeLCD_c(unidad+48);
-				break;
-		case 4: millar=(a%10000)/1000;
-                centena=(a%1000)/100;
-                decena=(a%100)/10;
-				unidad=a%10;
-                EscribeLCD_c(millar+48);
-				EscribeLCD_c(centena+48);
-				EscribeLCD_c(decena+48);
-                EscribeLCD_c(unidad+48);
-				break;
-		case 5: EscribeLCD_c(a/10000 +48);
-				millar=(a%10000)/1000;
-                centena=(a%1000)/100;
-                decena=(a%100)/10;
-				unidad=a%10;
-                EscribeLCD_c(millar+48);
-				EscribeLCD_c(centena+48);
-				EscribeLCD_c(decena+48);
-                EscribeLCD_c(unidad+48);
-				break;
-		default: break;
-	}	
+	if(b==0 || b>5)
+		return;
+	BCD_Convierte16(a,digitos);
+	for(i=5-b;i<5;i++){
+		EscribeLCD_c(digitos[i]+48);
+	}
 }
 void EscribeLCD_d(double num, unsigned char digi, unsigned char digd){
 	
@@ -288,6 +296,11 @@ void DesplazaCursorI(void){
   RetardoLCD(4);
 }		
 void RetardoLCD(unsigned char a){
+//Con R/W los retardos de borrado (2) y de cada byte (4) se cambian por la espera de BF
+#ifdef RW
+	if(lcdLeeOcupado==1 && (a==2 || a==4) && EsperaOcupadoLCD()==1)
+		return;
+#endif
 	switch(a){
 		case 1: __delay_ms(15);
                 //Delay100TCYx(38); //Retardo de mas de 15 ms
@@ -326,4 +339,48 @@ void OcultarCursor(void){
 void MostrarCursor(void){
     ComandoLCD(0xF);
 }
+#ifdef RW
+unsigned char LeeOcupadoLCD(void){
+//Funcin que lee la bandera de ocupado: retorna 1 si el LCD todava est ejecutando
+//En 4 bits hay que dar dos pulsos: el primero trae BF y el segundo (contador de direcciones) se descarta
+	unsigned char bf,rs;
+	rs=RS;
+	if(interfaz==4)
+		DatosTris|=0b11110000;	//D7..D4 como entradas (D3..D0 siguen siendo del puerto)
+	else
+		DatosTris=0xFF;
+	RS=0;
+	RW=1;
+	E=1;
+	PausaE();	//BF sale 360 ns despus de subir E
+	bf=(DatosLee & 0b10000000)!=0;
+	E=0;
+	PausaE();	//El ciclo de E es de 1 us: otro tanto en bajo antes del siguiente pulso
+	if(interfaz==4){
+		E=1;
+		PausaE();
+		E=0;
+		PausaE();
+	}
+	RW=0;
+	if(interfaz==4)
+		DatosTris&=0b00001111;
+	else
+		DatosTris=0x00;
+	RS=rs;
+	return bf;
+}
+unsigned char EsperaOcupadoLCD(void){
+//Funcin que espera a que el LCD baje BF
+//Retorna 0 si pasaron LCD_ESPERA_MAX_US sin respuesta: desde ah se usan los retardos fijos
+	unsigned int t;
+	for(t=0;t<LCD_ESPERA_MAX_US;t+=LCD_SONDEO_US){
+		if(LeeOcupadoLCD()==0)
+			return 1;
+		__delay_us(LCD_SONDEO_US);
+	}
+	lcdLeeOcupado=0;
+	return 0;
+}
+#endif
 #endif	/* LIBLCDXC8_H */
\ No newline at end of file
@@ -0,0 +1,153 @@
+/*
+ * File:   LibMedicionXC8.h
+ *
+ * Medicion opcional (en compilacion) del tiempo de cada rama de la ISR con
+ * Timer3 libre (RELOJ_T3_HZ: 4 us por tick a 1 MHz). Las tareas de main ya
+ * tienen sus medidas en LibTareasXC8.h (GET TASK n); esto mide lo que corre
+ * dentro de la interrupcion, que LibTareasXC8.h cuenta dentro de la tarea
+ * que estaba corriendo.
+ *
+ * Sin MEDICION_ISR definido todas las macros quedan vacias y la ISR no cambia
+ * (ni un ciclo ni un byte de RAM). Con MEDICION_ISR (en Lab5.c, o con
+ * make host HOST_CFLAGS="... -DMEDICION_ISR"):
+ *   MEDICION_ENTRA_ISR() / MEDICION_SALE_ISR()   al principio y al final de la ISR
+ *   MEDICION_INICIO() / MEDICION_FIN(id)         al principio y al final de una rama
+ *   MEDICION_LATENCIA(id, captura)               ticks desde una captura (CCPR2) hasta
+ *                                                ese punto de la ISR: latencia del sensor
+ *   MEDICION_ENTRA_ALTA() / MEDICION_SALE_ALTA(id)
+ *   MEDICION_INICIO_ALTA() / MEDICION_FIN_ALTA(id)  lo mismo en la ISR de alta prioridad
+ *                                                (IPEN=1), con sus propios inicios: puede
+ *                                                entrar en medio de una rama de la otra
+ * Cada posicion de la tabla guarda veces, ultimo, minimo y maximo en ticks de
+ * Timer3. Lo que hace el compilador antes de la primera linea de la ISR
+ * (guardar el contexto) no entra en MEDICION_ENTRA_ISR pero si en la latencia.
+ * Cada medicion cuesta unos 30 ciclos. Lo que mide la ISR de baja prioridad
+ * incluye el tiempo que la de alta le quito en medio.
+ *
+ * En el simulador (make host HOST_CFLAGS=... -DMEDICION_ISR, o
+ * host/lab5-sim-med de make isr) Timer3 solo avanza dentro de la ISR con los
+ * retardos que llame la rama: el costo de cada causa (ciclosCausa) y el de
+ * entrar y salir los cobra host/sim.c fuera de ISR_Alta/ISR_Baja, asi que una
+ * rama sin retardos mide 0 y la latencia solo ve la mitad de la entrada que
+ * va antes de la primera linea. host/medicion.txt revisa esos valores, que
+ * son del modelo y no medidas: no sirven como presupuesto de latencia del
+ * sensor. Las cifras de verdad salen de la tarjeta, del listado de XC8
+ * (ciclos por instruccion) o del stopwatch del simulador de MPLAB.
+ *
+ * Con MEDICION_PIN y MEDICION_PIN_TRIS definidos (por ejemplo LATC0 y
+ * TRISC0) ese pin queda en 1 mientras corre la ISR, para verlo con un
+ * analizador logico.
+ */
+
+#ifndef LIBMEDICIONXC8_H
+#define	LIBMEDICIONXC8_H
+
+#include "LibHALXC8.h"
+
+#ifdef MEDICION_ISR
+
+#ifndef MEDICION_MAX
+#define MEDICION_MAX 10                 // Posiciones de la tabla (las define quien usa la libreria).
+#endif
+
+typedef struct {
+    unsigned int veces;
+    unsigned short ultimo;              // Ticks de Timer3 (16 bits tambien en gcc: make host).
+    unsigned short minimo;
+    unsigned short maximo;
+} Medicion;
+
+Medicion mediciones[MEDICION_MAX];
+unsigned short medicionInicioISR;                // TMR3 al entrar a la ISR.
+unsigned short medicionInicio;                   // TMR3 al entrar a la rama actual.
+unsigned short medicionInicioISRAlta;            // Lo mismo para la ISR de alta prioridad.
+unsigned short medicionInicioAlta;
+
+#ifdef MEDICION_PIN
+#define MEDICION_PIN_ALTO() MEDICION_PIN = 1
+#define MEDICION_PIN_BAJO() MEDICION_PIN = 0
+#else
+#define MEDICION_PIN_ALTO()
+#define MEDICION_PIN_BAJO()
+#endif
+
+#define MEDICION_ENTRA_ISR()   do{ MEDICION_PIN_ALTO(); medicionInicioISR = TMR3; }while(0)
+#define MEDICION_SALE_ISR(id)  do{ Medicion_Registra(id, (unsigned short)(TMR3 - medicionInicioISR)); MEDICION_PIN_BAJO(); }while(0)
+#define MEDICION_INICIO()      medicionInicio = TMR3
+#define MEDICION_FIN(id)       Medicion_Registra(id, (unsigned short)(TMR3 - medicionInicio))
+#define MEDICION_LATENCIA(id, captura) Medicion_Registra(id, (unsigned short)(TMR3 - (captura)))
+#define MEDICION_ENTRA_ALTA()  medicionInicioISRAlta = TMR3
+#define MEDICION_SALE_ALTA(id) Medicion_Registra(id, (unsigned short)(TMR3 - medicionInicioISRAlta))
+#define MEDICION_INICIO_ALTA() medicionInicioAlta = TMR3
+#define MEDICION_FIN_ALTA(id)  Medicion_Registra(id, (unsigned short)(TMR3 - medicionInicioAlta))
+
+void Medicion_Inicia(void);
+void Medicion_Registra(unsigned char, unsigned short);
+unsigned char Medicion_Copia(unsigned char, Medicion *);
+
+
+void Medicion_Inicia(void){
+//Funcion que borra la tabla (y deja el pin en 0)
+    unsigned char i;
+
+    for(i = 0; i < MEDICION_MAX; i++){
+        mediciones[i].veces = 0;
+        mediciones[i].ultimo = 0;
+        mediciones[i].minimo = 0xFFFF;
+        mediciones[i].maximo = 0;
+    }
+#ifdef MEDICION_PIN
+    MEDICION_PIN_TRIS = 0;
+    MEDICION_PIN = 0;
+#endif
+}
+void Medicion_Registra(unsigned char id, unsigned short ticks){
+//Funcion que suma una medicion (solo desde las ISR; XC8 la duplica para cada prioridad y cada id es de una sola)
+    Medicion *m;
+
+    m = &mediciones[id];
+    if(m->veces != 0xFFFF){
+        m->veces++;
+    }
+    m->ultimo = ticks;
+    if(ticks < m->minimo){
+        m->minimo = ticks;
+    }
+    if(ticks > m->maximo){
+        m->maximo = ticks;
+    }
+}
+unsigned char Medicion_Copia(unsigned char id, Medicion *copia){
+//Funcion que copia una posicion de la tabla desde main (GIE=0: la ISR la cambia a medias)
+//Retorna 0 si id no existe
+    unsigned char gie;
+
+    if(id >= MEDICION_MAX){
+        return 0;
+    }
+    gie = GIE;
+    GIE = 0;
+    *copia = mediciones[id];
+    GIE = gie;
+    if(copia->veces == 0){
+        copia->minimo = 0;              // Sin mediciones el 0xFFFF inicial no dice nada.
+    }
+    return 1;
+}
+
+#else
+
+#define MEDICION_ENTRA_ISR()
+#define MEDICION_SALE_ISR(id)
+#define MEDICION_INICIO()
+#define MEDICION_FIN(id)
+#define MEDICION_LATENCIA(id, captura)
+#define MEDICION_ENTRA_ALTA()
+#define MEDICION_SALE_ALTA(id)
+#define MEDICION_INICIO_ALTA()
+#define MEDICION_FIN_ALTA(id)
+#define Medicion_Inicia()
+
+#endif	/* MEDICION_ISR */
+
+#endif	/* LIBMEDICIONXC8_H */
@@ -0,0 +1,162 @@
+/*
+ * File:   LibMotorXC8.h
+ *
+ * Control del motor en RC2 con PWM de CCP1, histeresis, tiempos minimos de
+ * encendido/apagado y rampa. Reemplaza MOTOR = (adcValor >= 511), que cerca
+ * del umbral prendia y apagaba el motor en cada decision.
+ *
+ * Motor_Decide() se llama desde main con el ADC filtrado y el modo
+ * (ordenMotor): en automatico enciende con adc >= MOTOR_UMBRAL + la mitad de
+ * MOTOR_HISTERESIS y apaga con adc < MOTOR_UMBRAL - la otra mitad, y solo si
+ * el estado actual ya duro MOTOR_PERMANENCIA decisiones. Los modos forzados
+ * (E/A) cambian de inmediato.
+ *
+ * Motor_Rampa() se llama desde la ISR en cada tick y mueve el ciclo util
+ * MOTOR_RAMPA_PASO hacia 0 o hacia MOTOR_DUTY_MAX. Timer2 con PR2 = 249 y el
+ * prescaler de ConfigReloj.h da 1 kHz a 1 MHz (2 kHz a 8 MHz y 3 kHz a
+ * 48 MHz, MOTOR_PWM_HZ); el ciclo util va en CCPR1L (0..250, los dos
+ * bits bajos DC1B quedan en 0), asi todo el estado es de 8 bits y main y la
+ * ISR lo comparten sin GIE=0.
+ *
+ * Motor_Parada() (macro, se usa en la ISR y en main) bloquea el motor hasta
+ * el reset: apaga CCP1 y RC2 queda en 0 en ese mismo ciclo, sin rampa. Con
+ * solo CCPR1L = 0 el PWM lo tomaria al empezar el siguiente periodo (hasta
+ * 1 ms con el motor todavia encendido).
+ */
+
+#ifndef LIBMOTORXC8_H
+#define	LIBMOTORXC8_H
+
+#include "LibHALXC8.h"
+
+#ifndef MOTOR_UMBRAL
+#define MOTOR_UMBRAL 2044               // ADC de 12 bits: 511 de 1023 llevado a 12 bits (mitad del potenciometro).
+#endif
+
+#ifndef MOTOR_HISTERESIS
+#define MOTOR_HISTERESIS 160            // Banda alrededor del umbral (cuentas de 12 bits, ~4 %).
+#endif
+
+#ifndef MOTOR_PERMANENCIA
+#define MOTOR_PERMANENCIA 8             // Decisiones que debe durar un estado antes de cambiar (8 x 250 ms = 2 s en Lab5).
+#endif
+
+#ifndef MOTOR_PR2
+#define MOTOR_PR2 249                   // Periodo del PWM: (PR2 + 1) x 4 x Tosc x prescaler = 1 ms a 1 MHz.
+#endif
+
+#define MOTOR_PWM_HZ (_XTAL_FREQ / 4 / (1 << (2 * RELOJ_T2CKPS)) / (MOTOR_PR2 + 1)) // Prescaler de Timer2: 1, 4 o 16.
+
+#ifndef MOTOR_RAMPA_PASO
+#define MOTOR_RAMPA_PASO 5              // Ciclo util que cambia por tick: de 0 a 100 % en 50 ticks (500 ms).
+#endif
+
+#define MOTOR_DUTY_MAX (MOTOR_PR2 + 1)  // CCPR1L para 100 % (con DC1B = 0).
+
+#if MOTOR_PR2 > 254
+#error "MOTOR_PR2 maximo 254: el ciclo util completo debe caber en CCPR1L"
+#endif
+
+volatile unsigned char motorEncendido;           // Decision de main (1 = el motor debe quedar encendido).
+volatile unsigned char motorBloqueo;             // 1 = parada de emergencia: ciclo util 0 hasta el reset.
+volatile unsigned char motorDuty;                // Ciclo util que tiene CCPR1L (solo lo cambia la ISR).
+unsigned char motorPermanencia;                  // Decisiones desde el ultimo cambio (se queda en 255).
+unsigned int motorConmutaciones;                 // Veces que cambio motorEncendido.
+
+#define Motor_Parada() do{ MOTOR = 0; CCP1CON = 0; motorBloqueo = 1; motorEncendido = 0; CCPR1L = 0; }while(0) // Macro: se usa desde la ISR y desde main. El pin primero.
+
+void Motor_Inicia(void);
+void Motor_Decide(unsigned int, unsigned char);
+void Motor_Rampa(void);
+unsigned char Motor_Porcentaje(void);
+void Motor_PreparaSleep(void);
+void Motor_DespuesSleep(void);
+
+
+void Motor_Inicia(void){
+//Funcion que configura Timer2 y CCP1 en PWM con el motor apagado
+//TRISC2 lo configura main
+    motorEncendido = 0;
+    motorBloqueo = 0;
+    motorDuty = 0;
+    motorPermanencia = 255;             // El primer cambio no espera.
+    motorConmutaciones = 0;
+    MOTOR = 0;                          // Nivel del pin si se apaga CCP1 (Motor_PreparaSleep).
+    PR2 = MOTOR_PR2;
+    CCPR1L = 0;
+    T2CON = 0b00000100 | RELOJ_T2CKPS;  // TMR2ON, prescaler de ConfigReloj.h (el postscaler solo afecta TMR2IF, que no se usa).
+    CCP1CON = 0b00001100;               // P1M=00 (una salida, P1A=RC2), DC1B=00, modo PWM.
+}
+void Motor_Decide(unsigned int adc, unsigned char orden){
+//Funcion que decide si el motor debe quedar encendido (desde main)
+//orden: 0 automatico con el ADC, 1 forzado encendido, 2 forzado apagado
+    unsigned char encender;
+
+    encender = motorEncendido;
+    if(orden == 1){
+        encender = 1;
+    }else if(orden == 2){
+        encender = 0;
+    }else if(motorPermanencia >= MOTOR_PERMANENCIA){
+        if(encender == 0 && adc >= MOTOR_UMBRAL + MOTOR_HISTERESIS / 2){
+            encender = 1;
+        }else if(encender == 1 && adc < MOTOR_UMBRAL - MOTOR_HISTERESIS / 2){
+            encender = 0;
+        }
+    }
+
+    if(motorBloqueo == 1){
+        return;                         // La parada de emergencia ya lo dejo en 0 y no se vuelve a encender.
+    }
+    if(encender != motorEncendido){
+        motorEncendido = encender;
+        motorPermanencia = 0;
+        motorConmutaciones++;
+    }else if(motorPermanencia != 255){
+        motorPermanencia++;
+    }
+}
+void Motor_Rampa(void){
+//Funcion que se llama desde la ISR en cada tick: acerca el ciclo util al objetivo
+    unsigned char duty;
+
+    duty = motorDuty;
+    if(motorBloqueo == 1){
+        duty = 0;
+    }else if(motorEncendido == 1){
+        if(duty < MOTOR_DUTY_MAX - MOTOR_RAMPA_PASO){
+            duty += MOTOR_RAMPA_PASO;
+        }else{
+            duty = MOTOR_DUTY_MAX;
+        }
+    }else{
+        if(duty > MOTOR_RAMPA_PASO){
+            duty -= MOTOR_RAMPA_PASO;
+        }else{
+            duty = 0;
+        }
+    }
+    motorDuty = duty;
+    CCPR1L = duty;                      // El PWM lo toma al empezar el siguiente periodo.
+}
+unsigned char Motor_Porcentaje(void){
+//Funcion que retorna el ciclo util actual en porcentaje
+    return (unsigned char)((unsigned int)motorDuty * 100 / MOTOR_DUTY_MAX);
+}
+void Motor_PreparaSleep(void){
+//Funcion que apaga CCP1 antes de Sleep(): Timer2 se detiene y el PWM quedaria en el nivel de ese instante
+//RC2 queda fijo con la decision (la rampa se salta)
+    CCP1CON = 0;
+    MOTOR = motorEncendido;
+}
+void Motor_DespuesSleep(void){
+//Funcion que vuelve al PWM despues de Sleep() con el ciclo util que corresponde a la decision
+    if(motorBloqueo == 1){
+        return;                         // Despues de una parada CCP1 queda apagado y RC2 en 0.
+    }
+    motorDuty = motorEncendido ? MOTOR_DUTY_MAX : 0;
+    CCPR1L = motorDuty;
+    CCP1CON = 0b00001100;
+    MOTOR = 0;
+}
+#endif	/* LIBMOTORXC8_H */
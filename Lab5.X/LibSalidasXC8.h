@@ -0,0 +1,78 @@
+/*
+ * File:   LibSalidasXC8.h
+ *
+ * Etapa de salida del conteo: LED RGB (decenas) y display de 7 segmentos
+ * (unidades). Reemplaza la cadena de if/else de ActualizaRGB y las escrituras
+ * sueltas de LATD: el color sale de una tabla y el RGB y el display cambian
+ * juntos con GIE=0, asi que el costo por pieza es siempre el mismo.
+ *
+ * PORTD es compartido: RD0..RD3 llevan las unidades en BCD al decodificador
+ * del display y RD4..RD7 son el bus del LCD en modo 4 bits (Datos). Cada
+ * parte cambia solo su nibble (el LCD ya hace Datos & 0b00001111) y las dos
+ * escriben LATD solo desde main, asi que una pieza nunca cae en medio de un
+ * nibble del LCD. Antes SIETE_SEG = unidades ponia en 0 el bus del LCD.
+ * Con LCD_BUS 8 (ConfigLCD.h) el LCD va en el puerto B y RD4..RD7 quedan
+ * sin uso; la mascara no cambia.
+ *
+ * Bits del RGB (activos en 0): RE0 verde, RE1 azul, RE2 rojo.
+ *
+ * Salida_Alarma() deja el RGB en rojo y lo bloquea: el conteo sigue
+ * actualizando el display pero ya no cambia el color (la parada de
+ * emergencia la activa la ISR mientras main puede estar contando).
+ */
+
+#ifndef LIBSALIDASXC8_H
+#define	LIBSALIDASXC8_H
+
+#include "LibHALXC8.h"
+
+#define RGB_BLANCO   0b00000000
+#define RGB_MAGENTA  0b00000001
+#define RGB_AMARILLO 0b00000010
+#define RGB_ROJO     0b00000011
+#define RGB_CYAN     0b00000100
+#define RGB_AZUL     0b00000101
+#define RGB_VERDE    0b00000110
+#define RGB_APAGADO  0b00000111
+
+#define SIETE_SEG_MASCARA 0b00001111    // Bits de SIETE_SEG que son del display (el resto es del LCD).
+
+const unsigned char salidaColorDecena[8] = { // Color por decena. El indice se corta a 3 bits: siempre un acceso.
+    RGB_MAGENTA, RGB_AZUL, RGB_CYAN, RGB_VERDE, RGB_AMARILLO, RGB_BLANCO, RGB_BLANCO, RGB_BLANCO
+};
+
+volatile unsigned char salidaAlarma;             // 1 = RGB fijo en rojo hasta el reset.
+
+#define Salida_Alarma() do{ RGB = RGB_ROJO; salidaAlarma = 1; }while(0) // Macro: se usa desde la ISR y desde main. Primero el pin, despues la bandera.
+
+void Salida_Inicia(void);
+void Salida_Escribe(unsigned char, unsigned char);
+void Salida_Conteo(unsigned char, unsigned char);
+
+
+void Salida_Inicia(void){
+//Funcion que deja el RGB apagado y el display en 0
+//TRISD y TRISE los configura main
+    salidaAlarma = 0;
+    RGB = RGB_APAGADO;
+    SIETE_SEG = SIETE_SEG & (unsigned char)~SIETE_SEG_MASCARA;
+}
+void Salida_Escribe(unsigned char color, unsigned char unidades){
+//Funcion que escribe el color y las unidades en el mismo instante
+//Solo desde main (igual que el LCD, que es el otro que escribe LATD)
+    unsigned char gie;
+
+    unidades &= SIETE_SEG_MASCARA;
+    gie = GIE;
+    GIE = 0;                            // La ISR no puede poner la alarma entre la revision y la escritura.
+    if(salidaAlarma == 0){
+        RGB = color;
+    }
+    SIETE_SEG = (SIETE_SEG & (unsigned char)~SIETE_SEG_MASCARA) | unidades;
+    GIE = gie;
+}
+void Salida_Conteo(unsigned char unidades, unsigned char decenas){
+//Funcion que muestra un conteo: unidades en el display y decenas como color
+    Salida_Escribe(salidaColorDecena[decenas & 0x07], unidades);
+}
+#endif	/* LIBSALIDASXC8_H */
@@ -0,0 +1,215 @@
+/*
+ * File:   LibTareasXC8.h
+ *
+ * Planificador cooperativo por ticks. Cada tarea es una funcion corta que
+ * hace su trabajo y retorna (nunca espera con __delay_ms ni en un while).
+ * Hay tareas periodicas (cada n ticks) y de una sola vez (Tareas_Programa).
+ *
+ * La ISR de Timer0 llama Tareas_Tick() en cada tick: descuenta los ticks de
+ * cada tarea y marca como listas las que llegaron a 0, guardando el valor de
+ * Timer3 en ese instante. main llama Tareas_Ejecuta() en un ciclo infinito:
+ * corre la tarea lista de menor indice (el indice es la prioridad), y si no
+ * hay ninguna corre la funcion de fondo (por ejemplo ServicioLCD). Si el fondo
+ * tampoco tiene trabajo la CPU queda en modo IDLE (IDLEN=1 + Sleep: los
+ * perifericos y timers siguen) hasta la siguiente interrupcion.
+ *
+ * Cada tarea lleva su cuenta con Timer3 (libre, prescaler 1:1, lo configura
+ * main): ejecuciones, duracion ultima y maxima, y la latencia maxima desde que
+ * quedo lista hasta que empezo. La duracion incluye las interrupciones que
+ * entraron mientras corria. Las medidas son de 16 bits: sirven hasta 65535
+ * ticks de Timer3 (262 ms a 1 MHz, 44 ms a 48 MHz).
+ *
+ * Con RD16=1 leer TMR3L copia TMR3H a un buffer que comparten todas las
+ * lecturas. Si la ISR lee Timer3 entre las dos mitades de una lectura de main,
+ * main se queda con la parte alta de la ISR; por eso main lee con
+ * Tareas_Tiempo() (GIE=0 mientras tanto) y la ISR puede leer TMR3 directo.
+ */
+
+#ifndef LIBTAREASXC8_H
+#define	LIBTAREASXC8_H
+
+#include <stddef.h>
+#include "LibHALXC8.h"
+
+#ifndef TAREAS_MAX
+#define TAREAS_MAX 8                    // Tareas en la tabla (el indice es la prioridad: 0 la mas alta).
+#endif
+
+#define TAREA_UNA_VEZ 0                 // Periodo de una tarea que corre una sola vez por cada Tareas_Programa().
+
+typedef void (*Tarea_f)(void);
+typedef unsigned char (*Fondo_f)(void);
+
+typedef struct {
+    Tarea_f funcion;                    // NULL = posicion libre.
+    unsigned int periodo;               // Ticks entre ejecuciones o TAREA_UNA_VEZ.
+    volatile unsigned int cuenta;       // Ticks que faltan para que quede lista (0 = detenida).
+    volatile unsigned char lista;       // 1 = debe correr en la proxima vuelta de Tareas_Ejecuta.
+    volatile unsigned short marca;      // Timer3 cuando quedo lista. Los tiempos son unsigned short: 16 bits en XC8 y en gcc (make host).
+    volatile unsigned int perdidas;     // Veces que volvio a quedar lista sin haber corrido (se pierde una ejecucion).
+    unsigned int ejecuciones;
+    unsigned short ultimo;              // Duracion de la ultima ejecucion (ticks de Timer3).
+    unsigned short maximo;              // Duracion maxima.
+    unsigned short latenciaMax;         // Maximo entre quedar lista y empezar a correr.
+} Tarea;
+
+Tarea tareas[TAREAS_MAX];
+Fondo_f tareaFondo;                              // Trabajo sin plazo para cuando no hay tareas listas (o NULL).
+unsigned long tareasReposo;                      // Ticks de Timer3 que la CPU paso en IDLE.
+
+void Tareas_Inicia(void);
+void Tareas_BorraMedidas(void);
+void Tareas_Agrega(unsigned char, Tarea_f, unsigned int, unsigned int);
+void Tareas_Programa(unsigned char, unsigned int);
+void Tareas_Detiene(unsigned char);
+void Tareas_Fondo(Fondo_f);
+void Tareas_Tick(void);
+unsigned short Tareas_Tiempo(void);
+void Tareas_Ejecuta(void);
+void Tareas_Reposo(void);
+
+
+void Tareas_Inicia(void){
+//Funcion que deja la tabla vacia y borra las estadisticas
+    unsigned char i;
+
+    for(i = 0; i < TAREAS_MAX; i++){
+        tareas[i].funcion = NULL;
+        tareas[i].cuenta = 0;
+        tareas[i].lista = 0;
+    }
+    tareaFondo = NULL;
+    Tareas_BorraMedidas();
+}
+void Tareas_BorraMedidas(void){
+//Funcion que vuelve a empezar las medidas (por ejemplo despues de una inicializacion que bloquea)
+    unsigned char i;
+
+    for(i = 0; i < TAREAS_MAX; i++){
+        tareas[i].perdidas = 0;
+        tareas[i].ejecuciones = 0;
+        tareas[i].ultimo = 0;
+        tareas[i].maximo = 0;
+        tareas[i].latenciaMax = 0;
+    }
+    tareasReposo = 0;
+}
+void Tareas_Agrega(unsigned char id, Tarea_f funcion, unsigned int periodo, unsigned int primera){
+//Funcion que pone una tarea en la posicion id (prioridad)
+//periodo en ticks (TAREA_UNA_VEZ para las de una sola vez) y primera = ticks hasta la primera ejecucion
+//Con primera = 0 la tarea queda detenida hasta Tareas_Programa()
+//Llamarla antes de habilitar la interrupcion de Timer0
+    tareas[id].funcion = funcion;
+    tareas[id].periodo = periodo;
+    tareas[id].lista = 0;
+    tareas[id].cuenta = primera;
+}
+void Tareas_Programa(unsigned char id, unsigned int ticks){
+//Funcion que hace correr la tarea dentro de ticks ticks (1 = en el proximo tick)
+//En una tarea periodica reinicia la fase; en una de una sola vez la vuelve a armar
+    unsigned char gie;
+
+    gie = GIE;
+    GIE = 0;                            // cuenta es de 16 bits: la ISR no debe verla a medio escribir.
+    tareas[id].cuenta = ticks;
+    GIE = gie;
+}
+void Tareas_Detiene(unsigned char id){
+//Funcion que detiene la tarea (si ya estaba lista corre una ultima vez)
+    Tareas_Programa(id, 0);
+}
+void Tareas_Fondo(Fondo_f funcion){
+//Funcion que registra el trabajo de fondo
+//Debe retornar 1 si hizo algo y 0 si no tenia nada pendiente (entonces la CPU puede dormir)
+    tareaFondo = funcion;
+}
+void Tareas_Tick(void){
+//Funcion que se llama desde la ISR en cada tick
+    unsigned char i;
+    unsigned short ahora;
+
+    ahora = TMR3;
+    for(i = 0; i < TAREAS_MAX; i++){
+        if(tareas[i].cuenta != 0){
+            tareas[i].cuenta--;
+            if(tareas[i].cuenta == 0){
+                if(tareas[i].lista == 1){
+                    tareas[i].perdidas++; // La ejecucion anterior todavia no corre: main va atrasado.
+                }else{
+                    tareas[i].marca = ahora;
+                    tareas[i].lista = 1;
+                }
+                tareas[i].cuenta = tareas[i].periodo; // TAREA_UNA_VEZ la deja detenida.
+            }
+        }
+    }
+}
+unsigned short Tareas_Tiempo(void){
+//Funcion que lee Timer3 sin que la ISR corrompa la parte alta (se puede llamar con GIE en 0)
+    unsigned short tiempo;
+    unsigned char gie;
+
+    gie = GIE;
+    GIE = 0;
+    tiempo = TMR3;
+    GIE = gie;
+    return tiempo;
+}
+void Tareas_Ejecuta(void){
+//Funcion que main llama en su ciclo infinito
+//Corre a lo sumo una tarea (la lista de mayor prioridad) y retorna, asi despues de cada
+//tarea se vuelve a buscar desde la prioridad mas alta
+    unsigned char i;
+    unsigned short inicio, duracion, latencia;
+
+    for(i = 0; i < TAREAS_MAX; i++){
+        if(tareas[i].lista == 1){
+            inicio = Tareas_Tiempo();
+            latencia = (unsigned short)(inicio - tareas[i].marca); // La ISR no cambia marca hasta el proximo periodo.
+            tareas[i].lista = 0;
+            tareas[i].funcion();
+            duracion = (unsigned short)(Tareas_Tiempo() - inicio);
+
+            tareas[i].ejecuciones++;
+            tareas[i].ultimo = duracion;
+            if(duracion > tareas[i].maximo){
+                tareas[i].maximo = duracion;
+            }
+            if(latencia > tareas[i].latenciaMax){
+                tareas[i].latenciaMax = latencia;
+            }
+            HAL_ESPERA();
+            return;
+        }
+    }
+
+    if(tareaFondo != NULL && tareaFondo() == 1){
+        HAL_ESPERA();
+        return;
+    }
+    Tareas_Reposo();
+    HAL_ESPERA();                       // En el simulador la ISR pendiente entra aqui (GIE ya volvio a 1).
+}
+void Tareas_Reposo(void){
+//Funcion que detiene la CPU (modo IDLE) hasta la siguiente interrupcion
+//Con GIE=0 la interrupcion despierta al PIC sin entrar a la ISR; la ISR corre al volver a poner GIE=1.
+//Asi un tick que llegue entre la revision y el Sleep() no deja una tarea lista esperando otro tick
+    unsigned char i;
+    unsigned short inicio;
+
+    GIE = 0;
+    for(i = 0; i < TAREAS_MAX; i++){
+        if(tareas[i].lista == 1){
+            GIE = 1;
+            return;
+        }
+    }
+    inicio = TMR3;
+    IDLEN = 1;                          // Sleep() entra a IDLE: CPU detenida, timers, UART, CCP y ADC siguen.
+    Sleep();
+    NOP();
+    IDLEN = 0;                          // El Sleep() de inactividad (Duerme() en Lab5.c, lo decide TareaEnergia) si es el modo de bajo consumo completo.
+    tareasReposo += (unsigned short)(TMR3 - inicio);
+    GIE = 1;
+}
+#endif	/* LIBTAREASXC8_H */
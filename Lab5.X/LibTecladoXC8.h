@@ -0,0 +1,248 @@
+/*
+ * File:   LibTecladoXC8.h
+ *
+ * Teclado matricial 4x4 barrido por tick (filas en RB0..RB3, columnas con
+ * pull-up en RB4..RB7). Reemplaza la interrupcion por cambio en PORTB con su
+ * __delay_ms(300) dentro de la ISR.
+ *
+ * Teclado_Escanea() se llama en cada tick de Timer0 y atiende una sola fila:
+ * la activa, espera TECLADO_ASIENTA_US a que las columnas se asienten, las
+ * lee y vuelve a dejar todas las filas en 0 (TECLADO_REPOSO). Con el tick de
+ * 10 ms cada tecla se muestrea cada 40 ms, asi que una pulsacion se reconoce
+ * entre 40 y 80 ms despues de empezar y debe durar al menos 80 ms.
+ *
+ * Antirrebote por tecla: una tecla cambia de estado cuando dos muestras
+ * seguidas de su fila coinciden en su bit. Cada cambio a presionada deja un
+ * evento en una cola (ISR productor, main consumidor, igual que la cola de
+ * recepcion del UART). Un evento es el indice de la tecla (fila * 4 +
+ * columna) mas las banderas:
+ *   TECLA_REPETIDA  la tecla sigue presionada (auto-repeticion)
+ *   TECLA_MULTIPLE  se presiono con otra tecla ya abajo (la aplicacion
+ *                   normalmente la ignora: con tres teclas abajo la matriz
+ *                   puede mostrar una cuarta que no existe)
+ *
+ * Entre barridos todas las filas quedan en 0 y RBIE=1: cualquier tecla cambia
+ * RB4..RB7 y la ISR (de alta prioridad si RBIP=1) llama Teclado_Cambio(), que
+ * activa un momento solo la fila de una tecla (la de parada) y mira su
+ * columna. Esa tecla no espera al barrido: se reconoce en lo que tarda la ISR.
+ * No se reconoce asi si otra tecla de su columna ya estaba abajo (la columna
+ * no cambia) o si se presiona justo durante un barrido (RBIE=0 esos
+ * microsegundos); en esos casos queda el barrido (Teclado_Presionada).
+ * Teclado_PreparaSleep() deja el mismo reposo antes de Sleep() para que
+ * cualquier tecla despierte al PIC; Teclado_DespuesSleep() vuelve al barrido.
+ */
+
+#ifndef LIBTECLADOXC8_H
+#define	LIBTECLADOXC8_H
+
+#include "LibHALXC8.h"
+
+#ifndef TECLADO_COLA_TAM
+#define TECLADO_COLA_TAM 8              // Eventos pendientes. Potencia de 2 (el indice se envuelve con una mascara).
+#endif
+
+#ifndef TECLADO_REPITE_INICIO
+#define TECLADO_REPITE_INICIO 60        // Ticks presionada antes de la primera repeticion (600 ms con tick de 10 ms).
+#endif
+
+#ifndef TECLADO_REPITE_CADA
+#define TECLADO_REPITE_CADA 20          // Ticks entre repeticiones (5 por segundo).
+#endif
+
+#ifndef TECLADO_ASIENTA_US
+#define TECLADO_ASIENTA_US 10           // Espera entre activar una fila y leer las columnas (las sube el pull-up de PORTB).
+#endif
+
+#if (TECLADO_COLA_TAM & (TECLADO_COLA_TAM - 1)) != 0 || TECLADO_COLA_TAM > 256
+#error "TECLADO_COLA_TAM debe ser potencia de 2 y maximo 256"
+#endif
+
+#define TECLADO_FILAS_N 4
+#define TECLA_INDICE 0x0F               // Bits del evento con el indice de la tecla (0..15).
+#define TECLA_REPETIDA 0x40
+#define TECLA_MULTIPLE 0x80
+#define TECLA_NINGUNA 0xFF              // Sin tecla en auto-repeticion.
+#define TECLADO_REPOSO 0b11110000       // TECLADO_FILAS entre barridos: todas las filas en 0.
+
+const unsigned char tecladoSalidaFila[TECLADO_FILAS_N] = { // Valor de TECLADO_FILAS que activa (pone en 0) cada fila.
+    0b11111110, 0b11111101, 0b11111011, 0b11110111
+};
+
+unsigned char tecladoFila;                       // Fila que se lee en el proximo tick.
+unsigned char tecladoMuestra[TECLADO_FILAS_N];   // Ultima lectura de cada fila (bit n = columna n presionada).
+unsigned char tecladoEstable[TECLADO_FILAS_N];   // Estado ya filtrado de cada fila.
+unsigned char tecladoAbajo;                      // Teclas presionadas segun el estado filtrado.
+unsigned char tecladoRepite;                     // Tecla que se auto-repite o TECLA_NINGUNA.
+unsigned char tecladoTicksRepite;                // Ticks que faltan para la proxima repeticion.
+
+unsigned char tecladoCola[TECLADO_COLA_TAM];     // Eventos que main aun no ha leido.
+volatile unsigned char tecladoCabeza;            // Siguiente posicion libre: solo la modifica la ISR.
+volatile unsigned char tecladoColaLectura;       // Siguiente evento por leer: solo la modifica main.
+volatile unsigned char tecladoDescartados;       // Eventos perdidos porque la cola estaba llena.
+
+void Teclado_Inicia(void);
+void Teclado_Escanea(void);
+void Teclado_Evento(unsigned char);
+unsigned char Teclado_Presionada(unsigned char);
+unsigned char Teclado_Cambio(unsigned char);
+unsigned char Teclado_HayEvento(void);
+unsigned char Teclado_LeeEvento(void);
+void Teclado_Vacia(void);
+void Teclado_PreparaSleep(void);
+void Teclado_DespuesSleep(void);
+
+
+void Teclado_Inicia(void){
+//Funcion que deja todas las teclas sueltas, la cola vacia y las filas en reposo con RBIE=1
+//TRISB, RBPU y RBIP los configura main
+    unsigned char i;
+
+    for(i = 0; i < TECLADO_FILAS_N; i++){
+        tecladoMuestra[i] = 0;
+        tecladoEstable[i] = 0;
+    }
+    tecladoAbajo = 0;
+    tecladoRepite = TECLA_NINGUNA;
+    tecladoCabeza = 0;
+    tecladoColaLectura = 0;
+    tecladoDescartados = 0;
+    tecladoFila = 0;
+    TECLADO_FILAS = TECLADO_REPOSO;
+    __delay_us(TECLADO_ASIENTA_US);
+    (void)TECLADO_PUERTO;               // Leer PORTB fija la referencia del cambio antes de limpiar RBIF.
+    RBIF = 0;
+    RBIE = 1;
+}
+void Teclado_Escanea(void){
+//Funcion que se llama desde la ISR en cada tick
+//Activa la fila que toca, la lee, filtra cada tecla, deja los eventos en la cola y vuelve al reposo
+//Sin cambios son unas pocas instrucciones: el ciclo por columnas solo corre cuando una tecla cambio
+    unsigned char fila, muestra, cambios, bit, tecla;
+
+    fila = tecladoFila;
+    RBIE = 0;                           // Activar una fila cambia las columnas: no es una tecla nueva.
+    TECLADO_FILAS = tecladoSalidaFila[fila];
+    __delay_us(TECLADO_ASIENTA_US);
+    muestra = (unsigned char)(~TECLADO_PUERTO >> 4) & 0x0F; // Con pull-up la columna presionada lee 0.
+    TECLADO_FILAS = TECLADO_REPOSO;
+    __delay_us(TECLADO_ASIENTA_US);
+    (void)TECLADO_PUERTO;
+    RBIF = 0;
+    RBIE = 1;
+
+    if(muestra == tecladoMuestra[fila]){ // Dos muestras iguales seguidas: lo que cambio ya no es rebote.
+        cambios = muestra ^ tecladoEstable[fila];
+        if(cambios != 0){
+            tecladoEstable[fila] = muestra;
+            tecla = (unsigned char)(fila << 2);
+            for(bit = 0x01; bit < 0x10; bit = (unsigned char)(bit << 1)){
+                if(cambios & bit){
+                    if(muestra & bit){  // Se presiono.
+                        if(tecladoAbajo == 0){
+                            Teclado_Evento(tecla);
+                            tecladoRepite = tecla;
+                            tecladoTicksRepite = TECLADO_REPITE_INICIO;
+                        }else{
+                            Teclado_Evento(tecla | TECLA_MULTIPLE);
+                            tecladoRepite = TECLA_NINGUNA; // Con dos teclas abajo no se repite ninguna.
+                        }
+                        tecladoAbajo++;
+                    }else{              // Se solto.
+                        tecladoAbajo--;
+                        if(tecla == tecladoRepite){
+                            tecladoRepite = TECLA_NINGUNA;
+                        }
+                    }
+                }
+                tecla++;
+            }
+        }
+    }
+    tecladoMuestra[fila] = muestra;
+
+    tecladoFila = (fila + 1) & (TECLADO_FILAS_N - 1);
+
+    if(tecladoRepite != TECLA_NINGUNA){
+        tecladoTicksRepite--;
+        if(tecladoTicksRepite == 0){
+            tecladoTicksRepite = TECLADO_REPITE_CADA;
+            Teclado_Evento(tecladoRepite | TECLA_REPETIDA);
+        }
+    }
+}
+void Teclado_Evento(unsigned char evento){
+//Funcion que deja un evento en la cola (solo desde la ISR)
+    unsigned char siguiente;
+
+    siguiente = (tecladoCabeza + 1) & (TECLADO_COLA_TAM - 1);
+    if(siguiente == tecladoColaLectura){ // Cola llena: main no ha leido, se pierde el evento.
+        tecladoDescartados++;
+    }else{
+        tecladoCola[tecladoCabeza] = evento;
+        tecladoCabeza = siguiente;
+    }
+}
+unsigned char Teclado_Presionada(unsigned char tecla){
+//Funcion que retorna 1 si la tecla (indice 0..15) esta presionada segun el estado filtrado
+//Sirve para teclas que se atienden en la ISR sin pasar por la cola (parada de emergencia)
+    return (unsigned char)((tecladoEstable[tecla >> 2] >> (tecla & 0x03)) & 0x01);
+}
+unsigned char Teclado_Cambio(unsigned char tecla){
+//Funcion que se llama desde la ISR cuando RBIF=1 (una columna cambio con las filas en reposo)
+//Retorna 1 si la tecla (indice 0..15) esta presionada: si su columna esta en 0 activa solo su fila
+//y la vuelve a mirar. No pasa por el antirrebote ni por la cola (parada de emergencia)
+    unsigned char columna, presionada;
+
+    columna = (unsigned char)(0x10 << (tecla & 0x03));
+    presionada = 0;
+    if((TECLADO_PUERTO & columna) == 0){ // Alguna tecla de esa columna esta abajo.
+        TECLADO_FILAS = tecladoSalidaFila[tecla >> 2];
+        __delay_us(TECLADO_ASIENTA_US);
+        presionada = (unsigned char)((TECLADO_PUERTO & columna) == 0);
+        TECLADO_FILAS = TECLADO_REPOSO;
+        __delay_us(TECLADO_ASIENTA_US);
+    }
+    (void)TECLADO_PUERTO;
+    RBIF = 0;
+    return presionada;
+}
+unsigned char Teclado_HayEvento(void){
+//Funcion que retorna 1 si hay eventos pendientes por leer
+    return (unsigned char)(tecladoColaLectura != tecladoCabeza);
+}
+unsigned char Teclado_LeeEvento(void){
+//Funcion que saca un evento de la cola
+//Solo llamarla despues de verificar Teclado_HayEvento()
+    unsigned char evento;
+
+    evento = tecladoCola[tecladoColaLectura];
+    tecladoColaLectura = (tecladoColaLectura + 1) & (TECLADO_COLA_TAM - 1);
+    return evento;
+}
+void Teclado_Vacia(void){
+//Funcion que descarta los eventos pendientes (desde main)
+    tecladoColaLectura = tecladoCabeza;
+}
+void Teclado_PreparaSleep(void){
+//Funcion que activa todas las filas y habilita RBIE: cualquier tecla despierta al PIC
+    TECLADO_FILAS = TECLADO_REPOSO;
+    (void)TECLADO_PUERTO;               // Leer PORTB fija la referencia del cambio antes de limpiar RBIF.
+    RBIF = 0;
+    RBIE = 1;
+}
+void Teclado_DespuesSleep(void){
+//Funcion que vuelve al barrido despues de Sleep()
+//Todas las teclas quedan sueltas: si la que desperto al PIC sigue abajo se filtra y se
+//reporta como cualquier pulsacion (asi la parada de emergencia tambien funciona dormido)
+    unsigned char i;
+
+    (void)TECLADO_PUERTO;
+    RBIF = 0;                           // Las filas ya estan en reposo y RBIE sigue en 1.
+    for(i = 0; i < TECLADO_FILAS_N; i++){
+        tecladoMuestra[i] = 0;
+        tecladoEstable[i] = 0;
+    }
+    tecladoAbajo = 0;
+    tecladoRepite = TECLA_NINGUNA;
+}
+#endif	/* LIBTECLADOXC8_H */
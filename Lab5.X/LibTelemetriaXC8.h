@@ -0,0 +1,128 @@
+/*
+ * File:   LibTelemetriaXC8.h
+ *
+ * Telemetria binaria por tramas con CRC-8. Reemplaza la linea ASCII
+ * "Valor del ADC:%d\r\n" (~20 bytes por muestra) por tramas de 5 o 10 bytes.
+ *
+ * Trama corta (5 bytes), la que se envia casi siempre:
+ *   [0] SYNC 0xA5
+ *   [1] SEQ        contador de tramas (0..255), sirve para detectar perdidas
+ *   [2] BANDERAS   bit7 = 1 trama completa, 0 corta
+ *                  bit6 = 1 si el ADC viene en 12 bits, 0 si viene en 10 bits
+ *                  bit5..4 = estado del motor (0 apagado, 1 encendido, 2 parada de emergencia)
+ *                  bit3..0 = bits 11..8 del ADC
+ *   [3] ADC        bits 7..0 del ADC
+ *   [4] CRC-8      polinomio 0x07, valor inicial 0x00, sobre los bytes [1]..[3]
+ *
+ * Trama completa (10 bytes): igual hasta [3] y luego
+ *   [4] [5] piezas contadas (16 bits, byte alto primero)
+ *   [6] [7] objetivo (16 bits, byte alto primero)
+ *   [8] modo del motor (ordenMotor: 0 automatico, 1 forzado ON, 2 forzado OFF)
+ *   [9] CRC-8 sobre los bytes [1]..[8]
+ *
+ * La trama completa se envia cuando cambia el conteo, el objetivo o el modo,
+ * y de todas formas cada TELEMETRIA_COMPLETA_CADA tramas para que el
+ * receptor se sincronice aunque se conecte tarde.
+ *
+ * El decodificador para PC esta en Telemetria/ (C++ para Linux).
+ */
+
+#ifndef LIBTELEMETRIAXC8_H
+#define	LIBTELEMETRIAXC8_H
+
+#include "LibUARTXC8.h"
+#include "LibCRC8XC8.h"
+
+#define TRAMA_SYNC          0xA5
+#define TRAMA_COMPLETA      0x80        // Bit 7 de BANDERAS.
+#define TRAMA_ADC_12BITS    0x40        // Bit 6 de BANDERAS.
+#define TRAMA_LARGO_CORTA   5
+#define TRAMA_LARGO_COMPLETA 10
+
+#define MOTOR_ESTADO_APAGADO    0       // Valores del campo estado del motor (bits 5..4).
+#define MOTOR_ESTADO_ENCENDIDO  1
+#define MOTOR_ESTADO_EMERGENCIA 2
+
+#ifndef TELEMETRIA_ADC_BITS
+#ifdef ADC_BITS
+#define TELEMETRIA_ADC_BITS ADC_BITS    // Con LibADCXC8.h incluida antes, el ADC va en los bits que ella entrega.
+#else
+#define TELEMETRIA_ADC_BITS 10
+#endif
+#endif
+
+#ifndef TELEMETRIA_COMPLETA_CADA
+#define TELEMETRIA_COMPLETA_CADA 8      // Cada cuantas tramas se fuerza una completa.
+#endif
+
+unsigned char tramaSecuencia;                    // SEQ de la proxima trama (cuenta tambien las descartadas).
+unsigned char tramasDesdeCompleta;               // Tramas cortas enviadas desde la ultima completa.
+unsigned int tramaUltimoConteo;                  // Valores de la ultima trama completa, para saber si cambiaron.
+unsigned int tramaUltimoObjetivo;
+unsigned char tramaUltimoModo;
+unsigned int tramasDescartadas;                  // Tramas que no cupieron en el buffer de transmision.
+
+void Telemetria_Inicia(void);
+unsigned char Telemetria_Envia(unsigned int, unsigned char, unsigned int, unsigned int, unsigned char);
+
+
+void Telemetria_Inicia(void){
+//Funcion que reinicia la secuencia y obliga a que la primera trama sea completa
+    tramaSecuencia = 0;
+    tramasDesdeCompleta = TELEMETRIA_COMPLETA_CADA;
+    tramasDescartadas = 0;
+}
+unsigned char Telemetria_Envia(unsigned int adc, unsigned char estadoMotor, unsigned int conteo, unsigned int objetivo, unsigned char modo){
+//Funcion que arma una trama y la deja en el buffer de transmision
+//La trama va completa o no va: si no cabe entera se descarta y se cuenta
+//adc va en TELEMETRIA_ADC_BITS bits (10 o 12); en 10 bits un valor mayor a 1023 se marca como 12 bits
+//Retorna 1 si la trama quedo en cola
+    unsigned char trama[TRAMA_LARGO_COMPLETA];
+    unsigned char largo, crc, i;
+
+    trama[0] = TRAMA_SYNC;
+    trama[1] = tramaSecuencia;
+    trama[2] = (unsigned char)((estadoMotor & 0x03) << 4) | ((adc >> 8) & 0x0F);
+    if(TELEMETRIA_ADC_BITS > 10 || adc > 1023){
+        trama[2] |= TRAMA_ADC_12BITS;
+    }
+    trama[3] = (unsigned char)adc;
+    largo = TRAMA_LARGO_CORTA;
+
+    if(tramasDesdeCompleta >= TELEMETRIA_COMPLETA_CADA || conteo != tramaUltimoConteo ||
+       objetivo != tramaUltimoObjetivo || modo != tramaUltimoModo){
+        trama[2] |= TRAMA_COMPLETA;
+        trama[4] = (unsigned char)(conteo >> 8);
+        trama[5] = (unsigned char)conteo;
+        trama[6] = (unsigned char)(objetivo >> 8);
+        trama[7] = (unsigned char)objetivo;
+        trama[8] = modo;
+        largo = TRAMA_LARGO_COMPLETA;
+    }
+
+    crc = 0;
+    for(i = 1; i < largo - 1; i++){     // El SYNC no entra al CRC.
+        crc = CRC8_Agrega(crc, trama[i]);
+    }
+    trama[largo - 1] = crc;
+
+    tramaSecuencia++;                   // Avanza aunque se descarte: el receptor ve el salto en SEQ.
+    if(UART_LibreTx() < largo){
+        tramasDescartadas++;
+        return 0;
+    }
+    for(i = 0; i < largo; i++){
+        UART_EncolaTx(trama[i]);
+    }
+
+    if(largo == TRAMA_LARGO_COMPLETA){  // Solo se recuerdan los valores que el receptor ya tiene.
+        tramasDesdeCompleta = 0;
+        tramaUltimoConteo = conteo;
+        tramaUltimoObjetivo = objetivo;
+        tramaUltimoModo = modo;
+    }else{
+        tramasDesdeCompleta++;
+    }
+    return 1;
+}
+#endif	/* LIBTELEMETRIAXC8_H */
@@ -0,0 +1,333 @@
+/*
+ * File:   LibUARTXC8.h
+ *
+ * Transmision serial (EUSART) por interrupcion con buffer circular.
+ * El productor (UART_Texto, UART_Numero o UART_EncolaTx) nunca espera al UART: si el
+ * buffer esta lleno el byte se descarta y se cuenta en uartTxDescartados.
+ * La ISR saca un byte por cada TXIF y apaga TXIE cuando el buffer queda vacio.
+ *
+ * UART_Texto, UART_Numero y UART_Numero32 reemplazan a printf: encolan una
+ * cadena o un numero en decimal (LibBCDXC8.h) y no necesitan putch ni doprnt.
+ *
+ * La recepcion usa otro buffer circular de un productor (ISR de RCIF) y un
+ * consumidor (main). Cada indice lo escribe un solo lado y es de 8 bits, asi
+ * que no hace falta deshabilitar interrupciones para leer la cola. Un byte
+ * con error de trama (FERR: ruido, otra velocidad) no se cree: en la cola y
+ * en lo que retorna UART_RecibeISR() queda UART_RX_ERROR en su lugar, que no
+ * es parte de ningun comando.
+ *
+ * Velocidad: siempre BRGH=1 y BRG16=1 (main los deja en TXSTA y BAUDCON), asi
+ * que SPBRGH:SPBRG = Fosc/(4*baudios) - 1. UART_SPBRG es el valor para
+ * UART_BAUDIOS al arrancar, calculado y redondeado con _XTAL_FREQ
+ * (ConfigReloj.h); si el error pasa de UART_ERROR_MAX la compilacion se
+ * detiene. UART_Divisor() hace la misma cuenta en ejecucion para cambiar de
+ * velocidad (SET BAUD n en Lab5). SPBRGH:SPBRG y error de los baudios reales
+ * (UART_ErrorBRG) para cada reloj; make baudios revisa esta tabla:
+ *
+ *   baudios     1 MHz        8 MHz        48 MHz
+ *     9600     25   0.15 %  207  0.15 %  1249 0.00 %
+ *    19200     12   0.15 %  103  0.15 %   624 0.00 %
+ *    38400      6   6.99 %   51  0.15 %   312 0.16 %
+ *    57600      3   8.50 %   34  0.79 %   207 0.15 %
+ *   115200      1   8.50 %   16  2.12 %   103 0.15 %
+ *
+ * Por encima de 2 % UART_Divisor() retorna 0: a 1 MHz el maximo es 19200 y a
+ * 8 MHz 57600. El cambio no se aplica de inmediato: UART_PideCambio() lo deja
+ * pendiente y UART_ServicioCambio() (desde main) lo hace cuando el buffer y el
+ * transmisor estan vacios, asi la respuesta al comando sale a la velocidad
+ * anterior.
+ *
+ * Auto-baud: UART_AutoBaud() (o UART_CAMBIO_AUTO) pone ABDEN=1 y el EUSART
+ * mide el siguiente byte, que debe ser 0x55 ('U'), para dejar SPBRGH:SPBRG a
+ * la velocidad del otro lado. Mientras tanto TXIE queda en 0 (SPBRG es el
+ * contador de la medicion) y lo que se encola espera. UART_RecibeISR() lee y
+ * descarta ese byte. Con UART_AUTOBAUD 1 main arranca midiendo.
+ */
+
+#ifndef LIBUARTXC8_H
+#define	LIBUARTXC8_H
+
+#include <xc.h>
+#include "ConfigReloj.h"
+#include "LibBCDXC8.h"
+
+#ifndef UART_TX_TAM
+#define UART_TX_TAM 64                  // Tamano del buffer de transmision. Debe ser potencia de 2 (el indice se envuelve con una mascara).
+#endif
+
+#ifndef UART_RX_TAM
+#define UART_RX_TAM 32                  // Tamano del buffer de recepcion. Tambien potencia de 2.
+#endif
+
+#ifndef UART_BAUDIOS
+#define UART_BAUDIOS 9600               // Baudios del terminal.
+#endif
+
+#ifndef UART_AUTOBAUD
+#define UART_AUTOBAUD 0                 // 1 = al arrancar se espera el 0x55 del otro lado para medir los baudios.
+#endif
+
+#ifndef UART_ERROR_MAX
+#define UART_ERROR_MAX 200              // Error maximo de los baudios reales, en centesimas de % (2 %).
+#endif
+
+#define UART_BAUDIOS_MAX 1000000UL      // Mas rapido que Fosc/4 no se puede; con este tope el error cabe en 32 bits.
+#define UART_ERROR_SATURADO 1000        // UART_ErrorBRG() para 10 % o mas.
+
+#define UART_BRG(f, b) (((f) + 2UL * (b)) / (4UL * (b)) - 1) // SPBRGH:SPBRG = Fosc/(4*BAUD) - 1, redondeado.
+#define UART_REALES(f, brg) ((f) / (4UL * ((brg) + 1)))      // Baudios que da SPBRGH:SPBRG = brg.
+
+#define UART_SPBRG UART_BRG(_XTAL_FREQ, UART_BAUDIOS)
+#define UART_BAUDIOS_REALES UART_REALES(_XTAL_FREQ, UART_SPBRG)
+
+#if UART_BAUDIOS > UART_BAUDIOS_MAX || UART_SPBRG > 65535
+#error "UART_BAUDIOS fuera de rango para _XTAL_FREQ: SPBRGH:SPBRG no alcanza"
+#endif
+#if (UART_BAUDIOS_REALES > UART_BAUDIOS ? UART_BAUDIOS_REALES - UART_BAUDIOS : UART_BAUDIOS - UART_BAUDIOS_REALES) * 10000 > UART_ERROR_MAX * UART_BAUDIOS
+#error "Con este _XTAL_FREQ los baudios reales se alejan de UART_BAUDIOS mas de UART_ERROR_MAX"
+#endif
+
+#define UART_CAMBIO_NADA 0              // uartCambio: sin cambio de velocidad pendiente,
+#define UART_CAMBIO_BRG 1               // SPBRGH:SPBRG = uartCambioBRG,
+#define UART_CAMBIO_AUTO 2              // o medir con auto-baud.
+
+#define UART_RX_ERROR 0xFF              // Lo que queda en lugar de un byte con error de trama (no es ASCII).
+
+#if (UART_TX_TAM & (UART_TX_TAM - 1)) != 0 || UART_TX_TAM > 256
+#error "UART_TX_TAM debe ser potencia de 2 y maximo 256"
+#endif
+#if (UART_RX_TAM & (UART_RX_TAM - 1)) != 0 || UART_RX_TAM > 256
+#error "UART_RX_TAM debe ser potencia de 2 y maximo 256"
+#endif
+
+unsigned char uartTxBuffer[UART_TX_TAM];         // Bytes pendientes por transmitir.
+volatile unsigned char uartTxCabeza;             // Siguiente posicion libre: solo la modifica el productor.
+volatile unsigned char uartTxCola;               // Siguiente byte a transmitir: solo la modifica la ISR (TXIF).
+volatile unsigned int uartTxDescartados;         // Bytes perdidos porque el buffer estaba lleno.
+volatile unsigned int uartTxEnviados;            // Bytes entregados a TXREG (sirve para medir throughput).
+
+unsigned char uartRxBuffer[UART_RX_TAM];         // Bytes recibidos que main aun no ha leido.
+volatile unsigned char uartRxCabeza;             // Siguiente posicion libre: solo la modifica la ISR (RCIF).
+volatile unsigned char uartRxCola;               // Siguiente byte por leer: solo la modifica main.
+volatile unsigned int uartRxDescartados;         // Bytes perdidos porque main no alcanzo a vaciar la cola.
+volatile unsigned int uartRxDesbordes;           // Veces que el hardware marco OERR.
+volatile unsigned int uartRxTrama;               // Bytes con error de trama (FERR), cambiados por UART_RX_ERROR.
+
+volatile unsigned char uartAutoBaud;             // 1 = ABDEN armado: el proximo byte mide los baudios (lo baja la ISR).
+volatile unsigned int uartAutoBauds;             // Mediciones de auto-baud terminadas.
+unsigned char uartCambio;                        // UART_CAMBIO_...: lo pide main y lo aplica UART_ServicioCambio.
+unsigned int uartCambioBRG;                      // SPBRGH:SPBRG para UART_CAMBIO_BRG.
+
+void UART_IniciaTx(void);
+unsigned char UART_EncolaTx(unsigned char);
+unsigned char UART_LibreTx(void);
+void UART_Texto(const char *);
+void UART_Numero(unsigned int);
+void UART_Numero32(unsigned long);
+void UART_ServicioTx(void);
+void UART_IniciaRx(void);
+unsigned char UART_RecibeISR(void);
+unsigned char UART_HayDato(void);
+unsigned char UART_LeeDato(void);
+unsigned int UART_ErrorBRG(unsigned long, unsigned int);
+unsigned char UART_Divisor(unsigned long, unsigned int *);
+void UART_Velocidad(unsigned int);
+unsigned int UART_LeeBRG(void);
+void UART_AutoBaud(void);
+void UART_PideCambio(unsigned char, unsigned int);
+void UART_ServicioCambio(void);
+
+
+void UART_IniciaTx(void){
+//Funcion que deja el buffer vacio y la interrupcion TXIF apagada
+    TXIE = 0;
+    uartTxCabeza = 0;
+    uartTxCola = 0;
+    uartTxDescartados = 0;
+    uartTxEnviados = 0;
+}
+unsigned char UART_EncolaTx(unsigned char dato){
+//Funcion que agrega un byte al buffer sin esperar al UART
+//Retorna 1 si el byte quedo en cola y 0 si se descarto por buffer lleno
+//Un solo contexto productor a la vez (main o ISR, no ambos)
+    unsigned char siguiente;
+
+    siguiente = (uartTxCabeza + 1) & (UART_TX_TAM - 1);
+    if(siguiente == uartTxCola){        // Lleno: se pierde el byte en vez de bloquear.
+        uartTxDescartados++;
+        return 0;
+    }
+    uartTxBuffer[uartTxCabeza] = dato;
+    uartTxCabeza = siguiente;           // Se publica el byte antes de habilitar la interrupcion.
+    if(uartAutoBaud == 0){
+        TXIE = 1;                       // TXIF ya esta en 1 si TXREG esta libre: la ISR arranca la transmision.
+    }
+    return 1;
+}
+unsigned char UART_LibreTx(void){
+//Funcion que retorna cuantos bytes caben todavia en el buffer
+    return (unsigned char)((uartTxCola - uartTxCabeza - 1) & (UART_TX_TAM - 1));
+}
+void UART_Texto(const char *texto){
+//Funcion que encola una cadena sin el '\0' (lo que no cabe se descarta, igual que en UART_EncolaTx)
+//Ejemplo UART_Texto("OK\r\n");
+    while(*texto != '\0'){
+        UART_EncolaTx((unsigned char)*texto);
+        texto++;
+    }
+}
+void UART_Numero(unsigned int valor){
+//Funcion que encola valor en decimal sin ceros a la izquierda (lo que hacia %u)
+    char texto[BCD_TEXTO16];
+
+    BCD_Texto16(valor, texto);
+    UART_Texto(texto);
+}
+void UART_Numero32(unsigned long valor){
+//Funcion que encola valor en decimal sin ceros a la izquierda (lo que hacia %lu)
+    char texto[BCD_TEXTO32];
+
+    BCD_Texto32(valor, texto);
+    UART_Texto(texto);
+}
+void UART_ServicioTx(void){
+//Funcion que se llama desde la ISR cuando TXIF=1 y TXIE=1
+//Carga un solo byte en TXREG, nunca espera TRMT
+    if(uartTxCola != uartTxCabeza){
+        TXREG = uartTxBuffer[uartTxCola];
+        uartTxCola = (uartTxCola + 1) & (UART_TX_TAM - 1);
+        uartTxEnviados++;
+    }
+    if(uartTxCola == uartTxCabeza){
+        TXIE = 0;                       // Nada mas que enviar: evita que TXIF vuelva a entrar a la ISR.
+    }
+}
+void UART_IniciaRx(void){
+//Funcion que deja vacia la cola de recepcion
+    uartRxCabeza = 0;
+    uartRxCola = 0;
+    uartRxDescartados = 0;
+    uartRxDesbordes = 0;
+    uartRxTrama = 0;
+    uartAutoBaud = 0;
+    uartAutoBauds = 0;
+    uartCambio = UART_CAMBIO_NADA;
+}
+unsigned char UART_RecibeISR(void){
+//Funcion que se llama desde la ISR cuando RCIF=1
+//Lee RCREG, lo deja en la cola y retorna el byte para que la ISR pueda
+//revisar comandos urgentes (parada de emergencia) sin esperar a main
+//Con FERR el byte se cambia por UART_RX_ERROR
+//El byte que termina una medicion de auto-baud no se encola y se retorna como '\n':
+//lo siguiente que llegue empieza una linea nueva
+    unsigned char dato, siguiente, ferr;
+
+    if(uartAutoBaud == 1){              // RCIF al final de la medicion: SPBRGH:SPBRG ya tiene la velocidad nueva.
+        dato = RCREG;                   // El byte de calibracion no es un dato; leerlo limpia RCIF.
+        if(ABDOVF == 1){    // El contador desbordo (baudios muy bajos o no era 0x55): se vuelve a medir.
+            ABDOVF = 0;
+            ABDEN = 1;
+        }else{
+            uartAutoBaud = 0;
+            uartAutoBauds++;
+            if(uartTxCola != uartTxCabeza){
+                TXIE = 1;               // Lo que se encolo durante la medicion sale con la velocidad nueva.
+            }
+        }
+        return '\n';
+    }
+    if(RCSTAbits.OERR == 1){            // Desborde del FIFO de hardware: hay que reiniciar CREN para seguir recibiendo.
+        RCSTAbits.CREN = 0;
+        RCSTAbits.CREN = 1;
+        uartRxDesbordes++;
+    }
+    ferr = RCSTAbits.FERR;              // FERR es del byte que esta en RCREG: se lee antes.
+    dato = RCREG;                       // Leer RCREG limpia RCIF.
+    if(ferr == 1){
+        dato = UART_RX_ERROR;           // Sin bit de parada los bits del dato no valen.
+        uartRxTrama++;
+    }
+    siguiente = (uartRxCabeza + 1) & (UART_RX_TAM - 1);
+    if(siguiente == uartRxCola){        // Cola llena: main no ha consumido, se pierde el byte.
+        uartRxDescartados++;
+    }else{
+        uartRxBuffer[uartRxCabeza] = dato;
+        uartRxCabeza = siguiente;
+    }
+    return dato;
+}
+unsigned char UART_HayDato(void){
+//Funcion que retorna 1 si hay bytes recibidos pendientes por leer
+    return (unsigned char)(uartRxCola != uartRxCabeza);
+}
+unsigned char UART_LeeDato(void){
+//Funcion que saca un byte de la cola de recepcion
+//Solo llamarla despues de verificar UART_HayDato()
+    unsigned char dato;
+
+    dato = uartRxBuffer[uartRxCola];
+    uartRxCola = (uartRxCola + 1) & (UART_RX_TAM - 1);
+    return dato;
+}
+unsigned int UART_ErrorBRG(unsigned long baudios, unsigned int brg){
+//Funcion que retorna el error de los baudios reales con SPBRGH:SPBRG = brg, en centesimas de %
+//baudios debe estar entre 1 y UART_BAUDIOS_MAX; de 10 % en adelante retorna UART_ERROR_SATURADO
+    unsigned long reales, diferencia;
+
+    reales = UART_REALES(_XTAL_FREQ, (unsigned long)brg);
+    diferencia = (reales > baudios) ? reales - baudios : baudios - reales;
+    if(diferencia >= baudios / 10){
+        return UART_ERROR_SATURADO;
+    }
+    return (unsigned int)(diferencia * 10000 / baudios);
+}
+unsigned char UART_Divisor(unsigned long baudios, unsigned int *brg){
+//Funcion que calcula SPBRGH:SPBRG para baudios (BRGH=1, BRG16=1), redondeado
+//Retorna 1 si el error queda dentro de UART_ERROR_MAX y 0 si no (o si no cabe en 16 bits)
+    unsigned long n;
+
+    if(baudios == 0 || baudios > UART_BAUDIOS_MAX){
+        return 0;
+    }
+    n = UART_BRG(_XTAL_FREQ, baudios);
+    if(n > 65535){
+        return 0;
+    }
+    *brg = (unsigned int)n;
+    return (unsigned char)(UART_ErrorBRG(baudios, *brg) <= UART_ERROR_MAX);
+}
+void UART_Velocidad(unsigned int brg){
+//Funcion que escribe SPBRGH:SPBRG (solo con el transmisor vacio: el byte en curso saldria mal)
+    SPBRGH = (unsigned char)(brg >> 8);
+    SPBRG = (unsigned char)brg;
+}
+unsigned int UART_LeeBRG(void){
+//Funcion que retorna SPBRGH:SPBRG (el que se calculo o el que dejo el auto-baud)
+    return ((unsigned int)SPBRGH << 8) | SPBRG;
+}
+void UART_AutoBaud(void){
+//Funcion que arma la medicion de auto-baud: el siguiente byte (0x55) fija SPBRGH:SPBRG
+//Solo con el transmisor vacio (UART_ServicioCambio lo revisa)
+    TXIE = 0;                           // Durante la medicion SPBRG es el contador: no se transmite.
+    uartAutoBaud = 1;
+    ABDOVF = 0;
+    ABDEN = 1;
+}
+void UART_PideCambio(unsigned char cambio, unsigned int brg){
+//Funcion que deja pendiente un cambio de velocidad (UART_CAMBIO_BRG con brg, o UART_CAMBIO_AUTO)
+    uartCambioBRG = brg;
+    uartCambio = cambio;
+}
+void UART_ServicioCambio(void){
+//Funcion que se llama seguido desde main: aplica el cambio pendiente cuando ya salio todo lo encolado
+    if(uartCambio == UART_CAMBIO_NADA || uartTxCola != uartTxCabeza || TRMT == 0){
+        return;
+    }
+    if(uartCambio == UART_CAMBIO_AUTO){
+        UART_AutoBaud();
+    }else{
+        UART_Velocidad(uartCambioBRG);
+    }
+    uartCambio = UART_CAMBIO_NADA;
+}
+#endif	/* LIBUARTXC8_H */
@@ -0,0 +1,650 @@
+/*
+ * File:   banco.c
+ *
+ * Banco de pruebas de la escritura de texto y numeros en el LCD (make banco).
+ * Compila LibLCDXC8_1.h y LibLCDBufXC8.h con gcc contra un bus de mentira
+ * (Datos, RS y E son variables de aqui, ver banco/xc.h) y un HD44780 que
+ * arma los bytes con los flancos de bajada de E, guarda lo que queda en
+ * pantalla y cuenta los bytes que llegan antes de que termine el anterior.
+ *
+ *   banco-lcd [-g] [base.txt]
+ *
+ * Con -DBANCO_RW (make banco arma tambien host/banco-lcd-rw, base en
+ * host/banco-rw.txt) las librerias se compilan con R/W: el HD44780 de aqui
+ * contesta la bandera de ocupado y el ultimo caso lo deja mudo para probar
+ * que se vuelve a los retardos fijos.
+ *
+ * Cada caso corre dos veces, con el bus de 4 bits (el de Lab5) y con el de
+ * 8 bits (ConfigLCD.h); en base.txt van como 4/caso y 8/caso. Por cada caso
+ * imprime pulsos de E, bytes de datos e instrucciones, lecturas, tiempo en
+ * retardos y ciclos de instruccion estimados, y los compara con base.txt
+ * (una linea "caso pulsos ciclos" por caso). Sale con 1 si algun caso da mas
+ * pulsos o ciclos que la base, si el LCD no quedo con el texto esperado, si
+ * un byte llego con el LCD ocupado o si el PIC y el LCD manejaron el bus al
+ * mismo tiempo (R/W=1 sin el bus como entradas). Con -g reescribe base.txt
+ * con esta corrida.
+ *
+ * Ademas convierte los 65536 valores de 16 bits y los 256 de 8 bits con
+ * LibBCDXC8.h y con las divisiones que usaban antes EscribeLCD_n16 y
+ * EscribeBufLCD_n: los digitos deben ser iguales y el double dabble debe
+ * costar menos en el peor caso. BCD_Texto16 y BCD_Texto32 (las respuestas
+ * por serial) se comparan con snprintf y con lo que costaba el doprnt de
+ * XC8 (%u y %lu: una division y un modulo por digito escrito); deben dar el
+ * mismo texto y costar menos en promedio y en el peor caso.
+ *
+ * Los ciclos son una estimacion: los retardos son exactos a _XTAL_FREQ, pero
+ * gcc no da los ciclos del PIC, asi que el resto sale de costos fijos por
+ * pulso, por llamada a ServicioLCD, por vuelta del double dabble y por cada
+ * division de XC8 (BANCO_CICLOS_...). Sirven para comparar versiones de las
+ * librerias entre si, no para sumar tiempos exactos.
+ */
+
+#include "banco/xc.h"                  // Las librerias incluyen <xc.h>: make banco pasa -Ihost/banco.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BANCO_CICLOS_PULSO 14           // Poner el nibble en LATD, subir y bajar E (sin los retardos).
+#define BANCO_CICLOS_SERVICIO 45        // Una llamada a ServicioLCD: buscar la celda sucia y armar el byte.
+#define BANCO_CICLOS_BCD_VUELTA 8       // Vuelta del double dabble: for, bit de entrada y corrimiento del byte alto.
+#define BANCO_CICLOS_BCD_BYTE 14        // Por byte BCD de la vuelta: dos comparaciones de nibble y el corrimiento.
+#define BANCO_CICLOS_BCD_AJUSTE 2       // Cada +3 (ADDWF).
+#define BANCO_CICLOS_DIV16 230          // __lwdiv de XC8 (16 vueltas de resta y corrimiento) con la llamada.
+#define BANCO_CICLOS_MOD16 220          // __lwmod.
+#define BANCO_CICLOS_DIV8 95            // __lbdiv (8 vueltas).
+#define BANCO_CICLOS_MOD8 90            // __lbmod.
+#define BANCO_CICLOS_DIV32 600          // __aldiv (32 vueltas).
+#define BANCO_CICLOS_MOD32 580          // __almod.
+#define BANCO_CICLOS_DOPRNT 60          // doprnt por numero: leer el formato, contar digitos contra la tabla de potencias.
+#define BANCO_CICLOS_RESTA 12           // BCD_Convierte32: comparar y restar 32 bits, contar el digito.
+#define BANCO_CICLOS_TEXTO 7            // BCD_Recorta por digito revisado (cero de la izquierda o caracter escrito).
+#define BANCO_US_LCD_CORTO 37.0         // Instrucciones y datos del HD44780.
+#define BANCO_US_LCD_LARGO 1520.0       // Borrar pantalla y cursor a inicio.
+
+// ============================== BUS DEL LCD ==============================
+
+static volatile unsigned char bancoDatos, bancoRS, bancoE;
+static volatile unsigned char *PinE(void);
+
+#define Datos bancoDatos                // Las librerias los usan como LATD, LATA4 y LATA5.
+#define RS bancoRS
+#define E (*PinE())                     // Cada E = x pasa por PinE: asi se ve el flanco de bajada.
+
+static volatile unsigned char bancoTris;
+#define DatosTris bancoTris
+
+#ifdef BANCO_RW
+static volatile unsigned char bancoRW;
+static unsigned char LeeBus(void);
+
+#define RW bancoRW
+#define DatosLee LeeBus()
+#endif
+
+static unsigned long ciclos;            // Ciclos de instruccion estimados del caso en curso.
+static double ahoraUs;                  // Reloj del banco (no se reinicia entre casos).
+static double retardoUs;                // Tiempo en __delay del caso en curso.
+
+#define BCD_PASO(bytes) banco_ciclos(BANCO_CICLOS_BCD_VUELTA + (bytes) * BANCO_CICLOS_BCD_BYTE)
+#define BCD_AJUSTE()    banco_ciclos(BANCO_CICLOS_BCD_AJUSTE)
+#define BCD_RESTA()     banco_ciclos(BANCO_CICLOS_RESTA)
+
+#include "../LibLCDXC8_1.h"
+#include "../LibLCDBufXC8.h"
+
+// ============================== HD44780 ==============================
+
+static unsigned char lcdDdram[0x68];    // 0x00..0x27 primera linea, 0x40..0x67 segunda.
+static unsigned char lcdDireccion;
+static int lcdEnCgram;
+static int lcdModo4;                    // Arranca en 8 bits, como al energizar.
+static int lcdMitad;
+static unsigned char lcdAlto;
+static double lcdLibreUs;               // Instante en que termina el byte anterior.
+static unsigned long lcdPulsos, lcdDatos, lcdInstrucciones, lcdOcupado;
+static unsigned long lcdLecturas, lcdChoques;
+#ifdef BANCO_RW
+static int lcdMitadLectura;             // En 4 bits: ya salio el nibble de BF.
+static int lcdMudo;                     // 1 = BF siempre en 1 (el LCD no contesta).
+#endif
+
+static void EjecutaLcd(int rs, unsigned char b)
+{
+    double duracion = BANCO_US_LCD_CORTO;
+    int i;
+
+    if (rs) {
+        lcdDatos++;
+        if (!lcdEnCgram) {
+            lcdDdram[lcdDireccion] = b;
+            lcdDireccion++;
+            if (lcdDireccion == 0x28) {
+                lcdDireccion = 0x40;
+            } else if (lcdDireccion == 0x68) {
+                lcdDireccion = 0x00;
+            }
+        }
+    } else {
+        lcdInstrucciones++;
+        if (b & 0x80) {
+            lcdDireccion = b & 0x7F;
+            if ((lcdDireccion & 0x3F) >= 0x28) {
+                lcdDireccion &= 0x40;
+            }
+            lcdEnCgram = 0;
+        } else if (b & 0x40) {
+            lcdEnCgram = 1;
+        } else if (b & 0x20) {
+            lcdModo4 = (b & 0x10) == 0;
+            lcdMitad = 0;
+        } else if ((b & 0xFE) == 0x02) {
+            lcdDireccion = 0;
+            lcdEnCgram = 0;
+            duracion = BANCO_US_LCD_LARGO;
+        } else if (b == 0x01) {
+            for (i = 0; i < (int)sizeof lcdDdram; i++) {
+                lcdDdram[i] = ' ';
+            }
+            lcdDireccion = 0;
+            lcdEnCgram = 0;
+            duracion = BANCO_US_LCD_LARGO;
+        }
+    }
+    lcdLibreUs = ahoraUs + duracion;
+}
+
+static void FlancoE(void)
+{
+//El HD44780 toma RS y D7..D0 en el flanco de bajada de E
+    unsigned char bus = bancoDatos;
+
+    lcdPulsos++;
+    banco_ciclos(BANCO_CICLOS_PULSO);
+#ifdef BANCO_RW
+    if (bancoRW) {                      // Lectura: no ejecuta nada, solo avanza de nibble.
+        lcdLecturas++;
+        if (lcdModo4) {
+            lcdMitadLectura = !lcdMitadLectura;
+        }
+        return;
+    }
+#endif
+    if (!lcdModo4) {
+        if (ahoraUs < lcdLibreUs) {
+            lcdOcupado++;
+        }
+        EjecutaLcd(bancoRS, bus);
+    } else if (!lcdMitad) {
+        if (ahoraUs < lcdLibreUs) {
+            lcdOcupado++;               // El nibble alto de un byte nuevo llego con el LCD ocupado.
+        }
+        lcdAlto = bus & 0xF0;
+        lcdMitad = 1;
+    } else {
+        lcdMitad = 0;
+        EjecutaLcd(bancoRS, lcdAlto | (bus >> 4));
+    }
+}
+
+static volatile unsigned char *PinE(void)
+{
+//Las librerias solo escriben E; si ya estaba en 1, esta escritura es la que lo baja
+    if (bancoE) {
+        FlancoE();
+    }
+    return &bancoE;
+}
+
+#ifdef BANCO_RW
+static unsigned char LeeBus(void)
+{
+//Lo que ve el PIC en D7..D0 con E en alto y R/W=1: BF y el contador de direcciones
+    unsigned char bf = (lcdMudo || ahoraUs < lcdLibreUs) ? 0x80 : 0x00;
+    unsigned char salida = lcdModo4 ? 0xF0 : 0xFF;
+
+    if (!bancoRW || !bancoE) {
+        return bancoDatos;
+    }
+    if ((bancoTris & salida) != salida) {
+        lcdChoques++;
+    }
+    if (!lcdModo4) {
+        return bf | (lcdDireccion & 0x7F);
+    }
+    if (!lcdMitadLectura) {
+        return bf | (lcdDireccion & 0x70) | (bancoDatos & 0x0F);
+    }
+    return (unsigned char)((lcdDireccion & 0x0F) << 4) | (bancoDatos & 0x0F);
+}
+#endif
+
+void banco_retardo_us(double us)
+{
+    retardoUs += us;
+    ahoraUs += us;
+    ciclos += (unsigned long)(us * _XTAL_FREQ / 4e6 + 0.5);
+}
+
+void banco_ciclos(unsigned long n)
+{
+    ciclos += n;
+    ahoraUs += (double)n * 4e6 / _XTAL_FREQ;
+}
+
+// ============================== CASOS ==============================
+
+typedef struct {
+    const char *nombre;                 // Sin espacios: es la llave en base.txt.
+    void (*prepara)(void);              // Lo que no se mide (puede ser NULL).
+    void (*corre)(void);
+    unsigned char direccion;            // Donde debe quedar el texto esperado (0x80.. / 0xC0..).
+    const char *esperado;               // NULL = no se revisa la pantalla.
+} Caso;
+
+static void Servicio(void)
+{
+//Lo que hace Tareas_Fondo(ServicioLCD) en Lab5, con el costo de cada llamada
+    banco_ciclos(BANCO_CICLOS_SERVICIO);
+    while (ServicioLCD() == 1) {
+        banco_ciclos(BANCO_CICLOS_SERVICIO);
+    }
+}
+
+static unsigned char bus;               // Interfaz de la pasada en curso (4 u 8 bits).
+
+static void PreparaInicio(void)
+{
+    ConfiguraLCD(bus);
+#ifdef BANCO_RW
+    lcdMudo = 0;                        // El caso Sin_respuesta_BF de la pasada anterior lo dejo mudo.
+#endif
+}
+
+static void CorreInicio(void) { InicializaLCD(); }
+static void PreparaLinea1(void) { DireccionaLCD(0x80); }
+static void PreparaLinea2(void) { DireccionaLCD(0xC0); }
+static void CorreCaracter(void) { EscribeLCD_c('A'); }
+static void CorreMensaje(void) { MensajeLCD_Var(" Bienvenido "); }
+static void CorreN8(void) { EscribeLCD_n8(204, 3); }
+static void CorreN16(void) { EscribeLCD_n16(12754, 5); }
+static void CorreN16Corto(void) { EscribeLCD_n16(65535, 3); }
+static void CorreDirecciona(void) { DireccionaLCD(0xC5); }
+static void PreparaBuf(void) { IniciaBufLCD(); }
+static void CorreBufNumero(void) { EscribeBufLCD_n(0x8B, 40961, 5); }
+static void CorreBufServicio(void) { Servicio(); }
+static void PreparaBufLinea(void) { MensajeBufLCD(0xC0, "Piezas a contar:"); }
+static void PreparaVacia(void) { MensajeBufLCD(0x80, "PARADA DE EMERG."); MensajeBufLCD(0xC0, "Suelte el boton "); }
+static void CorreVacia(void) { VaciaBufLCD(); }
+#ifdef BANCO_RW
+static void PreparaMudo(void) { DireccionaLCD(0x80); lcdMudo = 1; }
+#endif
+
+static const Caso casos[] = {
+    { "InicializaLCD", PreparaInicio, CorreInicio, 0x80, NULL },
+    { "EscribeLCD_c", PreparaLinea1, CorreCaracter, 0x80, "A" },
+    { "MensajeLCD_Var_12", PreparaLinea1, CorreMensaje, 0x80, " Bienvenido " },
+    { "EscribeLCD_n8_3", PreparaLinea2, CorreN8, 0xC0, "204" },
+    { "EscribeLCD_n16_5", PreparaLinea2, CorreN16, 0xC0, "12754" },
+    { "EscribeLCD_n16_3", PreparaLinea2, CorreN16Corto, 0xC0, "535" },
+    { "DireccionaLCD", NULL, CorreDirecciona, 0x80, NULL },
+    { "EscribeBufLCD_n_5", PreparaBuf, CorreBufNumero, 0x80, NULL },
+    { "ServicioLCD_5_celdas", NULL, CorreBufServicio, 0x8B, "40961" },
+    { "ServicioLCD_16_celdas", PreparaBufLinea, CorreBufServicio, 0xC0, "Piezas a contar:" },
+    { "VaciaBufLCD_32_celdas", PreparaVacia, CorreVacia, 0xC0, "Suelte el boton " },
+#ifdef BANCO_RW
+    { "Sin_respuesta_BF", PreparaMudo, CorreMensaje, 0x80, " Bienvenido " },
+#endif
+};
+
+#define CASOS (sizeof casos / sizeof casos[0])
+
+typedef struct {
+    char nombre[48];
+    unsigned long pulsos, ciclos;
+} Base;
+
+static Base base[64];
+static int nBase;
+
+static void LeeBase(const char *archivo)
+{
+    FILE *f = fopen(archivo, "r");
+    char linea[128];
+
+    if (f == NULL) {
+        return;                         // Sin base no hay contra que comparar (la primera corrida usa -g).
+    }
+    while (fgets(linea, sizeof linea, f) != NULL && nBase < 64) {
+        if (linea[0] == '#' || linea[0] == '\n') {
+            continue;
+        }
+        if (sscanf(linea, "%47s %lu %lu", base[nBase].nombre, &base[nBase].pulsos, &base[nBase].ciclos) == 3) {
+            nBase++;
+        }
+    }
+    fclose(f);
+}
+
+static const Base *BuscaBase(const char *nombre)
+{
+    int i;
+
+    for (i = 0; i < nBase; i++) {
+        if (strcmp(base[i].nombre, nombre) == 0) {
+            return &base[i];
+        }
+    }
+    return NULL;
+}
+
+static int RevisaPantalla(unsigned char direccion, const char *esperado)
+{
+    unsigned char d = direccion & 0x7F;
+    size_t i;
+
+    for (i = 0; esperado[i] != '\0'; i++) {
+        if (lcdDdram[d + i] != (unsigned char)esperado[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int CorreCasos(FILE *nuevaBase)
+{
+    const Caso *c;
+    const Base *b;
+    size_t i;
+    int fallas = 0;
+    const char *nota;
+    char nombre[48];
+
+    printf("%-26s %7s %6s %6s %5s %12s %9s %9s\n", "caso", "pulsos", "datos", "instr", "lect", "retardo_us", "ciclos", "base");
+    for (i = 0; i < 2 * CASOS; i++) {   // Todos los casos con el bus de 4 bits y despues con el de 8.
+        c = &casos[i % CASOS];
+        bus = i < CASOS ? 4 : 8;
+        snprintf(nombre, sizeof nombre, "%u/%s", bus, c->nombre);
+        if (c->prepara != NULL) {
+            c->prepara();
+        }
+        ahoraUs += 1000.0;              // Lo que se prepara no deja el LCD ocupado para el caso.
+        ciclos = 0;
+        retardoUs = 0.0;
+        lcdPulsos = lcdDatos = lcdInstrucciones = lcdOcupado = 0;
+        lcdLecturas = lcdChoques = 0;
+        c->corre();
+
+        nota = "";
+        b = BuscaBase(nombre);
+        if (c->esperado != NULL && !RevisaPantalla(c->direccion, c->esperado)) {
+            nota = "  PANTALLA MAL";
+            fallas++;
+        } else if (lcdOcupado != 0) {
+            nota = "  LCD OCUPADO";
+            fallas++;
+        } else if (lcdChoques != 0) {
+            nota = "  CHOQUE EN EL BUS";
+            fallas++;
+        } else if (nuevaBase == NULL && b != NULL && (lcdPulsos > b->pulsos || ciclos > b->ciclos)) {
+            nota = "  REGRESION";
+            fallas++;
+        } else if (nuevaBase == NULL && b != NULL && (lcdPulsos < b->pulsos || ciclos < b->ciclos)) {
+            nota = "  mejor";
+        }
+        if (b != NULL) {
+            printf("%-26s %7lu %6lu %6lu %5lu %12.0f %9lu %9lu%s\n", nombre, lcdPulsos, lcdDatos, lcdInstrucciones,
+                   lcdLecturas, retardoUs, ciclos, b->ciclos, nota);
+        } else {
+            printf("%-26s %7lu %6lu %6lu %5lu %12.0f %9lu %9s%s\n", nombre, lcdPulsos, lcdDatos, lcdInstrucciones,
+                   lcdLecturas, retardoUs, ciclos, "-", nota);
+        }
+        if (nuevaBase != NULL) {
+            fprintf(nuevaBase, "%s %lu %lu\n", nombre, lcdPulsos, ciclos);
+        }
+    }
+    return fallas;
+}
+
+// ============================== CONVERSIONES ==============================
+
+static unsigned long ciclosReferencia;
+
+#define DIV16(a, b) (ciclosReferencia += BANCO_CICLOS_DIV16, (a) / (b))
+#define MOD16(a, b) (ciclosReferencia += BANCO_CICLOS_MOD16, (a) % (b))
+#define DIV8(a, b)  (ciclosReferencia += BANCO_CICLOS_DIV8, (a) / (b))
+#define MOD8(a, b)  (ciclosReferencia += BANCO_CICLOS_MOD8, (a) % (b))
+
+static void Referencia16(unsigned int a, unsigned char *digitos)
+{
+//Lo que hacia EscribeLCD_n16 con 5 digitos
+    digitos[0] = (unsigned char)DIV16(a, 10000);
+    digitos[1] = (unsigned char)DIV16(MOD16(a, 10000), 1000);
+    digitos[2] = (unsigned char)DIV16(MOD16(a, 1000), 100);
+    digitos[3] = (unsigned char)DIV16(MOD16(a, 100), 10);
+    digitos[4] = (unsigned char)MOD16(a, 10);
+}
+
+static void ReferenciaBuf(unsigned int a, unsigned char *digitos)
+{
+//Lo que hacia EscribeBufLCD_n con 5 digitos: a % 10 y a / 10 por digito
+    int i;
+
+    for (i = 4; i >= 0; i--) {
+        digitos[i] = (unsigned char)MOD16(a, 10);
+        a = DIV16(a, 10);
+    }
+}
+
+static void Referencia8(unsigned char a, unsigned char *digitos)
+{
+//Lo que hacia EscribeLCD_n8 con 3 digitos
+    digitos[0] = (unsigned char)DIV8(a, 100);
+    digitos[1] = (unsigned char)DIV8(MOD8(a, 100), 10);
+    digitos[2] = (unsigned char)MOD8(a, 10);
+}
+
+static unsigned long ReferenciaDoprnt(unsigned long a, int bits)
+{
+//Lo que cuesta %u (bits 16) o %lu (bits 32) en el doprnt de XC8: division y modulo por digito escrito
+    unsigned long n = BANCO_CICLOS_DOPRNT;
+
+    do {
+        n += bits == 16 ? BANCO_CICLOS_DIV16 + BANCO_CICLOS_MOD16 : BANCO_CICLOS_DIV32 + BANCO_CICLOS_MOD32;
+        a /= 10;
+    } while (a != 0);
+    return n;
+}
+
+typedef struct {
+    unsigned long minimo, maximo;
+    double suma;
+} Costo;
+
+static void SumaCosto(Costo *c, unsigned long n, int primero)
+{
+    if (primero || n < c->minimo) {
+        c->minimo = n;
+    }
+    if (primero || n > c->maximo) {
+        c->maximo = n;
+    }
+    c->suma += (double)n;
+}
+
+static void ImprimeCosto(const char *nombre, const Costo *c, unsigned long valores)
+{
+    printf("%-24s %9lu %9.1f %9lu\n", nombre, c->minimo, c->suma / (double)valores, c->maximo);
+}
+
+static int CorreConversiones(void)
+{
+    Costo bcd16 = { 0 }, n16 = { 0 }, buf = { 0 }, bcd8 = { 0 }, n8 = { 0 };
+    unsigned char digitos[5], referencia[5], otra[5];
+    unsigned long v, errores = 0;
+    int fallas = 0;
+
+    for (v = 0; v <= 0xFFFF; v++) {
+        ciclos = 0;
+        BCD_Convierte16((unsigned int)v, digitos);
+        SumaCosto(&bcd16, ciclos, v == 0);
+        ciclosReferencia = 0;
+        Referencia16((unsigned int)v, referencia);
+        SumaCosto(&n16, ciclosReferencia, v == 0);
+        ciclosReferencia = 0;
+        ReferenciaBuf((unsigned int)v, otra);
+        SumaCosto(&buf, ciclosReferencia, v == 0);
+        if (memcmp(digitos, referencia, 5) != 0 || memcmp(digitos, otra, 5) != 0) {
+            if (errores++ < 5) {
+                printf("BCD_Convierte16(%lu) = %u%u%u%u%u\n", v, digitos[0], digitos[1], digitos[2], digitos[3], digitos[4]);
+            }
+        }
+    }
+    for (v = 0; v <= 0xFF; v++) {
+        ciclos = 0;
+        BCD_Convierte8((unsigned char)v, digitos);
+        SumaCosto(&bcd8, ciclos, v == 0);
+        ciclosReferencia = 0;
+        Referencia8((unsigned char)v, referencia);
+        SumaCosto(&n8, ciclosReferencia, v == 0);
+        if (memcmp(digitos, referencia, 3) != 0) {
+            if (errores++ < 5) {
+                printf("BCD_Convierte8(%lu) = %u%u%u\n", v, digitos[0], digitos[1], digitos[2]);
+            }
+        }
+    }
+
+    printf("\n%-24s %9s %9s %9s\n", "conversion (ciclos)", "minimo", "promedio", "maximo");
+    ImprimeCosto("BCD_Convierte16", &bcd16, 0x10000);
+    ImprimeCosto("divisiones n16", &n16, 0x10000);
+    ImprimeCosto("divisiones BufLCD_n", &buf, 0x10000);
+    ImprimeCosto("BCD_Convierte8", &bcd8, 0x100);
+    ImprimeCosto("divisiones n8", &n8, 0x100);
+
+    if (errores != 0) {
+        printf("%lu conversiones distintas a las divisiones\n", errores);
+        fallas++;
+    }
+    if (bcd16.maximo >= n16.minimo || bcd16.maximo >= buf.minimo || bcd8.maximo >= n8.minimo) {
+        printf("REGRESION: el double dabble ya no es mas rapido que las divisiones\n");
+        fallas++;
+    }
+    return fallas;
+}
+
+static int RevisaTexto(unsigned long v, const char *texto, unsigned char largo)
+{
+    char esperado[16];
+
+    snprintf(esperado, sizeof esperado, "%lu", v);
+    if (strcmp(texto, esperado) != 0 || largo != strlen(esperado)) {
+        printf("BCD_Texto(%lu) = \"%s\" (%u caracteres)\n", v, texto, largo);
+        return 1;
+    }
+    return 0;
+}
+
+static const unsigned long bordes[] = { // Donde cambia la cantidad de digitos.
+    0, 9, 10, 99, 100, 999, 1000, 9999, 10000, 99999, 100000, 999999, 1000000, 9999999, 10000000,
+    99999999, 100000000, 999999999, 1000000000, 0xFFFFFFFFUL
+};
+#define BORDES (int)(sizeof bordes / sizeof bordes[0])
+
+static int CorreTexto(void)
+{
+//Las respuestas por serial: BCD_Texto16 con los 65536 valores, BCD_Texto32 con los bordes de cada digito y 2^20 valores al azar
+    Costo t16 = { 0 }, p16 = { 0 }, t32 = { 0 }, p32 = { 0 };
+    char texto[BCD_TEXTO32];
+    unsigned char largo;
+    unsigned long v, semilla = 1, valores = 0, errores = 0;
+    int fallas = 0, i;
+
+    for (v = 0; v <= 0xFFFF; v++) {
+        ciclos = 0;
+        largo = BCD_Texto16((unsigned int)v, texto);
+        SumaCosto(&t16, ciclos + 5 * BANCO_CICLOS_TEXTO, v == 0);
+        SumaCosto(&p16, ReferenciaDoprnt(v, 16), v == 0);
+        errores += (unsigned long)RevisaTexto(v, texto, largo);
+    }
+    for (i = 0; i < BORDES + (1 << 20); i++) {
+        if (i < BORDES) {
+            v = bordes[i];
+        } else {
+            semilla = (semilla * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+            v = semilla >> (semilla & 0x1F) % 24; // De todos los largos, no solo de 10 digitos.
+        }
+        ciclos = 0;
+        largo = BCD_Texto32(v, texto);
+        SumaCosto(&t32, ciclos + 10 * BANCO_CICLOS_TEXTO, valores == 0);
+        SumaCosto(&p32, ReferenciaDoprnt(v, 32), valores == 0);
+        valores++;
+        errores += (unsigned long)RevisaTexto(v, texto, largo);
+    }
+
+    printf("\n%-24s %9s %9s %9s\n", "texto (ciclos)", "minimo", "promedio", "maximo");
+    ImprimeCosto("BCD_Texto16", &t16, 0x10000);
+    ImprimeCosto("doprnt %u", &p16, 0x10000);
+    ImprimeCosto("BCD_Texto32", &t32, valores);
+    ImprimeCosto("doprnt %lu", &p32, valores);
+
+    if (errores != 0) {
+        printf("%lu textos distintos a snprintf\n", errores);
+        fallas++;
+    }
+    if (t16.maximo >= p16.maximo || t16.suma >= p16.suma || t32.maximo >= p32.maximo || t32.suma >= p32.suma) {
+        printf("REGRESION: BCD_Texto ya no es mas rapido que doprnt\n");
+        fallas++;
+    }
+    return fallas;
+}
+
+// ============================== PRINCIPAL ==============================
+
+static void Uso(void)
+{
+    fprintf(stderr, "uso: banco-lcd [-g] [base.txt]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *archivo = NULL;
+    FILE *nuevaBase = NULL;
+    int i, guarda = 0, fallas;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0) {
+            guarda = 1;
+        } else if (argv[i][0] == '-') {
+            Uso();
+        } else {
+            archivo = argv[i];
+        }
+    }
+    if (guarda && archivo == NULL) {
+        Uso();
+    }
+    if (archivo != NULL && !guarda) {
+        LeeBase(archivo);
+    }
+    if (guarda) {
+        nuevaBase = fopen(archivo, "w");
+        if (nuevaBase == NULL) {
+            perror(archivo);
+            return 2;
+        }
+        fprintf(nuevaBase, "# make banco: caso pulsos ciclos (se actualiza con -g %s)\n", archivo);
+    }
+
+    fallas = CorreCasos(nuevaBase);
+    fallas += CorreConversiones();
+    fallas += CorreTexto();
+    if (nuevaBase != NULL) {
+        fclose(nuevaBase);
+    }
+    if (fallas != 0) {
+        printf("\n%d fallas\n", fallas);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * File:   xc.h (banco de pruebas del LCD)
+ *
+ * Reemplazo minimo de <xc.h> para make banco: LibLCDXC8_1.h y LibLCDBufXC8.h
+ * solo necesitan los retardos y NOP(). El bus (Datos, RS y E) lo define
+ * host/banco.c antes de incluirlas; los retardos y los ciclos hacen avanzar el
+ * reloj del banco.
+ */
+
+#ifndef BANCO_XC_H
+#define	BANCO_XC_H
+
+void banco_retardo_us(double);
+void banco_ciclos(unsigned long);
+
+#define __delay_us(x)   banco_retardo_us((double)(x))
+#define __delay_ms(x)   banco_retardo_us((double)(x) * 1000.0)
+#define NOP()           banco_ciclos(1)
+
+#endif	/* BANCO_XC_H */
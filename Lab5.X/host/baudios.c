@@ -0,0 +1,151 @@
+/*
+ * File:   baudios.c
+ *
+ * Revisa la tabla de baudios de LibUARTXC8.h (make baudios). Compila la
+ * libreria con gcc contra host/xc.h para un RELOJ_MHZ (-DRELOJ_MHZ=n, una
+ * vez por reloj) y compara lo que calculan UART_Divisor() y UART_ErrorBRG()
+ * con la columna de ese reloj en el comentario del encabezado:
+ *
+ *   baudios-n [LibUARTXC8.h]
+ *
+ * Por cada fila imprime "MHz/baudios brg error ok" y sale con 1 si el
+ * SPBRGH:SPBRG o el error no coinciden con la tabla, si UART_Divisor() acepta
+ * un error de mas de UART_ERROR_MAX (o rechaza uno menor), si brg - 1 o
+ * brg + 1 darian al menos 0.02 % menos de error (UART_BRG redondea el
+ * divisor, no los baudios: en un empate de medio divisor, como 38400 a
+ * 48 MHz, el vecino puede quedar 0.01 % mejor), si UART_SPBRG no es
+ * lo que UART_Divisor() da para UART_BAUDIOS o si UART_Velocidad() y
+ * UART_LeeBRG() no devuelven el mismo valor.
+ */
+
+#include <stdio.h>
+
+#include "../LibUARTXC8.h"
+
+// Registros que usa la libreria: aqui no hay PIC, solo memoria.
+volatile sim_pir1_t PIR1bits, PIE1bits;
+volatile sim_txsta_t TXSTAbits;
+volatile sim_baudcon_t BAUDCONbits;
+volatile unsigned char SPBRG, SPBRGH;
+static volatile sim_rcsta_t rcsta;
+static volatile unsigned char txreg;
+
+volatile sim_rcsta_t *sim_rcsta(void)
+{
+    return &rcsta;
+}
+
+volatile unsigned char *sim_txreg(void)
+{
+    return &txreg;
+}
+
+unsigned char sim_lee_rcreg(void)
+{
+    return 0;
+}
+
+#define COLUMNAS 3
+
+static int fallas;
+
+static void Falla(const char *texto, unsigned long baudios)
+{
+    printf("  FALLA %lu baudios: %s\n", baudios, texto);
+    fallas++;
+}
+
+// Una fila de la tabla: "baudios  brg e.ee %  brg e.ee %  brg e.ee %"
+static int LeeFila(const char *linea, unsigned long *baudios, unsigned int brg[], unsigned int error[])
+{
+    unsigned int entero[COLUMNAS], decimas[COLUMNAS];
+    int i;
+
+    if (sscanf(linea, " * %lu %u %u.%u %% %u %u.%u %% %u %u.%u %%", baudios, &brg[0], &entero[0], &decimas[0],
+               &brg[1], &entero[1], &decimas[1], &brg[2], &entero[2], &decimas[2]) != 10) {
+        return 0;
+    }
+    for (i = 0; i < COLUMNAS; i++) {
+        error[i] = entero[i] * 100 + decimas[i];
+    }
+    return 1;
+}
+
+static void RevisaFila(unsigned long baudios, unsigned int brgTabla, unsigned int errorTabla)
+{
+    unsigned int brg = 0, error, vecino;
+    unsigned char ok;
+
+    ok = UART_Divisor(baudios, &brg);
+    error = UART_ErrorBRG(baudios, brg);
+    printf("%d/%lu %u %u.%02u %s\n", RELOJ_MHZ, baudios, brg, error / 100, error % 100, ok ? "ok" : "no");
+    if (brg != brgTabla || error != errorTabla) {
+        Falla("no coincide con la tabla de LibUARTXC8.h", baudios);
+    }
+    if (ok != (error <= UART_ERROR_MAX)) {
+        Falla("UART_Divisor no respeta UART_ERROR_MAX", baudios);
+    }
+    if (brg > 0 && UART_ErrorBRG(baudios, brg - 1) + 1 < error) {
+        Falla("brg - 1 da menos error", baudios);
+    }
+    vecino = brg + 1;
+    if (vecino <= 65535 && UART_ErrorBRG(baudios, vecino) + 1 < error) {
+        Falla("brg + 1 da menos error", baudios);
+    }
+    UART_Velocidad(brg);
+    if (UART_LeeBRG() != brg) {
+        Falla("UART_LeeBRG no devuelve lo que escribio UART_Velocidad", baudios);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *nombre = argc > 1 ? argv[1] : "LibUARTXC8.h";
+    char linea[256];
+    unsigned long baudios, reloj[COLUMNAS];
+    unsigned int brg[COLUMNAS], error[COLUMNAS], brgArranque = 0;
+    int columna = -1, filas = 0, i;
+    FILE *f;
+
+    f = fopen(nombre, "r");
+    if (f == NULL) {
+        perror(nombre);
+        return 2;
+    }
+    while (fgets(linea, sizeof linea, f) != NULL) {
+        if (columna < 0) {
+            // Encabezado: "baudios     1 MHz        8 MHz        48 MHz"
+            if (sscanf(linea, " * baudios %lu MHz %lu MHz %lu MHz", &reloj[0], &reloj[1], &reloj[2]) == 3) {
+                for (i = 0; i < COLUMNAS; i++) {
+                    if (reloj[i] == RELOJ_MHZ) {
+                        columna = i;
+                    }
+                }
+                if (columna < 0) {
+                    fprintf(stderr, "%s: la tabla no tiene columna para %d MHz\n", nombre, RELOJ_MHZ);
+                    return 2;
+                }
+            }
+        } else if (LeeFila(linea, &baudios, brg, error)) {
+            RevisaFila(baudios, brg[columna], error[columna]);
+            filas++;
+        } else if (filas > 0) {
+            break;                      // Se acabo la tabla.
+        }
+    }
+    fclose(f);
+    if (filas == 0) {
+        fprintf(stderr, "%s: no se encontro la tabla de baudios\n", nombre);
+        return 2;
+    }
+
+    if (UART_Divisor(UART_BAUDIOS, &brgArranque) == 0 || brgArranque != UART_SPBRG) {
+        Falla("UART_SPBRG no es lo que da UART_Divisor para UART_BAUDIOS", UART_BAUDIOS);
+    }
+    if (UART_Divisor(0, &brgArranque) || UART_Divisor(UART_BAUDIOS_MAX + 1, &brgArranque)) {
+        Falla("UART_Divisor acepta baudios fuera de rango", 0);
+    }
+
+    printf("%d MHz: %d filas, %s\n", RELOJ_MHZ, filas, fallas ? "FALLA" : "ok");
+    return fallas ? 1 : 0;
+}
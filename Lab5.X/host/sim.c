@@ -0,0 +1,1836 @@
+/*
+ * File:   sim.c
+ *
+ * Simulador en Linux del PIC18F4550 de Lab5 para probar la logica del
+ * contador, el teclado, el UART y el LCD sin la tarjeta (make host).
+ *
+ *   lab5-sim [-u|-d] [-q] [-b baudios] [-o salida.bin] [-e eeprom.bin] [-p us] [-t] [-c base.txt [-g]] [guion|-]
+ *
+ *   -u   arranca como reset de usuario (POR=1) en vez de falla de energia
+ *   -d   arranca como caida de tension (BOR=0, POR=1)
+ *   -q   no imprime lo que el PIC transmite por serial
+ *   -b   baudios del terminal que manda los comandos (por defecto 9600)
+ *   -o   guarda los bytes transmitidos tal cual (sirve para Telemetria/lab5-telemetria)
+ *   -e   EEPROM de datos (256 bytes): se carga al arrancar si existe y se guarda al
+ *        terminar, asi dos corridas seguidas son un corte de energia
+ *   -p   termina con codigo 1 si la parada de emergencia no deja las salidas
+ *        seguras en menos de us microsegundos (o si el guion no pide ninguna)
+ *   -t   termina con codigo 1 si algun byte (RX o TX) tuvo error de trama o si una
+ *        medicion de auto-baud no termino
+ *   -c   compara el maximo de ciclos de cada fila de la tabla de ISR con base.txt
+ *        (una linea "causas entradas ciclos maximo" por fila) y termina con codigo 1
+ *        si alguna empeora; con -g reescribe base.txt con esta corrida
+ *
+ * El guion es texto, una orden por linea, '#' empieza un comentario. Los
+ * tiempos van en milisegundos y las ordenes se ejecutan en el instante del
+ * guion (empieza en 0). Solo espera, tecla y pieza hacen avanzar ese instante.
+ *
+ *   espera <ms>                 avanza el instante del guion
+ *   tecla <nombre> [ms]         mantiene una tecla (por defecto 100 ms): 0..9, OK, ESTOP, SUPR, REINICIO, FIN, LUZ
+ *   parada [ms]                 mantiene el boton de parada en RB0/INT0 (por defecto 100 ms)
+ *   pieza [ms] [rebotes]        RC1 en bajo (por defecto 50 ms), con rebotes de 1 ms al inicio
+ *   tren <n> <periodo> [ms] [rebotes] [rebote_ms]  n piezas seguidas cada periodo ms, cada una
+ *                               en bajo ms (por defecto medio periodo) con rebotes al inicio, uno
+ *                               cada rebote_ms (por defecto 0.2 ms, la mitad en bajo)
+ *   serial <texto>              el terminal envia texto (acepta \r \n \\ \xHH)
+ *   baudios <n>                 el terminal cambia de velocidad (lo que ya va por el cable no)
+ *   tension                     VDD baja del nivel del HLVD (HLVDIF, si HLVDEN=1 y VDIRMAG=0)
+ *   adc <valor> [canal] [ruido] fija el voltaje de la entrada analoga (0..1023, canal 0 por defecto);
+ *                               con ruido cada conversion suma un valor al azar entre -ruido y +ruido
+ *   lcd                         imprime lo que muestra el LCD
+ *   estado                      imprime motor (% de PWM), RGB, 7 segmentos y LEDs
+ *   verifica <texto>            el PIC tuvo que transmitir texto desde el verifica anterior
+ *                               (las lineas van separadas por \n, sin \r)
+ *   pantalla <texto>            el LCD muestra texto en alguna de sus dos lineas (los caracteres
+ *                               de la CGRAM se ven como #)
+ *   contador <nombre> <n>       un contador del simulador vale n: flancos (de bajada en RC1),
+ *                               pisadas (capturas de CCP2), trama (bytes con error de trama),
+ *                               perdidos (bytes RX perdidos u OERR), ocupado (pulsos de E
+ *                               con el LCD ocupado), eeprom (bytes escritos en la EEPROM)
+ *
+ * Si un verifica, una pantalla o un contador no se cumple se imprime FALLA
+ * con la linea del guion y el simulador termina con codigo 1 (make lo toma
+ * como prueba fallida).
+ *
+ * El tiempo del programa solo avanza en los puntos de espera (ver xc.h). La
+ * ISR cuesta SIM_CICLOS_ISR ciclos fijos (entrada y salida), mas un costo
+ * por cada causa pendiente al entrar (ciclosCausa, abajo), mas lo que
+ * esperen sus retardos. El cuerpo corre de una vez al entrar y ese costo se
+ * cobra despues, antes de salir: ocupa la ISR (lo que no deja entrar a otras
+ * causas ni correr a main) pero las latencias que mide el simulador (la
+ * parada, GET ISR n) solo ven la entrada. ciclosCausa es un modelo escrito a
+ * mano, no sale de un listado de XC8: cambiar el codigo de una rama no cambia
+ * lo que cobra, solo los retardos que llame y cuantas veces entre. La corrida
+ * es determinista: el mismo guion da siempre la misma salida y el mismo
+ * resumen de ciclos por causa de interrupcion.
+ *
+ * Con IPEN=1 hay dos vectores: ISR_Alta (bits IP en 1, INT0 siempre) entra
+ * aunque ISR este a medias y cuesta SIM_CICLOS_ISR_ALTA. La parada de
+ * emergencia se mide desde que se pide (tecla ESTOP, boton en RB0 o la linea
+ * "P", en el instante en que su fin de linea llega a RCREG; una 'P' o un fin
+ * de linea con error de trama no la piden) hasta que
+ * RC2 queda en 0 y el RGB en rojo. El PWM toma CCPR1L al empezar cada periodo,
+ * como el PIC: bajar solo el ciclo util no apaga el motor de inmediato.
+ *
+ * El bus del LCD esta en el puerto que pasa HAL_LCD() (sim_lcd_puerto: D con
+ * LCD_BUS 4, B con LCD_BUS 8); RS es RA4 y E es RA5. El R/W va en RC0
+ * (host/lab5-sim-rw se compila con RW=LATC0, ver ConfigLCD.h): un pulso de E
+ * con RC0 en 1 es una lectura y el puerto del bus trae en los pines de entrada
+ * la bandera de ocupado (en 1 mientras dura la instruccion anterior) y el
+ * contador de direcciones. Sin RW, RC0 queda en 0.
+ *
+ * Un byte en cualquier sentido con el PIC a mas de 4 % de los baudios del
+ * terminal es un error de trama (en TX se muestra como <~>). Con ABDEN=1 el
+ * byte que llega no se recibe: se mide del primer al quinto flanco de subida
+ * (8 bits con 0x55) y ese conteo queda en SPBRGH:SPBRG, como el auto-baud del
+ * EUSART.
+ */
+
+#define SIM_INTERNO
+#include "xc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define SIM_CICLOS_ISR 30               // Guardar y restaurar contexto de la ISR de XC8 (aprox.).
+#define SIM_CICLOS_ISR_ALTA 12          // ISR de alta prioridad: W, STATUS y BSR van en los registros sombra.
+#define SIM_CICLOS_ESPERA 25            // Lo que cuesta una vuelta de un ciclo de espera de main (HAL_ESPERA).
+#define SIM_PS_LCD_CORTO 37000000ULL    // 37 us: instrucciones y datos del HD44780.
+#define SIM_PS_LCD_LARGO 1520000000ULL  // 1.52 ms: borrar pantalla y cursor a inicio.
+
+void ISR(void);                         // De Lab5.c (con __interrupt() vacio queda como funcion comun): baja prioridad, o la unica con IPEN=0.
+void ISR_Alta(void);                    // De Lab5.c: alta prioridad (solo se llama con IPEN=1).
+void Lab5_Main(void);                   // main() de Lab5.c, renombrado con -Dmain=Lab5_Main.
+
+// ============================== REGISTROS ==============================
+
+volatile sim_puerto_t LATAbits, LATBbits, LATCbits, LATDbits, LATEbits;
+volatile sim_puerto_t TRISAbits, TRISBbits, TRISCbits, TRISDbits, TRISEbits;
+volatile sim_intcon_t INTCONbits;
+volatile sim_intcon2_t INTCON2bits;
+volatile sim_intcon3_t INTCON3bits;
+volatile sim_pir1_t PIR1bits, PIE1bits, IPR1bits;
+volatile sim_pir2_t PIR2bits, PIE2bits, IPR2bits;
+volatile sim_rcon_t RCONbits;
+volatile sim_txsta_t TXSTAbits;
+volatile sim_baudcon_t BAUDCONbits;
+volatile sim_adcon0_t ADCON0bits;
+volatile sim_t0con_t T0CONbits;
+volatile sim_t1con_t T1CONbits, T3CONbits;
+volatile sim_t2con_t T2CONbits;
+volatile sim_osccon_t OSCCONbits;
+volatile sim_hlvdcon_t HLVDCONbits;
+
+volatile unsigned char ADCON1, ADCON2, SPBRG, SPBRGH, TMR2, PR2;
+volatile unsigned char CCP1CON, CCP2CON, CCPR1L;
+volatile unsigned char EEADR;
+volatile unsigned short TMR0, TMR1, TMR3, ADRES, CCPR1, CCPR2;
+
+static volatile sim_rcsta_t rcsta;
+static volatile sim_eecon1_t eecon1;
+static volatile unsigned char eecon2, eedata;
+static volatile unsigned char txregEscrito;
+
+// ============================== ESTADO DEL SIMULADOR ==============================
+
+enum { CAUSA_INT0, CAUSA_TMR0, CAUSA_RB, CAUSA_TX, CAUSA_RC, CAUSA_TMR1, CAUSA_TMR2,
+       CAUSA_CCP1, CAUSA_AD, CAUSA_CCP2, CAUSA_TMR3, CAUSA_EE, CAUSA_HLVD, CAUSAS };
+
+#define SIM_ALTA (1u << CAUSAS)         // En EstadisticaIsr.causas: entrada a ISR_Alta.
+#define SIM_ADC_DECIMA 16               // Cada tantas conversiones Adc_ISR decima (cuesta SIM_CICLOS_ADC_DECIMA).
+#define SIM_CICLOS_ADC_DECIMA 140
+
+// Costo estimado del cuerpo de la ISR por causa (ciclos de instruccion, XC8 sin optimizar, ramas de Lab5.c)
+static const unsigned int ciclosCausa[CAUSAS] = {
+    [CAUSA_INT0] = 16,                  // INT0IF y ParadaEmergencia (pines, CCP1 y banderas).
+    [CAUSA_TMR0] = 230,                 // Recarga, una fila del teclado sin cambios, rampa, ADC y Tareas_Tick.
+    [CAUSA_RB] = 20,                    // Teclado_Cambio sin la columna de la parada en 0 (con ella suma sus esperas).
+    [CAUSA_TX] = 22,                    // UART_ServicioTx: un byte a TXREG.
+    [CAUSA_RC] = 50,                    // UART_RecibeISR (RCREG, OERR, cola), la revision de la parada y la inactividad.
+    [CAUSA_TMR1] = 20,                  // Segundos de inactividad.
+    [CAUSA_AD] = 18,                    // Adc_ISR que solo suma la muestra.
+    [CAUSA_CCP2] = 80,                  // Marca de 32 bits, ventana, sensorMarcas y contadores.
+    [CAUSA_TMR3] = 12,                  // t3Vueltas++.
+    [CAUSA_EE] = 35,                    // Bitacora_ISR: un byte con la secuencia 0x55/0xAA.
+    [CAUSA_HLVD] = 30,                  // Bitacora_Urgente y Tareas_Programa.
+};
+#define ISR_NINGUNA 0                   // Valores de enIsr.
+#define ISR_BAJA 1
+#define ISR_ALTA 2
+
+static const char *nombreCausa[CAUSAS] = {
+    "INT0", "TMR0", "RB", "TXIF", "RCIF", "TMR1", "TMR2", "CCP1", "ADC", "CCP2", "TMR3", "EEPROM", "HLVD"
+};
+
+typedef struct {
+    unsigned int causas;                // Bits (1 << CAUSA_x) pendientes al entrar a la ISR.
+    unsigned long entradas;
+    uint64_t ciclos;
+    uint64_t maximo;
+} EstadisticaIsr;
+
+enum { EV_TECLA, EV_SENSOR, EV_SERIAL, EV_ADC, EV_LCD, EV_ESTADO, EV_PARADA, EV_BAUDIOS, EV_TENSION,
+       EV_VERIFICA, EV_PANTALLA, EV_CONTADOR, EV_FIN };
+
+enum { CONT_FLANCOS, CONT_PISADAS, CONT_TRAMA, CONT_PERDIDOS, CONT_OCUPADO, CONT_EEPROM, CONTADORES };
+
+static const char *nombreContador[CONTADORES] = { "flancos", "pisadas", "trama", "perdidos", "ocupado", "eeprom" };
+
+typedef struct {
+    uint64_t ps;                        // Instante del evento en picosegundos.
+    int tipo;
+    int a, b;
+    int linea;                          // Linea del guion (para los mensajes de verifica y contador).
+    unsigned char *datos;
+    size_t largo;
+} Evento;
+
+static Evento *eventos;
+static size_t nEventos, capEventos, iEvento;
+
+static double fosc = 1000000.0;         // La fija sim_reloj() al arrancar y se actualiza con el _XTAL_FREQ de cada __delay.
+static uint64_t psCiclo = 4000000;      // Duracion de un ciclo de instruccion (Fosc/4).
+static uint64_t ciclo;
+static uint64_t ahoraPs;
+static int enIsr;                       // ISR_NINGUNA, ISR_BAJA o ISR_ALTA (la de baja puede quedar debajo de la de alta).
+static int durmiendo;
+static EstadisticaIsr estIsr[64];      // Una fila por combinacion de causas vista.
+static int nEstIsr;
+static unsigned long desbordesPerdidos[4]; // TMR0, TMR1, TMR2, TMR3 con la bandera todavia en 1.
+static unsigned long vecesDormido;
+static unsigned long vecesIdle;
+static uint64_t ciclosIdle;
+
+static unsigned char pre0, pre1, pre2, post2, pre3;
+
+static unsigned char teclas[4];         // Columnas presionadas por fila (bit0 = RB4).
+static unsigned char rbLatch = 0xF0;    // Ultimo valor de RB7..RB4 leido (para RBIF).
+static unsigned char sensorNivel = 1;
+static unsigned char botonParada = 1;   // RB0 con el boton suelto (pull-up).
+static unsigned char int0Anterior = 1;  // Nivel de RB0 en el paso anterior (flancos de INT0).
+static unsigned short pwmDuty;          // Ciclo util que el PWM tomo al empezar el periodo (CCPR1L:DC1B).
+static unsigned char sensorAnterior = 1;
+static unsigned char ccp2Prescaler;     // Flancos de subida contados en los modos 1 de cada 4 / 1 de cada 16.
+static unsigned long flancosBajada, capturasPisadas;
+
+#define SIM_PS_EEPROM 4000000000ULL     // 4 ms por byte escrito (tipico del PIC18F4550).
+
+static unsigned char eeprom[256];
+static const char *archivoEeprom;
+static int eeDesbloqueo;                // 1 = llego 0x55 a EECON2, 2 = despues llego 0xAA.
+static uint64_t eeFinPs;                // Fin de la escritura en curso (0 = ninguna).
+static unsigned char eeDireccion, eeDato;
+static unsigned long eeEscrituras, eeSinSecuencia;
+static unsigned long eeDesgaste[256];  // Escrituras por direccion.
+
+static unsigned short adcEntrada[13];
+static unsigned short adcRuido[13];
+static uint32_t adcSemilla = 1;         // Generador propio: el mismo guion da siempre el mismo ruido.
+static uint64_t adcCiclos;
+
+static int txPendiente;                 // TXREG se escribio y falta pasarlo al transmisor.
+static int txRegLleno;
+static unsigned char txRegDato;
+static uint64_t txTsrCiclos;
+static unsigned char txTsrDato;
+static int txTsrError;                  // El byte en el transmisor salio a otra velocidad que la del terminal.
+static unsigned long txBytes, txPisados, txErrorTrama;
+static char txLinea[128];
+static size_t txLargo;
+static int silencioso;
+static FILE *salidaTx;
+
+static unsigned long baudTerminal = 9600;
+static unsigned char rxCable[4096];     // Bytes que el terminal esta enviando.
+static size_t rxCableLargo, rxCableIndice;
+static uint64_t rxFinPs;                // Fin del byte que va por el cable (0 = cable libre).
+static unsigned char rxFifo[2], rxFifoFerr[2];
+static unsigned char rxFifoCuenta;
+static unsigned char rxUltimo;
+static unsigned long rxBytes, rxPerdidos, rxDesbordes, rxErrorTrama;
+static unsigned long abdMediciones, abdSinU;    // Auto-baud: mediciones terminadas y con un byte distinto de 0x55.
+
+static unsigned char lcdDdram[80];
+static unsigned char lcdDireccion;      // Contador de direcciones (DDRAM o CGRAM).
+static int lcdEnCgram;
+static int lcdModo4 = 0;                // Arranca en 8 bits, como el HD44780 al energizar.
+static volatile sim_puerto_t *lcdLat = &LATDbits; // Puerto del bus (sim_lcd_puerto).
+static volatile sim_puerto_t *lcdTris = &TRISDbits;
+static int lcdMitad;                    // En 4 bits: ya llego el nibble alto.
+static unsigned char lcdAlto;
+static int lcdIncremento = 1, lcdDesplazaConEscritura;
+static int lcdDesplazamiento;
+static int lcdEAnterior;
+static uint64_t lcdOcupadoHastaPs;
+static unsigned long lcdInstrucciones, lcdDatos, lcdMientrasOcupado;
+static int lcdLecturaAlta;              // En 4 bits: el pulso de lectura actual trae el nibble alto.
+static unsigned long lcdLecturas;
+
+static const char *paradaFuente;        // Primera parada pedida por el guion (NULL = ninguna).
+static uint64_t paradaInicioPs, paradaFinPs; // Pedido y salidas seguras (0 = todavia no).
+static int paradaMotor;                 // % del motor cuando se pidio.
+static double paradaLimiteUs;           // -p (0 = sin limite).
+static int tramaEstricta;               // -t
+static const char *archivoBase;         // -c
+static int generaBase;                  // -g
+static const char *nombreGuion = "-";
+static int fallasGuion;                 // verifica y contador que no se cumplieron.
+static char txVisto[4096];              // Lo transmitido desde el ultimo verifica (imprimible, \n entre lineas).
+static size_t txVistoLargo;
+static unsigned char rxInicioLinea = 1; // El terminal empieza una linea.
+static unsigned char rxLineaParada;     // La linea va en una 'P' limpia: su fin de linea es parada.
+
+static void Termina(void);
+static int MotorPorcentaje(void);
+
+// ============================== UTILIDADES ==============================
+
+static double Milisegundos(uint64_t ps)
+{
+    return (double)ps / 1e9;
+}
+
+static double MicrosDeCiclos(uint64_t ciclos)
+{
+    return (double)ciclos * 4e6 / fosc;
+}
+
+static unsigned long DivisorBrg(void)
+{
+    if (BAUDCONbits.BRG16 && TXSTAbits.BRGH) {
+        return 4;
+    } else if (BAUDCONbits.BRG16 || TXSTAbits.BRGH) {
+        return 16;
+    }
+    return 64;
+}
+
+static unsigned long CiclosPorByteUart(void)
+{
+    unsigned long n;
+
+    n = BAUDCONbits.BRG16 ? ((unsigned long)SPBRGH << 8 | SPBRG) : SPBRG;
+    return 10 * DivisorBrg() * (n + 1) / 4; // 10 bits por byte, el BRG cuenta Tosc y el ciclo son 4 Tosc.
+}
+
+static double BaudiosPic(void)
+{
+    return 10.0 * fosc / 4.0 / (double)CiclosPorByteUart();
+}
+
+static int ErrorTrama(void)
+{
+    return BaudiosPic() < baudTerminal * 0.96 || BaudiosPic() > baudTerminal * 1.04;
+}
+
+// ============================== LCD (HD44780) ==============================
+
+static int IndiceDdram(unsigned char direccion)
+{
+    unsigned char columna = direccion & 0x3F;
+
+    if (columna >= 40) {
+        columna = 39;
+    }
+    return ((direccion & 0x40) ? 40 : 0) + columna;
+}
+
+static void AvanzaDireccionLcd(void)
+{
+    if (lcdEnCgram) {
+        lcdDireccion = (unsigned char)((lcdDireccion + (lcdIncremento ? 1 : -1)) & 0x3F);
+        return;
+    }
+    if (lcdIncremento) {
+        lcdDireccion++;
+        if ((lcdDireccion & 0x3F) == 40) {
+            lcdDireccion = (lcdDireccion & 0x40) ? 0x00 : 0x40;
+        }
+    } else {
+        if ((lcdDireccion & 0x3F) == 0) {
+            lcdDireccion = (lcdDireccion & 0x40) ? 0x27 : 0x67;
+        } else {
+            lcdDireccion--;
+        }
+    }
+}
+
+static void EjecutaLcd(int rs, unsigned char b)
+{
+    uint64_t duracion = SIM_PS_LCD_CORTO;
+    int i;
+
+    if (rs) {
+        lcdDatos++;
+        if (!lcdEnCgram) {
+            lcdDdram[IndiceDdram(lcdDireccion)] = b;
+            if (lcdDesplazaConEscritura) {
+                lcdDesplazamiento += lcdIncremento ? -1 : 1;
+            }
+        }
+        AvanzaDireccionLcd();
+    } else {
+        lcdInstrucciones++;
+        if (b & 0x80) {
+            lcdDireccion = b & 0x7F;
+            lcdEnCgram = 0;
+        } else if (b & 0x40) {
+            lcdDireccion = b & 0x3F;
+            lcdEnCgram = 1;
+        } else if (b & 0x20) {
+            lcdModo4 = (b & 0x10) == 0;
+            lcdMitad = 0;
+        } else if (b & 0x10) {
+            if (b & 0x08) {
+                lcdDesplazamiento += (b & 0x04) ? 1 : -1;
+            } else if (!lcdEnCgram) {
+                int incremento = lcdIncremento;
+                lcdIncremento = (b & 0x04) != 0;
+                AvanzaDireccionLcd();
+                lcdIncremento = incremento;
+            }
+        } else if (b & 0x08) {
+            // Display/cursor/parpadeo: no cambia lo que se imprime.
+        } else if (b & 0x04) {
+            lcdIncremento = (b & 0x02) != 0;
+            lcdDesplazaConEscritura = b & 0x01;
+        } else if (b & 0x02) {
+            lcdDireccion = 0;
+            lcdEnCgram = 0;
+            lcdDesplazamiento = 0;
+            duracion = SIM_PS_LCD_LARGO;
+        } else if (b & 0x01) {
+            for (i = 0; i < 80; i++) {
+                lcdDdram[i] = ' ';
+            }
+            lcdDireccion = 0;
+            lcdEnCgram = 0;
+            lcdIncremento = 1;
+            lcdDesplazamiento = 0;
+            duracion = SIM_PS_LCD_LARGO;
+        }
+    }
+    lcdOcupadoHastaPs = ahoraPs + duracion;
+}
+
+static void PulsoLcd(void)
+{
+    int rs = LATAbits.b4;               // RS = RA4, E = RA5 y el bus en lcdLat (ConfigLCD.h):
+    unsigned char bus = lcdLat->valor;  // con LCD_BUS 4 solo RD7..RD4 llevan datos una vez en 4 bits.
+
+    if (lcdModo4) {
+        bus &= 0xF0;
+    }
+
+    if (LATCbits.b0) {                  // R/W en RC0 (ConfigLCD.h): lectura, el LCD pone el bus (LeeBusLcd).
+        lcdLecturaAlta = lcdModo4 ? !lcdLecturaAlta : 1;
+        if (lcdLecturaAlta) {
+            lcdLecturas++;
+        }
+        return;
+    }
+    if (ahoraPs < lcdOcupadoHastaPs) {
+        lcdMientrasOcupado++;           // El programa no espero lo suficiente: en la tarjeta esto se puede perder.
+    }
+    if (!lcdModo4) {
+        EjecutaLcd(rs, bus);
+    } else if (!lcdMitad) {
+        lcdAlto = bus;
+        lcdMitad = 1;
+    } else {
+        lcdMitad = 0;
+        EjecutaLcd(rs, lcdAlto | (bus >> 4));
+    }
+}
+
+static void ObservaLcd(void)
+{
+//El HD44780 toma el dato con E en alto; aqui solo se ve E en los puntos de espera,
+//que es justo donde las librerias dejan E en alto (NOP o __delay_us)
+    int e = LATAbits.b5;
+
+    if (e && !lcdEAnterior) {
+        PulsoLcd();
+    }
+    lcdEAnterior = e;
+}
+
+static void LineaLcd(int linea, char *texto)
+{
+    int c, indice;
+    unsigned char ch;
+
+    for (c = 0; c < 16; c++) {
+        indice = ((c - lcdDesplazamiento) % 40 + 40) % 40;
+        ch = lcdDdram[linea * 40 + indice];
+        if (ch < 8) {
+            texto[c] = '#';             // Caracter de la CGRAM (estrella, marco).
+        } else if (ch >= 0x20 && ch < 0x7F) {
+            texto[c] = (char)ch;
+        } else {
+            texto[c] = '?';
+        }
+    }
+    texto[16] = '\0';
+}
+
+// ============================== PARADA DE EMERGENCIA ==============================
+
+static void PideParada(const char *fuente)
+{
+    if (paradaFuente == NULL) {         // El PIC queda detenido hasta el reset: solo cuenta la primera.
+        paradaFuente = fuente;
+        paradaInicioPs = ahoraPs;
+        paradaMotor = MotorPorcentaje();
+    }
+}
+
+//RC2 en 0 y el RGB en rojo (RE2 en 0, activo en bajo)
+static int SalidasSeguras(void)
+{
+    return MotorPorcentaje() == 0 && (LATEbits.valor & 0x07) == 0x03;
+}
+
+static void RevisaParada(void)
+{
+    if (paradaFuente == NULL || paradaFinPs != 0 || !SalidasSeguras()) {
+        return;
+    }
+    paradaFinPs = ahoraPs;
+    printf("[%10.3f ms] PARADA (%s): salidas seguras en %.0f us (motor al %d %%)\n", Milisegundos(ahoraPs),
+           paradaFuente, (double)(paradaFinPs - paradaInicioPs) / 1e6, paradaMotor);
+}
+
+// ============================== UART ==============================
+
+static void VaciaLineaTx(void)
+{
+    if (txLargo > 0 && !silencioso) {
+        printf("[%10.3f ms] TX %s\n", Milisegundos(ahoraPs), txLinea);
+    }
+    txLargo = 0;
+    txLinea[0] = '\0';
+}
+
+static void GuardaVisto(char c)
+{
+    if (txVistoLargo == sizeof txVisto - 1) {
+        memmove(txVisto, txVisto + sizeof txVisto / 2, txVistoLargo - sizeof txVisto / 2);
+        txVistoLargo -= sizeof txVisto / 2;
+    }
+    txVisto[txVistoLargo++] = c;
+    txVisto[txVistoLargo] = '\0';
+}
+
+static void SaleByteTx(unsigned char dato, int error)
+{
+    txBytes++;
+    if (error) {
+        GuardaVisto('~');
+    } else if (dato == '\n' || (dato >= 0x20 && dato < 0x7F)) {
+        GuardaVisto((char)dato);
+    } else if (dato != '\r') {
+        GuardaVisto('.');               // Binario (telemetria): no corta un texto que se busca con verifica.
+    }
+    if (salidaTx != NULL) {
+        fputc(dato, salidaTx);
+    }
+    if (error) {
+        txErrorTrama++;                 // El terminal no lo puede leer.
+        txLargo += (size_t)snprintf(txLinea + txLargo, sizeof txLinea - txLargo, "<~>");
+    } else if (dato == '\n') {
+        VaciaLineaTx();
+    } else if (dato == '\r') {
+        // Se ignora: las respuestas terminan en \r\n.
+    } else if (dato >= 0x20 && dato < 0x7F) {
+        txLinea[txLargo++] = (char)dato;
+        txLinea[txLargo] = '\0';
+    } else {
+        txLargo += (size_t)snprintf(txLinea + txLargo, sizeof txLinea - txLargo, "<%02X>", dato);
+    }
+    if (txLargo > sizeof txLinea - 8) {
+        VaciaLineaTx();
+    }
+}
+
+static void CargaTxreg(void)
+{
+    if (!txPendiente) {
+        return;
+    }
+    txPendiente = 0;
+    if (txRegLleno) {
+        txPisados++;                    // Se escribio TXREG sin esperar TXIF.
+    }
+    txRegDato = txregEscrito;
+    txRegLleno = 1;
+    PIR1bits.TX = 0;
+}
+
+//Flancos de subida de la trama (inicio en 0, 8 bits LSB primero, parada en 1) y del reposo
+//en 1 que sigue: con 0x55 del primero (bit 0) al quinto (parada) hay 8 bits
+static void AutoBaud(unsigned char dato)
+{
+    int nivel[11], flancos = 0, primero = 0, quinto = 10, i;
+    unsigned long cuenta, maximo;
+
+    nivel[0] = 0;
+    for (i = 0; i < 8; i++) {
+        nivel[i + 1] = (dato >> i) & 1;
+    }
+    nivel[9] = 1;
+    nivel[10] = 1;
+    for (i = 1; i < 10 && flancos < 5; i++) {
+        if (nivel[i] && !nivel[i - 1]) {
+            if (++flancos == 1) {
+                primero = i;
+            }
+            quinto = i;
+        }
+    }
+    if (dato != 0x55) {
+        abdSinU++;                      // El conteo no corresponde a 8 bits.
+    }
+    cuenta = (unsigned long)((quinto - primero) * fosc / (8.0 * DivisorBrg() * baudTerminal));
+    maximo = BAUDCONbits.BRG16 ? 0xFFFF : 0xFF;
+    if (cuenta > maximo) {
+        BAUDCONbits.ABDOVF = 1;         // ABDEN sigue en 1: el PIC tiene que limpiar ABDOVF y volver a medir.
+        cuenta = maximo;
+    } else {
+        BAUDCONbits.ABDEN = 0;
+        abdMediciones++;
+    }
+    SPBRGH = (unsigned char)(cuenta >> 8);
+    SPBRG = (unsigned char)cuenta;
+    if (rxFifoCuenta < 2) {
+        rxFifo[rxFifoCuenta] = 0x00;    // Leer RCREG solo limpia RCIF.
+        rxFifoFerr[rxFifoCuenta] = 0;
+        rxFifoCuenta++;
+    }
+    if (!silencioso) {
+        printf("[%10.3f ms] AUTOBAUD 0x%02X: SPBRGH:SPBRG = %lu (%.0f baudios)%s\n", Milisegundos(ahoraPs),
+               dato, cuenta, BaudiosPic(), BAUDCONbits.ABDOVF ? ", ABDOVF" : "");
+    }
+}
+
+static void RecibeByteRx(unsigned char dato)
+{
+    int errorTrama = ErrorTrama();
+    int finLinea = dato == '\r' || dato == '\n';
+
+    if (rxLineaParada && finLinea && !errorTrama) {
+        PideParada("serial P\\r");      // Aunque el byte se pierda: entonces la parada nunca llega.
+    }
+    rxLineaParada = rxInicioLinea && !errorTrama && (dato == 'P' || dato == 'p');
+    rxInicioLinea = finLinea;
+    if (!rcsta.SPEN || !rcsta.CREN || durmiendo) {
+        rxPerdidos++;
+        return;
+    }
+    if (rcsta.OERR || rxFifoCuenta == 2) {
+        rcsta.OERR = 1;                 // Con OERR en 1 no se recibe nada hasta limpiar CREN.
+        rxDesbordes++;
+        return;
+    }
+    if (BAUDCONbits.ABDEN) {
+        AutoBaud(dato);
+        return;
+    }
+    if (errorTrama) {
+        rxErrorTrama++;                 // El dato queda como lo mando el terminal: el peor caso, una 'P' que
+    }                                   // parece buena con FERR en 1. El firmware tiene que mirar FERR.
+    rxFifo[rxFifoCuenta] = dato;
+    rxFifoFerr[rxFifoCuenta] = (unsigned char)errorTrama;
+    rxFifoCuenta++;
+    rxBytes++;
+    rcsta.FERR = rxFifoFerr[0];
+}
+
+volatile sim_rcsta_t *sim_rcsta(void)
+{
+    if (!rcsta.CREN) {
+        rcsta.OERR = 0;                 // Igual que en el PIC: CREN=0 borra el desborde.
+    }
+    return &rcsta;
+}
+
+volatile unsigned char *sim_txreg(void)
+{
+    CargaTxreg();                       // Si hubo dos escrituras seguidas, la primera ya queda en TXREG.
+    txPendiente = 1;
+    PIR1bits.TX = 0;
+    return &txregEscrito;
+}
+
+unsigned char sim_lee_rcreg(void)
+{
+    if (rxFifoCuenta > 0) {
+        rxUltimo = rxFifo[0];
+        rxFifo[0] = rxFifo[1];
+        rxFifoFerr[0] = rxFifoFerr[1];
+        rxFifoCuenta--;
+    }
+    rcsta.FERR = rxFifoCuenta ? rxFifoFerr[0] : 0;
+    PIR1bits.RC = rxFifoCuenta > 0;
+    return rxUltimo;
+}
+
+// ============================== EEPROM DE DATOS ==============================
+
+//Cada acceso a EECON2 mira el valor que se escribio en el acceso anterior: asi se reconoce 0x55 y luego 0xAA
+volatile unsigned char *sim_eecon2(void)
+{
+    if (eeDesbloqueo == 0 && eecon2 == 0x55) {
+        eeDesbloqueo = 1;
+    }
+    eecon2 = 0;
+    return &eecon2;
+}
+
+volatile sim_eecon1_t *sim_eecon1(void)
+{
+    if (eeDesbloqueo == 1 && eecon2 == 0xAA && eecon1.WREN) {
+        eeDesbloqueo = 2;               // El WR=1 que sigue vale aunque despues se baje WREN (se revisa en PasoEeprom).
+    } else if (eeDesbloqueo == 1) {
+        eeDesbloqueo = 0;
+    }
+    eecon2 = 0;
+    return &eecon1;
+}
+
+volatile unsigned char *sim_eedata(void)
+{
+    if (eecon1.RD && !eecon1.EEPGD && !eecon1.CFGS) {
+        eedata = eeprom[EEADR];
+        eecon1.RD = 0;
+    }
+    return &eedata;
+}
+
+static void PasoEeprom(void)
+{
+    if (eeFinPs != 0) {
+        if (ahoraPs >= eeFinPs) {
+            eeFinPs = 0;
+            eeprom[eeDireccion] = eeDato;
+            eeDesgaste[eeDireccion]++;
+            eeEscrituras++;
+            eecon1.WR = 0;
+            PIR2bits.EE = 1;
+        }
+    } else if (eecon1.WR) {
+        if (eeDesbloqueo == 2 && !eecon1.EEPGD && !eecon1.CFGS) {
+            eeDireccion = EEADR;
+            eeDato = eedata;
+            eeFinPs = ahoraPs + SIM_PS_EEPROM;
+        } else {
+            eecon1.WR = 0;              // Sin la secuencia el PIC no escribe.
+            eeSinSecuencia++;
+        }
+        eeDesbloqueo = 0;
+    }
+}
+
+static void CargaEeprom(void)
+{
+    FILE *f;
+
+    memset(eeprom, 0xFF, sizeof eeprom); // EEPROM borrada.
+    if (archivoEeprom != NULL && (f = fopen(archivoEeprom, "rb")) != NULL) {
+        if (fread(eeprom, 1, sizeof eeprom, f) != sizeof eeprom) {
+            memset(eeprom, 0xFF, sizeof eeprom);
+        }
+        fclose(f);
+    }
+}
+
+static void GuardaEeprom(void)
+{
+    FILE *f;
+
+    if (archivoEeprom != NULL && (f = fopen(archivoEeprom, "wb")) != NULL) {
+        fwrite(eeprom, 1, sizeof eeprom, f);
+        fclose(f);
+    }
+}
+
+// ============================== PUERTOS ==============================
+
+static unsigned char ColumnasTeclado(void)
+{
+    unsigned char libres = 0x0F;        // Con pull-up una columna lee 1 si ninguna tecla la baja.
+    int fila;
+
+    for (fila = 0; fila < 4; fila++) {
+        if (!(TRISBbits.valor & (1 << fila)) && !(LATBbits.valor & (1 << fila))) {
+            libres &= (unsigned char)~teclas[fila];
+        }
+    }
+    return (unsigned char)(libres << 4);
+}
+
+//Pines de entrada del puerto del bus: con R/W y E en 1 el HD44780 pone BF en D7 y el contador de
+//direcciones en D6..D0 (en 4 bits, el nibble alto en el primer pulso y el bajo en el segundo, por D7..D4)
+static unsigned char LeeBusLcd(void)
+{
+    unsigned char lcd = 0;
+
+    if (LATCbits.b0 && LATAbits.b5) {
+        lcd = (unsigned char)((ahoraPs < lcdOcupadoHastaPs ? 0x80 : 0x00) | (lcdDireccion & 0x7F));
+        if (lcdModo4 && !lcdLecturaAlta) {
+            lcd = (unsigned char)(lcd << 4);
+        }
+    }
+    return (unsigned char)((lcdLat->valor & ~lcdTris->valor) | (lcd & lcdTris->valor));
+}
+
+unsigned char sim_lee_portb(void)
+{
+    unsigned char filas;
+
+    if (lcdLat == &LATBbits) {
+        return LeeBusLcd();             // LCD_BUS 8: el puerto B es solo del LCD.
+    }
+
+    filas = (LATBbits.valor & ~TRISBbits.valor) | TRISBbits.valor;
+    if (TRISBbits.b0 && !botonParada) {
+        filas &= 0xFE;                  // Boton de parada presionado (RB0 a tierra).
+    }
+    rbLatch = ColumnasTeclado();        // Leer PORTB actualiza la referencia del cambio en RB7..RB4.
+    return (unsigned char)(rbLatch | (filas & 0x0F));
+}
+
+unsigned char sim_lee_portc(void)
+{
+    unsigned char valor = LATCbits.valor & ~TRISCbits.valor;
+
+    if (TRISCbits.b1) {
+        valor |= (unsigned char)(sensorNivel << 1);
+    }
+    return valor;
+}
+
+unsigned char sim_lee_portd(void)
+{
+    if (lcdLat == &LATDbits) {
+        return LeeBusLcd();
+    }
+    return LATDbits.valor & ~TRISDbits.valor;
+}
+
+// ============================== PERIFERICOS POR CICLO ==============================
+
+static void PasoCaptura(void)
+{
+//CCP2 en RC1: copia el timer asignado por T3CCP2:T3CCP1 a CCPR2 en el flanco configurado
+    unsigned char modo = CCP2CON & 0x0F;
+    int captura = 0;
+
+    if (sensorNivel == sensorAnterior) {
+        return;
+    }
+    sensorAnterior = sensorNivel;
+    if (!sensorNivel) {
+        flancosBajada++;
+    }
+    if (durmiendo || !TRISCbits.b1) {
+        return;
+    }
+    if (modo == 0x04) {
+        captura = !sensorNivel;
+    } else if (modo == 0x05) {
+        captura = sensorNivel;
+    } else if ((modo == 0x06 || modo == 0x07) && sensorNivel) {
+        ccp2Prescaler++;
+        captura = ccp2Prescaler >= (modo == 0x06 ? 4 : 16);
+        if (captura) {
+            ccp2Prescaler = 0;
+        }
+    }
+    if (!captura) {
+        return;
+    }
+    CCPR2 = (T3CONbits.T1RUN_T3CCP2 || T3CONbits.T1OSCEN_T3CCP1) ? TMR3 : TMR1;
+    if (PIR2bits.CCP2) {
+        capturasPisadas++;              // La ISR no leyo la captura anterior: esa pieza se pierde.
+    }
+    PIR2bits.CCP2 = 1;
+}
+
+static void Desborda(int timer, volatile unsigned char *registro, unsigned char mascara)
+{
+    if (*registro & mascara) {
+        desbordesPerdidos[timer]++;     // La ISR no alcanzo a atender el desborde anterior.
+    }
+    *registro |= mascara;
+}
+
+static void PasoTimers(void)
+{
+    unsigned char prescaler;
+
+    if (T0CONbits.TMR0ON && !T0CONbits.T0CS) {
+        prescaler = T0CONbits.PSA ? 1 : (unsigned char)(2 << T0CONbits.T0PS);
+        if (++pre0 >= prescaler) {
+            pre0 = 0;
+            if (T0CONbits.T08BIT) {
+                TMR0 = (unsigned short)((TMR0 & 0xFF00) | ((TMR0 + 1) & 0x00FF));
+                if ((TMR0 & 0x00FF) == 0) {
+                    Desborda(0, &INTCONbits.valor, 0x04);
+                }
+            } else if (++TMR0 == 0) {
+                Desborda(0, &INTCONbits.valor, 0x04);
+            }
+        }
+    }
+    if (T1CONbits.TMRON && !T1CONbits.TMRCS) {
+        if (++pre1 >= (1 << T1CONbits.TCKPS)) {
+            pre1 = 0;
+            if (++TMR1 == 0) {
+                Desborda(1, &PIR1bits.valor, 0x01);
+            }
+        }
+    }
+    if (T2CONbits.TMR2ON) {
+        prescaler = T2CONbits.T2CKPS == 0 ? 1 : (T2CONbits.T2CKPS == 1 ? 4 : 16);
+        if (++pre2 >= prescaler) {
+            pre2 = 0;
+            if (TMR2 == PR2) {
+                TMR2 = 0;
+                pwmDuty = (unsigned short)(((unsigned int)CCPR1L << 2) | ((CCP1CON >> 4) & 0x03)); // CCPR1L pasa a CCPR1H.
+                if (++post2 > T2CONbits.T2OUTPS) {
+                    post2 = 0;
+                    Desborda(2, &PIR1bits.valor, 0x02);
+                }
+            } else {
+                TMR2++;
+            }
+        }
+    }
+    if (T3CONbits.TMRON && !T3CONbits.TMRCS) {
+        if (++pre3 >= (1 << T3CONbits.TCKPS)) {
+            pre3 = 0;
+            if (++TMR3 == 0) {
+                Desborda(3, &PIR2bits.valor, 0x02);
+            }
+        }
+    }
+}
+
+static uint64_t CiclosConversion(void)
+{
+    static const unsigned char multiplicador[8] = { 2, 8, 32, 0, 4, 16, 64, 0 };
+    static const unsigned char adquisicion[8] = { 0, 2, 4, 6, 8, 12, 16, 20 };
+    double tad, total;
+    unsigned char adcs = ADCON2 & 0x07;
+
+    if (multiplicador[adcs] == 0) {
+        tad = 4e-6;                     // Oscilador RC del ADC (tipico).
+    } else {
+        tad = multiplicador[adcs] / fosc;
+    }
+    total = (adquisicion[(ADCON2 >> 3) & 0x07] + 11) * tad;
+    return (uint64_t)(total * fosc / 4.0) + 1;
+}
+
+static void PasoAdc(void)
+{
+    if (adcCiclos > 0) {
+        if (--adcCiclos == 0) {
+            unsigned char canal = ADCON0bits.CHS < 13 ? ADCON0bits.CHS : 0;
+            int valor = adcEntrada[canal];
+            if (adcRuido[canal] > 0) {
+                adcSemilla = adcSemilla * 1103515245u + 12345u;
+                valor += (int)((adcSemilla >> 16) % (2u * adcRuido[canal] + 1)) - adcRuido[canal];
+                valor = valor < 0 ? 0 : valor > 1023 ? 1023 : valor;
+            }
+            ADRES = (unsigned short)valor;
+            ADCON0bits.GO_DONE = 0;
+            PIR1bits.AD = 1;
+        }
+    } else if (ADCON0bits.GO_DONE && ADCON0bits.ADON) {
+        adcCiclos = CiclosConversion();
+    }
+}
+
+static void PasoUart(void)
+{
+    CargaTxreg();
+    if (txTsrCiclos > 0 && --txTsrCiclos == 0) {
+        SaleByteTx(txTsrDato, txTsrError);
+    }
+    if (txTsrCiclos == 0 && txRegLleno && TXSTAbits.TXEN && rcsta.SPEN) {
+        txTsrDato = txRegDato;
+        txRegLleno = 0;
+        txTsrCiclos = CiclosPorByteUart();
+        txTsrError = ErrorTrama() || BAUDCONbits.ABDEN; // Durante el auto-baud SPBRG es el contador de la medicion.
+    }
+    PIR1bits.TX = !txRegLleno;
+    TXSTAbits.TRMT = txTsrCiclos == 0;
+
+    if (rxFinPs != 0 && ahoraPs >= rxFinPs) {
+        rxFinPs = 0;
+        RecibeByteRx(rxCable[rxCableIndice++]);
+    }
+    if (rxFinPs == 0 && rxCableIndice < rxCableLargo) {
+        rxFinPs = ahoraPs + 10000000000000ULL / baudTerminal; // 10 bits por byte.
+        if (durmiendo && BAUDCONbits.WUE) {
+            BAUDCONbits.WUE = 0;        // El flanco del bit de inicio despierta al PIC y deja RCIF en 1.
+            if (rxFifoCuenta < 2) {
+                rxFifo[rxFifoCuenta++] = 0x00; // Byte de relleno: la lectura de RCREG solo limpia RCIF.
+            }
+        }
+    }
+    if (!rcsta.CREN) {
+        rcsta.OERR = 0;
+    }
+    PIR1bits.RC = rxFifoCuenta > 0;
+}
+
+// ============================== GUION ==============================
+
+static void ImprimeLcd(void)
+{
+    char linea1[17], linea2[17];
+
+    LineaLcd(0, linea1);
+    LineaLcd(1, linea2);
+    printf("[%10.3f ms] LCD |%s|\n", Milisegundos(ahoraPs), linea1);
+    printf("[%10.3f ms]     |%s|\n", Milisegundos(ahoraPs), linea2);
+}
+
+//RC2: con CCP1 en PWM el ciclo util del periodo en curso (no se simula cada periodo), si no el latch como 0 o 100 %
+static int MotorPorcentaje(void)
+{
+    if ((CCP1CON & 0x0C) == 0x0C && T2CONbits.TMR2ON) {
+        unsigned int periodo = 4u * (PR2 + 1u);
+        return pwmDuty >= periodo ? 100 : (int)(pwmDuty * 100u / periodo);
+    }
+    return LATCbits.b2 ? 100 : 0;
+}
+
+static void ImprimeEstado(void)
+{
+    printf("[%10.3f ms] ESTADO motor=%d%% rgb=%d%d%d 7seg=%d led=%d buzzer=%d luz=%d\n",
+           Milisegundos(ahoraPs), MotorPorcentaje(), LATEbits.b2, LATEbits.b1, LATEbits.b0,
+           LATDbits.valor & 0x0F, LATAbits.b1, LATAbits.b2, LATAbits.b3);
+}
+
+static void Verifica(const Evento *ev)
+{
+    char *encontrado;
+    size_t resto;
+
+    encontrado = strstr(txVisto, (const char *)ev->datos);
+    if (encontrado == NULL) {
+        printf("[%10.3f ms] FALLA %s:%d: el PIC no transmitio \"%s\"\n", Milisegundos(ahoraPs), nombreGuion,
+               ev->linea, (const char *)ev->datos);
+        fallasGuion++;
+        return;
+    }
+    if (!silencioso) {
+        printf("[%10.3f ms] VERIFICA \"%s\"\n", Milisegundos(ahoraPs), (const char *)ev->datos);
+    }
+    encontrado += ev->largo;            // El proximo verifica busca despues de este texto.
+    resto = txVistoLargo - (size_t)(encontrado - txVisto);
+    memmove(txVisto, encontrado, resto + 1);
+    txVistoLargo = resto;
+}
+
+static void RevisaPantalla(const Evento *ev)
+{
+    char linea1[17], linea2[17];
+
+    LineaLcd(0, linea1);
+    LineaLcd(1, linea2);
+    if (strstr(linea1, (const char *)ev->datos) == NULL && strstr(linea2, (const char *)ev->datos) == NULL) {
+        printf("[%10.3f ms] FALLA %s:%d: el LCD no muestra \"%s\" (|%s|%s|)\n", Milisegundos(ahoraPs), nombreGuion,
+               ev->linea, (const char *)ev->datos, linea1, linea2);
+        fallasGuion++;
+    } else if (!silencioso) {
+        printf("[%10.3f ms] PANTALLA \"%s\"\n", Milisegundos(ahoraPs), (const char *)ev->datos);
+    }
+}
+
+static unsigned long ValorContador(int contador)
+{
+    switch (contador) {
+    case CONT_FLANCOS:
+        return flancosBajada;
+    case CONT_PISADAS:
+        return capturasPisadas;
+    case CONT_TRAMA:
+        return rxErrorTrama + txErrorTrama;
+    case CONT_OCUPADO:
+        return lcdMientrasOcupado;
+    case CONT_EEPROM:
+        return eeEscrituras;
+    default:
+        return rxPerdidos + rxDesbordes;
+    }
+}
+
+static void RevisaContador(const Evento *ev)
+{
+    unsigned long valor = ValorContador(ev->a);
+
+    if (valor != (unsigned long)ev->b) {
+        printf("[%10.3f ms] FALLA %s:%d: %s = %lu, se esperaba %d\n", Milisegundos(ahoraPs), nombreGuion,
+               ev->linea, nombreContador[ev->a], valor, ev->b);
+        fallasGuion++;
+    } else if (!silencioso) {
+        printf("[%10.3f ms] CONTADOR %s = %lu\n", Milisegundos(ahoraPs), nombreContador[ev->a], valor);
+    }
+}
+
+static void EjecutaEvento(const Evento *ev)
+{
+    switch (ev->tipo) {
+    case EV_TECLA:
+        if (ev->b && ev->a == 7) {
+            PideParada("tecla ESTOP");
+        }
+        if (ev->b) {
+            teclas[ev->a >> 2] |= (unsigned char)(1 << (ev->a & 3));
+        } else {
+            teclas[ev->a >> 2] &= (unsigned char)~(1 << (ev->a & 3));
+        }
+        break;
+    case EV_SENSOR:
+        sensorNivel = (unsigned char)ev->a;
+        break;
+    case EV_SERIAL:
+        if (rxCableLargo + ev->largo <= sizeof rxCable) {
+            memcpy(rxCable + rxCableLargo, ev->datos, ev->largo);
+            rxCableLargo += ev->largo;
+        }
+        break;
+    case EV_ADC:
+        adcEntrada[ev->b] = (unsigned short)(ev->a & 0x3FF);
+        adcRuido[ev->b] = (unsigned short)(ev->a >> 10);
+        break;
+    case EV_PARADA:
+        if (!ev->a) {
+            PideParada("boton RB0/INT0");
+        }
+        botonParada = (unsigned char)ev->a;
+        break;
+    case EV_BAUDIOS:
+        baudTerminal = (unsigned long)ev->a;
+        break;
+    case EV_TENSION:
+        if (HLVDCONbits.HLVDEN && !HLVDCONbits.VDIRMAG) {
+            PIR2bits.HLVD = 1;          // VDD cruzo el nivel de bajada.
+        }
+        break;
+    case EV_VERIFICA:
+        Verifica(ev);
+        break;
+    case EV_PANTALLA:
+        RevisaPantalla(ev);
+        break;
+    case EV_CONTADOR:
+        RevisaContador(ev);
+        break;
+    case EV_LCD:
+        ImprimeLcd();
+        break;
+    case EV_ESTADO:
+        ImprimeEstado();
+        break;
+    case EV_FIN:
+        Termina();
+        break;
+    }
+}
+
+static void PasoEventos(void)
+{
+    while (iEvento < nEventos && eventos[iEvento].ps <= ahoraPs) {
+        EjecutaEvento(&eventos[iEvento++]);
+    }
+}
+
+// ============================== AVANCE DEL TIEMPO ==============================
+
+//Causas que van a ISR_Alta con IPEN=1 (bits IP en 1; INT0 no tiene bit y siempre es de alta)
+static unsigned int CausasPerifericos(void);
+
+static unsigned int CausasAltas(void)
+{
+    unsigned int altas = 1u << CAUSA_INT0;
+
+    if (INTCON2bits.TMR0IP) altas |= 1u << CAUSA_TMR0;
+    if (INTCON2bits.RBIP) altas |= 1u << CAUSA_RB;
+    if (IPR1bits.TX) altas |= 1u << CAUSA_TX;
+    if (IPR1bits.RC) altas |= 1u << CAUSA_RC;
+    if (IPR1bits.TMR1) altas |= 1u << CAUSA_TMR1;
+    if (IPR1bits.TMR2) altas |= 1u << CAUSA_TMR2;
+    if (IPR1bits.CCP1) altas |= 1u << CAUSA_CCP1;
+    if (IPR1bits.AD) altas |= 1u << CAUSA_AD;
+    if (IPR2bits.CCP2) altas |= 1u << CAUSA_CCP2;
+    if (IPR2bits.TMR3) altas |= 1u << CAUSA_TMR3;
+    if (IPR2bits.EE) altas |= 1u << CAUSA_EE;
+    if (IPR2bits.HLVD) altas |= 1u << CAUSA_HLVD;
+    return altas;
+}
+
+//Causas con IE e IF en 1 que pueden interrumpir, sin mirar GIE/GIEH. Con IPEN=0 los perifericos
+//necesitan PEIE; con IPEN=1 ese bit es GIEL y solo detiene las de baja prioridad
+static unsigned int CausasPendientes(void)
+{
+    unsigned int causas = 0;
+
+    if (INTCONbits.INT0IE && INTCONbits.INT0IF) causas |= 1u << CAUSA_INT0;
+    if (INTCONbits.TMR0IE && INTCONbits.TMR0IF) causas |= 1u << CAUSA_TMR0;
+    if (INTCONbits.RBIE && INTCONbits.RBIF) causas |= 1u << CAUSA_RB;
+    if (RCONbits.IPEN) {
+        causas |= CausasPerifericos();
+        return INTCONbits.PEIE ? causas : causas & CausasAltas();
+    }
+    if (!INTCONbits.PEIE) return causas;
+    return causas | CausasPerifericos();
+}
+
+static unsigned int CausasPerifericos(void)
+{
+    unsigned int causas = 0;
+
+    if (PIE1bits.TX && PIR1bits.TX) causas |= 1u << CAUSA_TX;
+    if (PIE1bits.RC && PIR1bits.RC) causas |= 1u << CAUSA_RC;
+    if (PIE1bits.TMR1 && PIR1bits.TMR1) causas |= 1u << CAUSA_TMR1;
+    if (PIE1bits.TMR2 && PIR1bits.TMR2) causas |= 1u << CAUSA_TMR2;
+    if (PIE1bits.CCP1 && PIR1bits.CCP1) causas |= 1u << CAUSA_CCP1;
+    if (PIE1bits.AD && PIR1bits.AD) causas |= 1u << CAUSA_AD;
+    if (PIE2bits.CCP2 && PIR2bits.CCP2) causas |= 1u << CAUSA_CCP2;
+    if (PIE2bits.TMR3 && PIR2bits.TMR3) causas |= 1u << CAUSA_TMR3;
+    if (PIE2bits.EE && PIR2bits.EE) causas |= 1u << CAUSA_EE;
+    if (PIE2bits.HLVD && PIR2bits.HLVD) causas |= 1u << CAUSA_HLVD;
+    return causas;
+}
+
+static void RegistraIsr(unsigned int causas, uint64_t duracion)
+{
+    int i;
+
+    for (i = 0; i < nEstIsr && estIsr[i].causas != causas; i++) {
+    }
+    if (i == nEstIsr) {
+        if (nEstIsr == (int)(sizeof estIsr / sizeof estIsr[0])) {
+            return;
+        }
+        estIsr[nEstIsr++].causas = causas;
+    }
+    estIsr[i].entradas++;
+    estIsr[i].ciclos += duracion;
+    if (duracion > estIsr[i].maximo) {
+        estIsr[i].maximo = duracion;
+    }
+}
+
+static void Paso(void)
+{
+    unsigned char int0;
+
+    ciclo++;
+    ahoraPs += psCiclo;
+    if (!durmiendo) {
+        PasoTimers();
+        PasoAdc();
+    }
+    PasoUart();
+    PasoCaptura();
+    PasoEeprom();
+    HLVDCONbits.IRVST = HLVDCONbits.HLVDEN; // La referencia del HLVD se estabiliza de una vez.
+    if ((ColumnasTeclado() & 0xF0) != rbLatch) {
+        INTCONbits.RBIF = 1;
+    }
+    int0 = TRISBbits.b0 ? botonParada : LATBbits.b0;
+    if (int0 != int0Anterior) {
+        int0Anterior = int0;
+        if (int0 == INTCON2bits.INTEDG0) {
+            INTCONbits.INT0IF = 1;      // Flanco del lado que pide INTEDG0 (tambien en Sleep).
+        }
+    }
+    PasoEventos();
+    RevisaParada();
+}
+
+static void Avanza(uint64_t ciclos);
+
+static uint64_t CiclosCausas(unsigned int causas)
+{
+    static unsigned long conversiones;
+    uint64_t ciclos = 0;
+    int i;
+
+    for (i = 0; i < CAUSAS; i++) {
+        if (causas & (1u << i)) {
+            ciclos += ciclosCausa[i];
+        }
+    }
+    if ((causas & (1u << CAUSA_AD)) && ++conversiones % SIM_ADC_DECIMA == 0) {
+        ciclos += SIM_CICLOS_ADC_DECIMA - ciclosCausa[CAUSA_AD];
+    }
+    return ciclos;
+}
+
+static void Despacha(void)
+{
+//Entra a la ISR mientras haya una causa habilitada pendiente, como el PIC al salir con RETFIE
+//Con IPEN=1 una causa de alta prioridad entra tambien en medio de ISR (no en medio de ISR_Alta)
+    unsigned int causas, altas;
+    uint64_t inicio;
+    int anterior;
+
+    while (INTCONbits.GIE && (causas = CausasPendientes()) != 0) {
+        altas = RCONbits.IPEN ? causas & CausasAltas() : 0;
+        inicio = ciclo;
+        anterior = enIsr;
+        if (altas != 0 && enIsr != ISR_ALTA) {
+            enIsr = ISR_ALTA;
+            Avanza(SIM_CICLOS_ISR_ALTA / 2);
+            ISR_Alta();
+            CargaTxreg();
+            Avanza(CiclosCausas(altas) + SIM_CICLOS_ISR_ALTA - SIM_CICLOS_ISR_ALTA / 2);
+            RegistraIsr(altas | SIM_ALTA, ciclo - inicio);
+        } else if (altas == 0 && enIsr == ISR_NINGUNA) {
+            enIsr = ISR_BAJA;
+            Avanza(SIM_CICLOS_ISR / 2);
+            ISR();
+            CargaTxreg();
+            Avanza(CiclosCausas(causas) + SIM_CICLOS_ISR - SIM_CICLOS_ISR / 2);
+            RegistraIsr(causas, ciclo - inicio);
+        } else {
+            break;                      // Ya esta dentro de la ISR que le tocaria.
+        }
+        enIsr = anterior;
+        ObservaLcd();
+    }
+}
+
+static void Avanza(uint64_t ciclos)
+{
+    ObservaLcd();
+    CargaTxreg();
+    Despacha();
+    while (ciclos > 0) {
+        Paso();
+        Despacha();
+        ciclos--;
+    }
+}
+
+void sim_lcd_puerto(char puerto)
+{
+    lcdLat = puerto == 'B' ? &LATBbits : &LATDbits;
+    lcdTris = puerto == 'B' ? &TRISBbits : &TRISDbits;
+}
+
+void sim_reloj(double frecuencia)
+{
+    if (frecuencia != fosc) {
+        fosc = frecuencia;
+        psCiclo = (uint64_t)(4e12 / fosc + 0.5);
+    }
+}
+
+void sim_retardo_us(double us, double frecuencia)
+{
+    sim_reloj(frecuencia);
+    Avanza((uint64_t)(us * fosc / 4e6 + 0.5));
+}
+
+void sim_ciclos(unsigned long ciclos)
+{
+    Avanza(ciclos);
+}
+
+void sim_espera(void)
+{
+    Avanza(SIM_CICLOS_ESPERA);
+}
+
+void sim_duerme(void)
+{
+//SLEEP: se detienen los timers con reloj interno, el ADC y el UART.
+//Despierta una interrupcion habilitada que no necesite el reloj (teclado, INTx, WUE)
+//Con IDLEN=1 es modo IDLE: solo se detiene la CPU y despierta cualquier interrupcion
+//habilitada, aunque GIE este en 0 (en ese caso sigue sin entrar a la ISR)
+    uint64_t inicio;
+
+    if (OSCCONbits.IDLEN) {
+        vecesIdle++;
+        ObservaLcd();
+        inicio = ciclo;
+        RCONbits.PD = 0;
+        while (CausasPendientes() == 0) {
+            Paso();
+        }
+        RCONbits.PD = 1;
+        ciclosIdle += ciclo - inicio;
+        Avanza(1);
+        return;
+    }
+    vecesDormido++;
+    ObservaLcd();
+    durmiendo = 1;
+    RCONbits.PD = 0;
+    while (!((INTCONbits.RBIE && INTCONbits.RBIF) || (INTCONbits.INT0IE && INTCONbits.INT0IF) ||
+             (INTCONbits.PEIE && PIE1bits.RC && rxFifoCuenta > 0))) {
+        Paso();
+    }
+    durmiendo = 0;
+    RCONbits.PD = 1;
+    Avanza(2);                          // Arranque del oscilador interno (aprox.).
+}
+
+// ============================== CARGA DEL GUION ==============================
+
+static Evento *NuevoEvento(uint64_t ps, int tipo, int a, int b)
+{
+    Evento *ev;
+
+    if (nEventos == capEventos) {
+        capEventos = capEventos ? capEventos * 2 : 64;
+        eventos = realloc(eventos, capEventos * sizeof *eventos);
+        if (eventos == NULL) {
+            fprintf(stderr, "lab5-sim: sin memoria\n");
+            exit(2);
+        }
+    }
+    ev = &eventos[nEventos++];
+    memset(ev, 0, sizeof *ev);
+    ev->ps = ps;
+    ev->tipo = tipo;
+    ev->a = a;
+    ev->b = b;
+    return ev;
+}
+
+static int IndiceTecla(const char *nombre)
+{
+    static const char *matriz[16] = {   // Fila por fila, columnas RB4..RB7.
+        "1", "2", "3", "OK",
+        "4", "5", "6", "ESTOP",
+        "7", "8", "9", "SUPR",
+        "REINICIO", "0", "FIN", "LUZ"
+    };
+    int i;
+
+    if (strcmp(nombre, "*") == 0) {
+        return 3;
+    }
+    for (i = 0; i < 16; i++) {
+        if (strcasecmp(nombre, matriz[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static size_t Desescapa(const char *texto, unsigned char *salida)
+{
+    size_t n = 0;
+    unsigned int hex;
+
+    while (*texto != '\0' && *texto != '\n') {
+        if (texto[0] == '\\' && texto[1] != '\0') {
+            texto++;
+            if (*texto == 'r') {
+                salida[n++] = '\r';
+            } else if (*texto == 'n') {
+                salida[n++] = '\n';
+            } else if (*texto == 'x' && sscanf(texto + 1, "%2x", &hex) == 1) {
+                salida[n++] = (unsigned char)hex;
+                texto += 2;
+            } else {
+                salida[n++] = (unsigned char)*texto;
+            }
+            texto++;
+        } else {
+            salida[n++] = (unsigned char)*texto++;
+        }
+    }
+    return n;
+}
+
+static int IndiceContador(const char *nombre)
+{
+    int i;
+
+    for (i = 0; i < CONTADORES; i++) {
+        if (strcmp(nombre, nombreContador[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void CargaGuion(FILE *archivo, const char *nombre)
+{
+    char linea[512], orden[32], argumento[32];
+    double ms, periodo, rebote, instante = 0.0;
+    int numeroLinea = 0, valor, extra, ruido, leidos, tecla, i;
+    unsigned char bytes[512];
+    Evento *ev;
+
+    while (fgets(linea, sizeof linea, archivo) != NULL) {
+        numeroLinea++;
+        char *comentario = strchr(linea, '#');
+        if (comentario != NULL && strncmp(linea, "serial", 6) != 0) {
+            *comentario = '\0';
+        }
+        if (sscanf(linea, "%31s", orden) != 1) {
+            continue;
+        }
+        uint64_t ps = (uint64_t)(instante * 1e9);
+
+        if (strcmp(orden, "espera") == 0 && sscanf(linea, "%*s %lf", &ms) == 1) {
+            instante += ms;
+        } else if (strcmp(orden, "tecla") == 0 && sscanf(linea, "%*s %31s", argumento) == 1 &&
+                   (tecla = IndiceTecla(argumento)) >= 0) {
+            ms = 100.0;
+            sscanf(linea, "%*s %*s %lf", &ms);
+            NuevoEvento(ps, EV_TECLA, tecla, 1);
+            instante += ms;
+            NuevoEvento((uint64_t)(instante * 1e9), EV_TECLA, tecla, 0);
+        } else if (strcmp(orden, "parada") == 0) {
+            ms = 100.0;
+            sscanf(linea, "%*s %lf", &ms);
+            NuevoEvento(ps, EV_PARADA, 0, 0);
+            instante += ms;
+            NuevoEvento((uint64_t)(instante * 1e9), EV_PARADA, 1, 0);
+        } else if (strcmp(orden, "pieza") == 0) {
+            ms = 50.0;
+            extra = 0;
+            sscanf(linea, "%*s %lf %d", &ms, &extra);
+            for (i = 0; i < extra; i++) { // Rebotes: 1 ms abajo, 1 ms arriba.
+                NuevoEvento((uint64_t)(instante * 1e9), EV_SENSOR, 0, 0);
+                NuevoEvento((uint64_t)((instante + 1.0) * 1e9), EV_SENSOR, 1, 0);
+                instante += 2.0;
+            }
+            NuevoEvento((uint64_t)(instante * 1e9), EV_SENSOR, 0, 0);
+            instante += ms;
+            NuevoEvento((uint64_t)(instante * 1e9), EV_SENSOR, 1, 0);
+        } else if (strcmp(orden, "tren") == 0 && sscanf(linea, "%*s %d %lf", &valor, &periodo) == 2 &&
+                   valor > 0 && periodo > 0.0) {
+            ms = periodo / 2.0;
+            extra = 0;
+            rebote = 0.2;
+            sscanf(linea, "%*s %*d %*f %lf %d %lf", &ms, &extra, &rebote);
+            for (; valor > 0; valor--) {
+                double inicio = instante;
+                for (i = 0; i < extra; i++) {
+                    NuevoEvento((uint64_t)(instante * 1e9), EV_SENSOR, 0, 0);
+                    NuevoEvento((uint64_t)((instante + rebote / 2.0) * 1e9), EV_SENSOR, 1, 0);
+                    instante += rebote;
+                }
+                NuevoEvento((uint64_t)(instante * 1e9), EV_SENSOR, 0, 0);
+                NuevoEvento((uint64_t)((instante + ms) * 1e9), EV_SENSOR, 1, 0);
+                instante = inicio + periodo;
+            }
+        } else if (strcmp(orden, "serial") == 0) {
+            char *texto = linea + 6;
+            while (*texto == ' ' || *texto == '\t') {
+                texto++;
+            }
+            size_t largo = Desescapa(texto, bytes);
+            ev = NuevoEvento(ps, EV_SERIAL, 0, 0);
+            ev->datos = malloc(largo ? largo : 1);
+            memcpy(ev->datos, bytes, largo);
+            ev->largo = largo;
+        } else if (strcmp(orden, "adc") == 0 && (leidos = sscanf(linea, "%*s %d %d %d", &valor, &extra, &ruido)) >= 1) {
+            if (leidos < 2 || extra < 0 || extra > 12) {
+                extra = 0;
+            }
+            if (leidos < 3 || ruido < 0 || ruido > 1023) {
+                ruido = 0;
+            }
+            NuevoEvento(ps, EV_ADC, (valor & 0x3FF) | (ruido << 10), extra);
+        } else if (strcmp(orden, "baudios") == 0 && sscanf(linea, "%*s %d", &valor) == 1 && valor > 0) {
+            NuevoEvento(ps, EV_BAUDIOS, valor, 0);
+        } else if (strcmp(orden, "tension") == 0) {
+            NuevoEvento(ps, EV_TENSION, 0, 0);
+        } else if (strcmp(orden, "verifica") == 0 || strcmp(orden, "pantalla") == 0) {
+            char *texto = linea + strlen(orden);
+            while (*texto == ' ' || *texto == '\t') {
+                texto++;
+            }
+            size_t largo = Desescapa(texto, bytes);
+            while (largo > 0 && (bytes[largo - 1] == ' ' || bytes[largo - 1] == '\t' || bytes[largo - 1] == '\r')) {
+                largo--;
+            }
+            if (largo == 0) {
+                fprintf(stderr, "%s:%d: %s sin texto\n", nombre, numeroLinea, orden);
+                exit(2);
+            }
+            ev = NuevoEvento(ps, strcmp(orden, "verifica") == 0 ? EV_VERIFICA : EV_PANTALLA, 0, 0);
+            ev->datos = malloc(largo + 1);
+            memcpy(ev->datos, bytes, largo);
+            ev->datos[largo] = '\0';
+            ev->largo = largo;
+            ev->linea = numeroLinea;
+        } else if (strcmp(orden, "contador") == 0 && sscanf(linea, "%*s %31s %d", argumento, &valor) == 2 &&
+                   (tecla = IndiceContador(argumento)) >= 0 && valor >= 0) {
+            ev = NuevoEvento(ps, EV_CONTADOR, tecla, valor);
+            ev->linea = numeroLinea;
+        } else if (strcmp(orden, "lcd") == 0) {
+            NuevoEvento(ps, EV_LCD, 0, 0);
+        } else if (strcmp(orden, "estado") == 0) {
+            NuevoEvento(ps, EV_ESTADO, 0, 0);
+        } else {
+            fprintf(stderr, "%s:%d: orden no valida: %s", nombre, numeroLinea, linea);
+            exit(2);
+        }
+    }
+    NuevoEvento((uint64_t)(instante * 1e9), EV_FIN, 0, 0);
+}
+
+// ============================== RESUMEN ==============================
+
+//Nombre de una fila de la tabla de ISR: causas separadas por +, con alta: si entro a ISR_Alta
+static void NombreFila(const EstadisticaIsr *fila, char *nombre)
+{
+    int c;
+
+    strcpy(nombre, fila->causas & SIM_ALTA ? "alta:" : "");
+    for (c = 0; c < CAUSAS; c++) {
+        if (fila->causas & (1u << c)) {
+            if (nombre[0] != '\0' && strcmp(nombre, "alta:") != 0) {
+                strcat(nombre, "+");
+            }
+            strcat(nombre, nombreCausa[c]);
+        }
+    }
+}
+
+//-c: el maximo de cada fila no puede pasar el de la base (una combinacion nueva solo se avisa)
+//-g: reescribe la base con esta corrida
+static int RevisaBase(void)
+{
+    char linea[160], nombre[64], clave[64];
+    unsigned long entradas, ciclos, maximo;
+    int i, fallas = 0, encontrada;
+    FILE *f;
+
+    if (generaBase) {
+        f = fopen(archivoBase, "w");
+        if (f == NULL) {
+            perror(archivoBase);
+            return 1;
+        }
+        fprintf(f, "# lab5-sim -c: causas entradas ciclos maximo (se actualiza con -g)\n");
+        for (i = 0; i < nEstIsr; i++) {
+            NombreFila(&estIsr[i], nombre);
+            fprintf(f, "%s %lu %llu %llu\n", nombre, estIsr[i].entradas, (unsigned long long)estIsr[i].ciclos,
+                    (unsigned long long)estIsr[i].maximo);
+        }
+        fclose(f);
+        printf("Base de ciclos escrita en %s\n", archivoBase);
+        return 0;
+    }
+    f = fopen(archivoBase, "r");
+    if (f == NULL) {
+        perror(archivoBase);
+        return 1;
+    }
+    for (i = 0; i < nEstIsr; i++) {
+        NombreFila(&estIsr[i], nombre);
+        rewind(f);
+        encontrada = 0;
+        while (fgets(linea, sizeof linea, f) != NULL) {
+            if (sscanf(linea, "%63s %lu %lu %lu", clave, &entradas, &ciclos, &maximo) == 4 &&
+                strcmp(clave, nombre) == 0) {
+                encontrada = 1;
+                break;
+            }
+        }
+        if (!encontrada) {
+            printf("  %-22s sin base (actualice con -g)\n", nombre);
+        } else if (estIsr[i].maximo > maximo) {
+            printf("  %-22s FALLA: maximo %llu ciclos, base %lu\n", nombre, (unsigned long long)estIsr[i].maximo, maximo);
+            fallas++;
+        } else if (estIsr[i].maximo < maximo) {
+            printf("  %-22s mejor: maximo %llu ciclos, base %lu (actualice con -g)\n", nombre,
+                   (unsigned long long)estIsr[i].maximo, maximo);
+        }
+    }
+    fclose(f);
+    return fallas;
+}
+
+static void Termina(void)
+{
+    char linea1[17], linea2[17], nombre[64];
+    int i, c;
+
+    VaciaLineaTx();
+    printf("\n== Resumen: %.3f ms simulados, %llu ciclos de instruccion, Fosc = %.0f Hz ==\n",
+           Milisegundos(ahoraPs), (unsigned long long)ciclo, fosc);
+    printf("ISR (causas al entrar)   entradas      ciclos    maximo    max_us\n");
+    for (i = 0; i < nEstIsr; i++) {
+        NombreFila(&estIsr[i], nombre);
+        printf("  %-22s %8lu %11llu %9llu %9.0f\n", nombre, estIsr[i].entradas,
+               (unsigned long long)estIsr[i].ciclos, (unsigned long long)estIsr[i].maximo,
+               MicrosDeCiclos(estIsr[i].maximo));
+    }
+    printf("Desbordes perdidos: TMR0 %lu  TMR1 %lu  TMR2 %lu  TMR3 %lu\n",
+           desbordesPerdidos[0], desbordesPerdidos[1], desbordesPerdidos[2], desbordesPerdidos[3]);
+    printf("UART: TX %lu bytes (%lu pisados), RX %lu bytes, %lu OERR, %lu perdidos, %lu con error de trama (PIC a %.0f baudios)\n",
+           txBytes, txPisados, rxBytes, rxDesbordes, rxPerdidos, rxErrorTrama, BaudiosPic());
+    if (txErrorTrama > 0 || abdMediciones > 0 || abdSinU > 0) {
+        printf("UART: %lu bytes TX con error de trama, auto-baud: %lu mediciones (%lu sin 0x55), terminal a %lu baudios\n",
+               txErrorTrama, abdMediciones, abdSinU, baudTerminal);
+    }
+    printf("Sensor: %lu flancos de bajada en RC1, %lu capturas pisadas (CCP2IF todavia en 1)\n",
+           flancosBajada, capturasPisadas);
+    printf("LCD: %lu instrucciones, %lu datos, %lu pulsos con el LCD ocupado",
+           lcdInstrucciones, lcdDatos, lcdMientrasOcupado);
+    if (lcdLecturas > 0) {
+        printf(", %lu lecturas de BF", lcdLecturas);
+    }
+    printf("\n");
+    printf("Sleep: %lu veces%s\n", vecesDormido, durmiendo ? " (termino dormido)" : "");
+    if (paradaFuente != NULL && paradaFinPs != 0) {
+        printf("Parada: %s, salidas seguras en %.0f us\n", paradaFuente, (double)(paradaFinPs - paradaInicioPs) / 1e6);
+    } else if (paradaFuente != NULL) {
+        printf("Parada: %s, las salidas nunca quedaron seguras\n", paradaFuente);
+    }
+    printf("IDLE: %lu veces, %.1f %% del tiempo\n", vecesIdle, ciclo ? 100.0 * (double)ciclosIdle / (double)ciclo : 0.0);
+    for (i = 0, c = 0; i < 256; i++) {
+        if (eeDesgaste[i] > eeDesgaste[c]) {
+            c = i;
+        }
+    }
+    printf("EEPROM: %lu bytes escritos (maximo %lu en 0x%02X), %lu WR sin secuencia%s\n", eeEscrituras,
+           eeDesgaste[c], c, eeSinSecuencia, eeFinPs != 0 ? ", termino a media escritura" : "");
+    GuardaEeprom();
+    LineaLcd(0, linea1);
+    LineaLcd(1, linea2);
+    printf("Pantalla final |%s|\n               |%s|\n", linea1, linea2);
+    if (salidaTx != NULL) {
+        fclose(salidaTx);
+    }
+    fflush(stdout);
+    if (paradaLimiteUs > 0.0 && (paradaFinPs == 0 ||
+                                 (double)(paradaFinPs - paradaInicioPs) / 1e6 > paradaLimiteUs)) {
+        printf("FALLA: la parada pasa de %.0f us\n", paradaLimiteUs);
+        exit(1);
+    }
+    if (tramaEstricta && (rxErrorTrama > 0 || txErrorTrama > 0 || abdSinU > 0 || BAUDCONbits.ABDEN)) {
+        printf("FALLA: errores de trama en el UART o auto-baud sin terminar\n");
+        exit(1);
+    }
+    if (fallasGuion > 0) {
+        printf("FALLA: %d verificaciones del guion no se cumplieron\n", fallasGuion);
+        exit(1);
+    }
+    if (archivoBase != NULL && RevisaBase() > 0) {
+        printf("FALLA: la tabla de ISR empeora respecto a %s\n", archivoBase);
+        exit(1);
+    }
+    exit(0);
+}
+
+// ============================== ARRANQUE ==============================
+
+static void ResetPor(int usuario, int caida)
+{
+    int i;
+
+    TRISAbits.valor = 0xFF;
+    TRISBbits.valor = 0xFF;
+    TRISCbits.valor = 0xFF;
+    TRISDbits.valor = 0xFF;
+    TRISEbits.valor = 0x07;
+    INTCON2bits.valor = 0xF5;
+    INTCON3bits.valor = 0xC0;
+    IPR1bits.valor = 0xFF;              // Despues del reset todas las prioridades son altas (con IPEN=0 no importa).
+    IPR2bits.valor = 0xFF;
+    T0CONbits.valor = 0xFF;             // Reloj externo T0CKI: no cuenta hasta que el programa configura Timer0.
+    RCONbits.valor = 0x1C;              // POR=0 y BOR=0 despues de energizar.
+    if (usuario) {
+        RCONbits.POR = 1;
+        RCONbits.BOR = 1;
+    } else if (caida) {
+        RCONbits.POR = 1;               // Caida de tension: solo BOR queda en 0.
+    }
+    TXSTAbits.valor = 0x02;
+    for (i = 0; i < 80; i++) {
+        lcdDdram[i] = ' ';
+    }
+}
+
+static void Uso(void)
+{
+    fprintf(stderr, "uso: lab5-sim [-u|-d] [-q] [-b baudios] [-o salida.bin] [-e eeprom.bin] [-p us] [-t] [-c base.txt [-g]] [guion|-]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *guion;
+    int i, usuario = 0, caida = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-u") == 0) {
+            usuario = 1;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            caida = 1;
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            archivoEeprom = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0) {
+            silencioso = 1;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baudTerminal = strtoul(argv[++i], NULL, 10);
+            if (baudTerminal == 0) {
+                Uso();
+            }
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            paradaLimiteUs = strtod(argv[++i], NULL);
+            if (paradaLimiteUs <= 0.0) {
+                Uso();
+            }
+        } else if (strcmp(argv[i], "-t") == 0) {
+            tramaEstricta = 1;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            archivoBase = argv[++i];
+        } else if (strcmp(argv[i], "-g") == 0) {
+            generaBase = 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            salidaTx = fopen(argv[++i], "wb");
+            if (salidaTx == NULL) {
+                perror(argv[i]);
+                return 2;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            Uso();
+        } else {
+            nombreGuion = argv[i];
+        }
+    }
+
+    if (generaBase && archivoBase == NULL) {
+        Uso();
+    }
+    guion = strcmp(nombreGuion, "-") == 0 ? stdin : fopen(nombreGuion, "r");
+    if (guion == NULL) {
+        perror(nombreGuion);
+        return 2;
+    }
+    CargaGuion(guion, nombreGuion);
+    if (guion != stdin) {
+        fclose(guion);
+    }
+
+    ResetPor(usuario, caida);
+    CargaEeprom();
+    PasoEventos();
+    Lab5_Main();
+    Termina();                          // main de Lab5 no retorna, pero por si acaso.
+    return 0;
+}
@@ -0,0 +1,244 @@
+/*
+ * File:   uart-tx.c
+ *
+ * Prueba del buffer de transmision de LibUARTXC8.h (make uart). Compila la
+ * libreria con gcc contra host/xc.h, con TXREG, TXIE y TXIF como memoria, y
+ * hace de ISR: llama a UART_ServicioTx() cada vez que TXIE y TXIF estan en 1,
+ * como la rama TXIF de Lab5.c.
+ *
+ *   uart-tx
+ *
+ * Casos (sale con 1 si alguno falla):
+ *
+ *   lleno     encola 100 bytes sin vaciar: caben UART_TX_TAM - 1, los demas
+ *             cuentan en uartTxDescartados, UART_EncolaTx retorna 0 y
+ *             UART_LibreTx queda en 0. Vaciar da los que cupieron en orden,
+ *             uartTxEnviados igual a ellos y TXIE en 0.
+ *   vuelta    encola y vacia en tandas de 1 a UART_TX_TAM - 1 bytes hasta
+ *             dar muchas vueltas a los indices: sin descartes y en orden.
+ *   texto     UART_Texto, UART_Numero y UART_Numero32 dejan los digitos
+ *             esperados.
+ *   tasa      un segundo a UART_BAUDIOS con un productor que ofrece mas de lo
+ *             que sale por el cable (30 bytes cada 10 ms): el transmisor no
+ *             puede quedar libre con bytes en cola (enviados dentro de 1 byte
+ *             de baudios / 10), lo encolado es enviado + pendiente, lo
+ *             ofrecido es encolado + descartado y el cable los saca en orden.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../LibUARTXC8.h"
+
+// Registros que usa la libreria: aqui no hay PIC, solo memoria.
+volatile sim_pir1_t PIR1bits, PIE1bits;
+volatile sim_txsta_t TXSTAbits;
+volatile sim_baudcon_t BAUDCONbits;
+volatile unsigned char SPBRG, SPBRGH;
+static volatile sim_rcsta_t rcsta;
+static volatile unsigned char txreg;
+
+volatile sim_rcsta_t *sim_rcsta(void)
+{
+    return &rcsta;
+}
+
+volatile unsigned char *sim_txreg(void)
+{
+    return &txreg;
+}
+
+unsigned char sim_lee_rcreg(void)
+{
+    return 0;
+}
+
+#define MAXIMO 8192
+
+static int fallas;
+static unsigned char salida[MAXIMO];    // Lo que la ISR paso a TXREG, en orden.
+static size_t nSalida;
+
+static void Falla(const char *caso, const char *texto, unsigned long obtenido, unsigned long esperado)
+{
+    printf("  FALLA %s: %s = %lu, se esperaba %lu\n", caso, texto, obtenido, esperado);
+    fallas++;
+}
+
+//La rama TXIF de la ISR: un byte por entrada; TXIF siempre en 1 (TXREG libre al instante)
+static void VaciaTodo(void)
+{
+    unsigned int antes;
+
+    TXIF = 1;
+    while (TXIE == 1 && TXIF == 1) {
+        antes = uartTxEnviados;
+        UART_ServicioTx();
+        if (uartTxEnviados != antes && nSalida < MAXIMO) {
+            salida[nSalida++] = txreg;
+        }
+    }
+}
+
+static void CasoLleno(void)
+{
+    unsigned char aceptados = 0;
+    int i;
+
+    UART_IniciaTx();
+    nSalida = 0;
+    for (i = 0; i < 100; i++) {
+        aceptados += UART_EncolaTx((unsigned char)i);
+    }
+    if (aceptados != UART_TX_TAM - 1) {
+        Falla("lleno", "aceptados", aceptados, UART_TX_TAM - 1);
+    }
+    if (uartTxDescartados != 100 - (UART_TX_TAM - 1)) {
+        Falla("lleno", "uartTxDescartados", uartTxDescartados, 100 - (UART_TX_TAM - 1));
+    }
+    if (UART_LibreTx() != 0) {
+        Falla("lleno", "UART_LibreTx", UART_LibreTx(), 0);
+    }
+    if (TXIE != 1) {
+        Falla("lleno", "TXIE", TXIE, 1);
+    }
+    VaciaTodo();
+    if (nSalida != UART_TX_TAM - 1 || uartTxEnviados != UART_TX_TAM - 1) {
+        Falla("lleno", "uartTxEnviados", uartTxEnviados, UART_TX_TAM - 1);
+    }
+    for (i = 0; i < (int)nSalida; i++) {
+        if (salida[i] != (unsigned char)i) {
+            Falla("lleno", "byte fuera de orden en la posicion", (unsigned long)i, i);
+            break;
+        }
+    }
+    if (TXIE != 0 || UART_LibreTx() != UART_TX_TAM - 1) {
+        Falla("lleno", "TXIE al quedar vacio", TXIE, 0);
+    }
+    printf("lleno: %u aceptados, %u descartados, %u enviados\n", aceptados, uartTxDescartados, uartTxEnviados);
+}
+
+static void CasoVuelta(void)
+{
+    unsigned char siguiente = 0;
+    unsigned int total = 0, tanda = 1;
+    int i;
+
+    UART_IniciaTx();
+    nSalida = 0;
+    while (total < 4000) {
+        for (i = 0; i < (int)tanda; i++) {
+            UART_EncolaTx(siguiente++);
+        }
+        total += tanda;
+        VaciaTodo();
+        tanda = tanda % (UART_TX_TAM - 1) + 1; // 1, 2, ..., 63, 1, ...: los indices quedan en todas las posiciones.
+    }
+    if (uartTxDescartados != 0) {
+        Falla("vuelta", "uartTxDescartados", uartTxDescartados, 0);
+    }
+    if (nSalida != total || uartTxEnviados != total) {
+        Falla("vuelta", "uartTxEnviados", uartTxEnviados, total);
+    }
+    for (i = 0; i < (int)nSalida; i++) {
+        if (salida[i] != (unsigned char)i) {
+            Falla("vuelta", "byte fuera de orden en la posicion", (unsigned long)i, i);
+            break;
+        }
+    }
+    printf("vuelta: %u bytes en tandas de 1 a %d, %u vueltas de los indices\n", total, UART_TX_TAM - 1,
+           total / UART_TX_TAM);
+}
+
+static void CasoTexto(void)
+{
+    static const char esperado[] = "COUNT 0 65535 4294967295\r\n";
+
+    UART_IniciaTx();
+    nSalida = 0;
+    UART_Texto("COUNT ");
+    UART_Numero(0);
+    UART_Texto(" ");
+    UART_Numero(65535);
+    UART_Texto(" ");
+    UART_Numero32(4294967295UL);
+    UART_Texto("\r\n");
+    VaciaTodo();
+    if (nSalida != strlen(esperado) || memcmp(salida, esperado, nSalida) != 0) {
+        Falla("texto", "bytes iguales", 0, 1);
+    }
+    printf("texto: %u bytes\n", (unsigned)nSalida);
+}
+
+//Un segundo de tiempo en pasos de 1 us. El EUSART: TXREG pasa al transmisor cuando este queda
+//libre y TXIF sube; cada byte tarda 10 bits en el cable
+static void CasoTasa(void)
+{
+    const unsigned long nsByte = 10000000000UL / UART_BAUDIOS;
+    unsigned long ns, tsrFin = 0, ofrecidos = 0, aceptados = 0, cable = 0, esperados;
+    unsigned char tsrOcupado = 0, txregLleno = 0, siguiente = 0, enCable = 0, tsrDato = 0;
+    unsigned int antes;
+    int i;
+
+    UART_IniciaTx();
+    nSalida = 0;
+    for (ns = 0; ns < 1000000000UL; ns += 1000) {
+        if (ns % 10000000UL == 0) {     // Tick de 10 ms: 30 bytes de un productor de main.
+            for (i = 0; i < 30; i++) {
+                ofrecidos++;
+                if (UART_EncolaTx(siguiente)) {
+                    aceptados++;
+                    if (nSalida < MAXIMO) {
+                        salida[nSalida++] = siguiente;
+                    }
+                }
+                siguiente++;
+            }
+        }
+        if (tsrOcupado && ns >= tsrFin) {
+            tsrOcupado = 0;
+            if (cable < nSalida && tsrDato != salida[cable]) {
+                Falla("tasa", "byte fuera de orden en el cable", cable, cable);
+            }
+            cable++;
+        }
+        if (!tsrOcupado && txregLleno) {
+            tsrDato = enCable;
+            tsrOcupado = 1;
+            tsrFin = ns + nsByte;
+            txregLleno = 0;
+        }
+        TXIF = !txregLleno;
+        if (TXIE == 1 && TXIF == 1) {   // Entra la ISR.
+            antes = uartTxEnviados;
+            UART_ServicioTx();
+            if (uartTxEnviados != antes) {
+                enCable = txreg;
+                txregLleno = 1;
+            }
+        }
+    }
+    esperados = UART_BAUDIOS / 10;
+    if (cable + 1 < esperados || cable > esperados) {
+        Falla("tasa", "bytes por el cable en 1 s", cable, esperados);
+    }
+    if (aceptados != uartTxEnviados + (UART_TX_TAM - 1 - UART_LibreTx())) {
+        Falla("tasa", "encolados - enviados - pendientes", aceptados - uartTxEnviados,
+              UART_TX_TAM - 1 - UART_LibreTx());
+    }
+    if (ofrecidos != aceptados + uartTxDescartados) {
+        Falla("tasa", "ofrecidos - encolados", ofrecidos - aceptados, uartTxDescartados);
+    }
+    printf("tasa: %lu ofrecidos, %lu encolados, %u descartados, %u enviados, %lu por el cable (%lu bytes/s)\n",
+           ofrecidos, aceptados, uartTxDescartados, uartTxEnviados, cable, esperados);
+}
+
+int main(void)
+{
+    CasoLleno();
+    CasoVuelta();
+    CasoTexto();
+    CasoTasa();
+    printf("uart-tx: %s\n", fallas ? "FALLA" : "ok");
+    return fallas ? 1 : 0;
+}
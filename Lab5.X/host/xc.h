@@ -0,0 +1,314 @@
+/*
+ * File:   xc.h (simulador en Linux)
+ *
+ * Reemplazo de <xc.h> para compilar Lab5.c con gcc (make host). Los SFR que
+ * usa el programa son variables con los mismos bits del PIC18F4550; los que
+ * tienen efecto al leer o escribir (TXREG, RCREG, PORTB, RC1, RCSTA, EECON1,
+ * EECON2, EEDATA) pasan
+ * por funciones de sim.c. El tiempo solo avanza en los puntos de espera:
+ * __delay_ms/__delay_us, NOP(), Sleep() y HAL_ESPERA(). En esos puntos el
+ * simulador corre los timers, el UART, el ADC, el teclado, el sensor y el
+ * LCD, y llama a la ISR si hay una interrupcion habilitada pendiente.
+ */
+
+#ifndef SIM_XC_H
+#define	SIM_XC_H
+
+typedef unsigned char sim_bit;
+
+// ============================== REGISTROS CON BITS ==============================
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit b0:1, b1:1, b2:1, b3:1, b4:1, b5:1, b6:1, b7:1; };
+} sim_puerto_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit RBIF:1, INT0IF:1, TMR0IF:1, RBIE:1, INT0IE:1, TMR0IE:1, PEIE:1, GIE:1; };
+} sim_intcon_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit RBIP:1, :1, TMR0IP:1, :1, INTEDG2:1, INTEDG1:1, INTEDG0:1, RBPU:1; };
+} sim_intcon2_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit INT1IF:1, INT2IF:1, :1, INT1IE:1, INT2IE:1, :1, INT1IP:1, INT2IP:1; };
+} sim_intcon3_t;
+
+typedef union {                         // PIR1, PIE1 e IPR1 comparten la posicion de los bits.
+    unsigned char valor;
+    struct { sim_bit TMR1:1, TMR2:1, CCP1:1, SSP:1, TX:1, RC:1, AD:1, SPP:1; };
+} sim_pir1_t;
+
+typedef union {                         // PIR2, PIE2 e IPR2.
+    unsigned char valor;
+    struct { sim_bit CCP2:1, TMR3:1, HLVD:1, BCL:1, EE:1, USB:1, CM:1, OSCF:1; };
+} sim_pir2_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit BOR:1, POR:1, PD:1, TO:1, RI:1, :1, SBOREN:1, IPEN:1; };
+} sim_rcon_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit TX9D:1, TRMT:1, BRGH:1, SENDB:1, SYNC:1, TXEN:1, TX9:1, CSRC:1; };
+} sim_txsta_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit RX9D:1, OERR:1, FERR:1, ADDEN:1, CREN:1, SREN:1, RX9:1, SPEN:1; };
+} sim_rcsta_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit ABDEN:1, WUE:1, :1, BRG16:1, TXCKP:1, RXDTP:1, RCIDL:1, ABDOVF:1; };
+} sim_baudcon_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit ADON:1, GO_DONE:1, CHS:4, :2; };
+} sim_adcon0_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit T0PS:3, PSA:1, T0SE:1, T0CS:1, T08BIT:1, TMR0ON:1; };
+} sim_t0con_t;
+
+typedef union {                         // T1CON y T3CON (T3CCPx en los bits 3 y 6 de T3CON).
+    unsigned char valor;
+    struct { sim_bit TMRON:1, TMRCS:1, TSYNC:1, T1OSCEN_T3CCP1:1, TCKPS:2, T1RUN_T3CCP2:1, RD16:1; };
+} sim_t1con_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit T2CKPS:2, TMR2ON:1, T2OUTPS:4, :1; };
+} sim_t2con_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit SCS:2, IOFS:1, OSTS:1, IRCF:3, IDLEN:1; };
+} sim_osccon_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit RD:1, WR:1, WREN:1, WRERR:1, FREE:1, :1, CFGS:1, EEPGD:1; };
+} sim_eecon1_t;
+
+typedef union {
+    unsigned char valor;
+    struct { sim_bit HLVDL:4, HLVDEN:1, IRVST:1, :1, VDIRMAG:1; };
+} sim_hlvdcon_t;
+
+extern volatile sim_puerto_t LATAbits, LATBbits, LATCbits, LATDbits, LATEbits;
+extern volatile sim_puerto_t TRISAbits, TRISBbits, TRISCbits, TRISDbits, TRISEbits;
+extern volatile sim_intcon_t INTCONbits;
+extern volatile sim_intcon2_t INTCON2bits;
+extern volatile sim_intcon3_t INTCON3bits;
+extern volatile sim_pir1_t PIR1bits, PIE1bits, IPR1bits;
+extern volatile sim_pir2_t PIR2bits, PIE2bits, IPR2bits;
+extern volatile sim_rcon_t RCONbits;
+extern volatile sim_txsta_t TXSTAbits;
+extern volatile sim_baudcon_t BAUDCONbits;
+extern volatile sim_adcon0_t ADCON0bits;
+extern volatile sim_t0con_t T0CONbits;
+extern volatile sim_t1con_t T1CONbits, T3CONbits;
+extern volatile sim_t2con_t T2CONbits;
+extern volatile sim_osccon_t OSCCONbits;
+extern volatile sim_hlvdcon_t HLVDCONbits;
+
+extern volatile unsigned char ADCON1, ADCON2, SPBRG, SPBRGH, TMR2, PR2;
+extern volatile unsigned char CCP1CON, CCP2CON, CCPR1L;
+extern volatile unsigned short TMR0, TMR1, TMR3, ADRES, CCPR1, CCPR2;
+
+volatile sim_rcsta_t *sim_rcsta(void);
+volatile unsigned char *sim_txreg(void);
+unsigned char sim_lee_rcreg(void);
+unsigned char sim_lee_portb(void);
+unsigned char sim_lee_portc(void);
+unsigned char sim_lee_portd(void);
+volatile sim_eecon1_t *sim_eecon1(void);
+volatile unsigned char *sim_eecon2(void);
+volatile unsigned char *sim_eedata(void);
+extern volatile unsigned char EEADR;
+
+#ifndef SIM_INTERNO                     // sim.c usa los campos de las uniones directamente.
+
+#define LATA        LATAbits.valor
+#define LATB        LATBbits.valor
+#define LATC        LATCbits.valor
+#define LATD        LATDbits.valor
+#define LATE        LATEbits.valor
+#define TRISA       TRISAbits.valor
+#define TRISB       TRISBbits.valor
+#define TRISC       TRISCbits.valor
+#define TRISD       TRISDbits.valor
+#define TRISE       TRISEbits.valor
+#define INTCON      INTCONbits.valor
+#define INTCON2     INTCON2bits.valor
+#define INTCON3     INTCON3bits.valor
+#define PIR1        PIR1bits.valor
+#define PIE1        PIE1bits.valor
+#define IPR1        IPR1bits.valor
+#define PIR2        PIR2bits.valor
+#define PIE2        PIE2bits.valor
+#define IPR2        IPR2bits.valor
+#define RCON        RCONbits.valor
+#define TXSTA       TXSTAbits.valor
+#define BAUDCON     BAUDCONbits.valor
+#define ADCON0      ADCON0bits.valor
+#define T0CON       T0CONbits.valor
+#define T1CON       T1CONbits.valor
+#define T2CON       T2CONbits.valor
+#define T3CON       T3CONbits.valor
+#define OSCCON      OSCCONbits.valor
+#define HLVDCON     HLVDCONbits.valor
+
+#define RCSTAbits   (*sim_rcsta())      // Ver sim_rcsta(): limpiar CREN borra OERR como en el PIC.
+#define RCSTA       (sim_rcsta()->valor)
+#define TXREG       (*sim_txreg())      // La escritura arranca la transmision en el siguiente punto de espera.
+#define RCREG       sim_lee_rcreg()     // Leer saca un byte del FIFO de 2 niveles y actualiza RCIF.
+#define PORTB       sim_lee_portb()     // RB7..RB4 dependen de las teclas y de la fila activa en LATB (o el bus del LCD si esta en B).
+#define PORTC       sim_lee_portc()
+#define PORTD       sim_lee_portd()     // Los pines de entrada traen el bus del LCD (si esta en D) si R/W (RC0) y E estan en 1.
+#define EECON1bits  (*sim_eecon1())     // Reconoce la secuencia 0x55/0xAA de EECON2 antes de WR=1.
+#define EECON1      (sim_eecon1()->valor)
+#define EECON2      (*sim_eecon2())
+#define EEDATA      (*sim_eedata())     // Con RD=1 la lectura trae el byte de la EEPROM.
+
+// ============================== BITS CON NOMBRE ==============================
+
+#define LATA0 LATAbits.b0
+#define LATA1 LATAbits.b1
+#define LATA2 LATAbits.b2
+#define LATA3 LATAbits.b3
+#define LATA4 LATAbits.b4
+#define LATA5 LATAbits.b5
+#define LATB0 LATBbits.b0
+#define LATB1 LATBbits.b1
+#define LATB2 LATBbits.b2
+#define LATB3 LATBbits.b3
+#define LATC0 LATCbits.b0
+#define LATC1 LATCbits.b1
+#define LATC2 LATCbits.b2
+#define LATD7 LATDbits.b7
+#define LATE0 LATEbits.b0
+#define LATE1 LATEbits.b1
+#define LATE2 LATEbits.b2
+
+#define TRISA0 TRISAbits.b0
+#define TRISA1 TRISAbits.b1
+#define TRISA2 TRISAbits.b2
+#define TRISA3 TRISAbits.b3
+#define TRISA4 TRISAbits.b4
+#define TRISA5 TRISAbits.b5
+#define TRISB0 TRISBbits.b0
+#define TRISC0 TRISCbits.b0
+#define TRISC1 TRISCbits.b1
+#define TRISC2 TRISCbits.b2
+#define TRISC6 TRISCbits.b6
+#define TRISC7 TRISCbits.b7
+#define TRISD7 TRISDbits.b7
+
+#define RB0 ((sim_lee_portb() >> 0) & 1)
+#define RB4 ((sim_lee_portb() >> 4) & 1)
+#define RB5 ((sim_lee_portb() >> 5) & 1)
+#define RB6 ((sim_lee_portb() >> 6) & 1)
+#define RB7 ((sim_lee_portb() >> 7) & 1)
+#define RC1 ((sim_lee_portc() >> 1) & 1)
+
+#define RBIF    INTCONbits.RBIF
+#define INT0IF  INTCONbits.INT0IF
+#define TMR0IF  INTCONbits.TMR0IF
+#define RBIE    INTCONbits.RBIE
+#define INT0IE  INTCONbits.INT0IE
+#define TMR0IE  INTCONbits.TMR0IE
+#define PEIE    INTCONbits.PEIE
+#define GIEL    PEIE                    // Mismo bit: con IPEN=1 habilita las de baja prioridad.
+#define GIE     INTCONbits.GIE
+#define GIEH    GIE
+#define RBIP    INTCON2bits.RBIP
+#define TMR0IP  INTCON2bits.TMR0IP
+#define INTEDG0 INTCON2bits.INTEDG0
+#define RBPU    INTCON2bits.RBPU
+#define INT1IF  INTCON3bits.INT1IF
+#define INT2IF  INTCON3bits.INT2IF
+#define INT1IE  INTCON3bits.INT1IE
+#define INT2IE  INTCON3bits.INT2IE
+
+#define TMR1IF  PIR1bits.TMR1
+#define TMR2IF  PIR1bits.TMR2
+#define CCP1IF  PIR1bits.CCP1
+#define TXIF    PIR1bits.TX
+#define RCIF    PIR1bits.RC
+#define ADIF    PIR1bits.AD
+#define TMR1IE  PIE1bits.TMR1
+#define TMR2IE  PIE1bits.TMR2
+#define CCP1IE  PIE1bits.CCP1
+#define TXIE    PIE1bits.TX
+#define RCIE    PIE1bits.RC
+#define ADIE    PIE1bits.AD
+#define TMR1IP  IPR1bits.TMR1
+#define TMR2IP  IPR1bits.TMR2
+#define TXIP    IPR1bits.TX
+#define RCIP    IPR1bits.RC
+#define ADIP    IPR1bits.AD
+#define CCP2IF  PIR2bits.CCP2
+#define TMR3IF  PIR2bits.TMR3
+#define EEIF    PIR2bits.EE
+#define CCP2IE  PIE2bits.CCP2
+#define TMR3IE  PIE2bits.TMR3
+#define EEIE    PIE2bits.EE
+#define HLVDIF  PIR2bits.HLVD
+#define HLVDIE  PIE2bits.HLVD
+#define CCP2IP  IPR2bits.CCP2
+#define TMR3IP  IPR2bits.TMR3
+
+#define POR     RCONbits.POR
+#define BOR     RCONbits.BOR
+#define IPEN    RCONbits.IPEN
+#define TRMT    TXSTAbits.TRMT
+#define BRGH    TXSTAbits.BRGH
+#define TXEN    TXSTAbits.TXEN
+#define ABDEN   BAUDCONbits.ABDEN
+#define WUE     BAUDCONbits.WUE
+#define BRG16   BAUDCONbits.BRG16
+#define ABDOVF  BAUDCONbits.ABDOVF
+#define ADON    ADCON0bits.ADON
+#define GO_DONE ADCON0bits.GO_DONE
+#define TMR0ON  T0CONbits.TMR0ON
+#define TMR1ON  T1CONbits.TMRON
+#define TMR3ON  T3CONbits.TMRON
+#define TMR2ON  T2CONbits.TMR2ON
+#define IDLEN   OSCCONbits.IDLEN
+#define IRVST   HLVDCONbits.IRVST
+#define RD      EECON1bits.RD
+#define WR      EECON1bits.WR
+#define WREN    EECON1bits.WREN
+#define WRERR   EECON1bits.WRERR
+#define CFGS    EECON1bits.CFGS
+#define EEPGD   EECON1bits.EEPGD
+
+#endif
+
+// ============================== INTRINSECOS DE XC8 ==============================
+
+void sim_retardo_us(double, double);
+void sim_ciclos(unsigned long);
+void sim_espera(void);
+void sim_reloj(double);
+void sim_lcd_puerto(char);
+void sim_duerme(void);
+
+#define __interrupt(...)                // La ISR es una funcion comun: sim.c la llama en los puntos de espera.
+#define __delay_us(x)   sim_retardo_us((double)(x), (double)(_XTAL_FREQ))
+#define __delay_ms(x)   sim_retardo_us((double)(x) * 1000.0, (double)(_XTAL_FREQ))
+#define NOP()           sim_ciclos(1)
+#define CLRWDT()        sim_ciclos(1)
+#define Sleep()         sim_duerme()
+#define SLEEP()         sim_duerme()
+
+#endif	/* SIM_XC_H */
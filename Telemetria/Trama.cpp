@@ -0,0 +1,127 @@
+#include "Trama.hpp"
+
+#include <utility>
+
+namespace lab5 {
+
+namespace {
+
+// CRC-8 con polinomio 0x07 procesado de a un nibble, igual que el firmware.
+constexpr std::uint8_t kCrc8Tabla[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+};
+
+}  // namespace
+
+std::uint8_t Crc8(const std::uint8_t *datos, std::size_t largo, std::uint8_t crc)
+{
+    for (std::size_t i = 0; i < largo; ++i) {
+        crc ^= datos[i];
+        crc = static_cast<std::uint8_t>(crc << 4) ^ kCrc8Tabla[crc >> 4];
+        crc = static_cast<std::uint8_t>(crc << 4) ^ kCrc8Tabla[crc >> 4];
+    }
+    return crc;
+}
+
+const char *NombreEstadoMotor(EstadoMotor estado)
+{
+    switch (estado) {
+    case EstadoMotor::Apagado:
+        return "apagado";
+    case EstadoMotor::Encendido:
+        return "encendido";
+    case EstadoMotor::Emergencia:
+        return "emergencia";
+    default:
+        return "desconocido";
+    }
+}
+
+DecodificadorTrama::DecodificadorTrama(AlRecibirTrama alTrama, AlRecibirTexto alTexto)
+    : alTrama_(std::move(alTrama)), alTexto_(std::move(alTexto))
+{
+}
+
+void DecodificadorTrama::Agrega(const std::uint8_t *datos, std::size_t largo)
+{
+    pendiente_.insert(pendiente_.end(), datos, datos + largo);
+    Procesa();
+}
+
+void DecodificadorTrama::Vacia()
+{
+    if (!linea_.empty() && alTexto_) {
+        alTexto_(linea_);
+    }
+    linea_.clear();
+}
+
+void DecodificadorTrama::AgregaTexto(std::uint8_t byte)
+{
+    ++estadisticas_.bytesTexto;
+    if (byte == '\r' || byte == '\n') {
+        Vacia();
+    } else {
+        linea_.push_back(static_cast<char>(byte));
+    }
+}
+
+void DecodificadorTrama::Procesa()
+{
+    std::size_t i = 0;
+
+    while (i < pendiente_.size()) {
+        if (pendiente_[i] != kTramaSync) {
+            AgregaTexto(pendiente_[i]);
+            ++i;
+            continue;
+        }
+        // Hace falta al menos BANDERAS para saber el largo.
+        if (pendiente_.size() - i < 3) {
+            break;
+        }
+        const std::size_t largo = (pendiente_[i + 2] & kTramaCompleta) ? kLargoCompleta : kLargoCorta;
+        if (pendiente_.size() - i < largo) {
+            break;
+        }
+
+        const std::uint8_t *p = &pendiente_[i];
+        if (Crc8(p + 1, largo - 2) != p[largo - 1]) {
+            // Un 0xA5 dentro de otra trama o un byte corrupto: se avanza uno y se busca otro SYNC.
+            ++estadisticas_.erroresCrc;
+            AgregaTexto(pendiente_[i]);
+            ++i;
+            continue;
+        }
+
+        Trama trama;
+        trama.secuencia = p[1];
+        trama.completa = (p[2] & kTramaCompleta) != 0;
+        trama.adc12Bits = (p[2] & kTramaAdc12Bits) != 0;
+        trama.motor = static_cast<EstadoMotor>((p[2] >> 4) & 0x03);
+        trama.adc = static_cast<std::uint16_t>(((p[2] & 0x0F) << 8) | p[3]);
+        if (trama.completa) {
+            trama.conteo = static_cast<std::uint16_t>((p[4] << 8) | p[5]);
+            trama.objetivo = static_cast<std::uint16_t>((p[6] << 8) | p[7]);
+            trama.modo = p[8];
+            ++estadisticas_.tramasCompletas;
+        }
+
+        if (haySecuencia_) {
+            estadisticas_.tramasPerdidas += static_cast<std::uint8_t>(trama.secuencia - siguienteSecuencia_);
+        }
+        haySecuencia_ = true;
+        siguienteSecuencia_ = static_cast<std::uint8_t>(trama.secuencia + 1);
+        ++estadisticas_.tramas;
+
+        if (alTrama_) {
+            alTrama_(trama);
+        }
+        i += largo;
+    }
+
+    pendiente_.erase(pendiente_.begin(), pendiente_.begin() + static_cast<std::ptrdiff_t>(i));
+}
+
+}  // namespace lab5
@@ -0,0 +1,80 @@
+// Decodificador de la telemetria binaria de Lab5 (ver Lab5.X/LibTelemetriaXC8.h).
+//
+// DecodificadorTrama recibe bytes crudos del puerto serial en cualquier
+// fragmentacion, se resincroniza con el byte SYNC y valida cada trama con
+// CRC-8. Los bytes que no forman parte de una trama valida (por ejemplo las
+// respuestas ASCII "OK", "COUNT 12", ...) se entregan aparte como texto.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lab5 {
+
+constexpr std::uint8_t kTramaSync = 0xA5;
+constexpr std::uint8_t kTramaCompleta = 0x80;
+constexpr std::uint8_t kTramaAdc12Bits = 0x40;
+constexpr std::size_t kLargoCorta = 5;
+constexpr std::size_t kLargoCompleta = 10;
+
+enum class EstadoMotor : std::uint8_t {
+    Apagado = 0,
+    Encendido = 1,
+    Emergencia = 2,
+    Desconocido = 3,
+};
+
+struct Trama {
+    std::uint8_t secuencia = 0;
+    bool completa = false;
+    bool adc12Bits = false;
+    std::uint16_t adc = 0;
+    EstadoMotor motor = EstadoMotor::Apagado;
+    // Solo validos si completa == true.
+    std::uint16_t conteo = 0;
+    std::uint16_t objetivo = 0;
+    std::uint8_t modo = 0;
+};
+
+struct EstadisticasEnlace {
+    std::uint64_t tramas = 0;
+    std::uint64_t tramasCompletas = 0;
+    std::uint64_t erroresCrc = 0;
+    std::uint64_t tramasPerdidas = 0;   // Saltos en el numero de secuencia.
+    std::uint64_t bytesTexto = 0;
+};
+
+std::uint8_t Crc8(const std::uint8_t *datos, std::size_t largo, std::uint8_t crc = 0);
+const char *NombreEstadoMotor(EstadoMotor estado);
+
+class DecodificadorTrama {
+public:
+    using AlRecibirTrama = std::function<void(const Trama &)>;
+    using AlRecibirTexto = std::function<void(const std::string &)>;
+
+    DecodificadorTrama(AlRecibirTrama alTrama, AlRecibirTexto alTexto = nullptr);
+
+    void Agrega(const std::uint8_t *datos, std::size_t largo);
+    // Entrega el texto pendiente aunque no haya llegado el fin de linea.
+    void Vacia();
+
+    const EstadisticasEnlace &Estadisticas() const { return estadisticas_; }
+
+private:
+    void Procesa();
+    void AgregaTexto(std::uint8_t byte);
+
+    AlRecibirTrama alTrama_;
+    AlRecibirTexto alTexto_;
+    std::vector<std::uint8_t> pendiente_;
+    std::string linea_;
+    EstadisticasEnlace estadisticas_;
+    bool haySecuencia_ = false;
+    std::uint8_t siguienteSecuencia_ = 0;
+};
+
+}  // namespace lab5
@@ -0,0 +1,172 @@
+// lab5-telemetria: lee la telemetria binaria del contador Lab5 desde un puerto
+// serial (o un archivo / stdin) y la imprime como CSV.
+//
+//   lab5-telemetria [-b baudios] [-t] [dispositivo|-]
+//
+// Cada trama valida sale como una linea CSV:
+//   seq,adc,bits,motor,conteo,objetivo,modo
+// conteo/objetivo/modo se repiten de la ultima trama completa recibida.
+// Las respuestas ASCII del firmware salen como comentarios "# ...". Al
+// terminar (EOF o Ctrl+C) se imprime un resumen del enlace en stderr.
+
+#include "Trama.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t gTerminar = 0;
+
+void AlSenal(int)
+{
+    gTerminar = 1;
+}
+
+speed_t Baudios(long baudios)
+{
+    switch (baudios) {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return 0;
+    }
+}
+
+bool ConfiguraPuerto(int fd, speed_t velocidad)
+{
+    termios tio{};
+    if (tcgetattr(fd, &tio) != 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, velocidad);
+    cfsetospeed(&tio, velocidad);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+void Uso(const char *programa)
+{
+    std::fprintf(stderr,
+                 "uso: %s [-b baudios] [-t] [dispositivo|-]\n"
+                 "  -b  velocidad del puerto serial (9600 por defecto)\n"
+                 "  -t  no mostrar el texto ASCII que no es telemetria\n",
+                 programa);
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    long baudios = 9600;
+    bool mostrarTexto = true;
+    const char *ruta = "-";
+
+    int opcion;
+    while ((opcion = getopt(argc, argv, "b:th")) != -1) {
+        switch (opcion) {
+        case 'b':
+            baudios = std::strtol(optarg, nullptr, 10);
+            break;
+        case 't':
+            mostrarTexto = false;
+            break;
+        default:
+            Uso(argv[0]);
+            return opcion == 'h' ? 0 : 2;
+        }
+    }
+    if (optind < argc) {
+        ruta = argv[optind];
+    }
+
+    int fd = STDIN_FILENO;
+    if (std::strcmp(ruta, "-") != 0) {
+        fd = open(ruta, O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            std::perror(ruta);
+            return 1;
+        }
+        if (isatty(fd)) {
+            const speed_t velocidad = Baudios(baudios);
+            if (velocidad == 0) {
+                std::fprintf(stderr, "velocidad no soportada: %ld\n", baudios);
+                return 2;
+            }
+            if (!ConfiguraPuerto(fd, velocidad)) {
+                std::perror("tcsetattr");
+                return 1;
+            }
+        }
+    }
+
+    std::signal(SIGINT, AlSenal);
+    std::signal(SIGTERM, AlSenal);
+
+    lab5::Trama ultimaCompleta;
+    bool hayCompleta = false;
+
+    lab5::DecodificadorTrama decodificador(
+        [&](const lab5::Trama &trama) {
+            if (trama.completa) {
+                ultimaCompleta = trama;
+                hayCompleta = true;
+            }
+            std::printf("%u,%u,%u,%s,", trama.secuencia, trama.adc, trama.adc12Bits ? 12u : 10u,
+                        lab5::NombreEstadoMotor(trama.motor));
+            if (hayCompleta) {
+                std::printf("%u,%u,%u\n", ultimaCompleta.conteo, ultimaCompleta.objetivo, ultimaCompleta.modo);
+            } else {
+                std::printf(",,\n");
+            }
+            std::fflush(stdout);
+        },
+        [&](const std::string &texto) {
+            if (mostrarTexto) {
+                std::printf("# %s\n", texto.c_str());
+                std::fflush(stdout);
+            }
+        });
+
+    std::printf("seq,adc,bits,motor,conteo,objetivo,modo\n");
+
+    std::uint8_t buffer[256];
+    while (!gTerminar) {
+        const ssize_t leidos = read(fd, buffer, sizeof buffer);
+        if (leidos <= 0) {
+            break;
+        }
+        decodificador.Agrega(buffer, static_cast<std::size_t>(leidos));
+    }
+    decodificador.Vacia();
+
+    const lab5::EstadisticasEnlace &e = decodificador.Estadisticas();
+    std::fprintf(stderr,
+                 "tramas: %llu (completas %llu), perdidas: %llu, errores CRC: %llu, bytes de texto: %llu\n",
+                 static_cast<unsigned long long>(e.tramas), static_cast<unsigned long long>(e.tramasCompletas),
+                 static_cast<unsigned long long>(e.tramasPerdidas), static_cast<unsigned long long>(e.erroresCrc),
+                 static_cast<unsigned long long>(e.bytesTexto));
+
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return 0;
+}